@@ -55,6 +55,7 @@ public:
         , buffer_(begin, end)
         , stream_(&buffer_)
         , fs_(end - begin, lastModified)
+        , memory_(begin, end - begin)
     {
         stream_.exceptions(std::ios::badbit | std::ios::failbit);
     }
@@ -72,12 +73,17 @@ public:
 
     virtual FileStat stat_impl() const UTILITY_OVERRIDE { return fs_; }
 
+    virtual boost::optional<ReadOnlyMemory> memory() UTILITY_OVERRIDE {
+        return memory_;
+    }
+
 private:
 
     boost::filesystem::path path_;
     bio::stream_buffer<bio::array_source> buffer_;
     std::istream stream_;
     FileStat fs_;
+    ReadOnlyMemory memory_;
 };
 
 template <typename Data>
@@ -102,6 +108,15 @@ public:
     {}
 };
 
+/** Wraps shared data to be held by MemIStreamWithHolder.
+ */
+struct SharedDataHolder {
+    SharedDataHolder(const SharedData &shared) : shared(shared) {}
+    const char* data() const { return shared->data(); }
+    std::size_t size() const { return shared->size(); }
+    SharedData shared;
+};
+
 template <typename Data, typename Type>
 IStream::pointer memStream(Type type, Data &&indata
                            , std::time_t lastModified
@@ -197,4 +212,28 @@ IStream::pointer memIStream(TileFile type, MemBlock &&data
     return detail::memStream(type, std::move(data), lastModified, path);
 }
 
+IStream::pointer memIStream(const char *contentType, const SharedData &data
+                            , std::time_t lastModified
+                            , const boost::filesystem::path &path)
+{
+    return detail::memStream(contentType, detail::SharedDataHolder(data)
+                             , lastModified, path);
+}
+
+IStream::pointer memIStream(File type, const SharedData &data
+                            , std::time_t lastModified
+                            , const boost::filesystem::path &path)
+{
+    return detail::memStream(type, detail::SharedDataHolder(data)
+                             , lastModified, path);
+}
+
+IStream::pointer memIStream(TileFile type, const SharedData &data
+                            , std::time_t lastModified
+                            , const boost::filesystem::path &path)
+{
+    return detail::memStream(type, detail::SharedDataHolder(data)
+                             , lastModified, path);
+}
+
 } } // namespace vtslibs::storage
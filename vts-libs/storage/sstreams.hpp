@@ -27,6 +27,7 @@
 #define vtslibs_storage_driver_sstreams_hpp_included_
 
 #include <functional>
+#include <memory>
 
 #include <boost/filesystem.hpp>
 
@@ -37,6 +38,10 @@ namespace vtslibs { namespace storage {
 
 typedef std::vector<char> MemBlock;
 
+/** Immutable data shared between multiple streams (e.g. cached file content).
+ */
+typedef std::shared_ptr<const std::string> SharedData;
+
 IStream::pointer memIStream(const char *contentType, std::string &&data
                             , std::time_t lastModified = 0
                             , const boost::filesystem::path &path = "unknown");
@@ -78,6 +83,18 @@ IStream::pointer memIStream(TileFile type, MemBlock &&data
                             , std::time_t lastModified = 0
                             , const boost::filesystem::path &path = "unknown");
 
+/** Streams over shared data. Data are not copied, stream holds a reference.
+ */
+IStream::pointer memIStream(const char *contentType, const SharedData &data
+                            , std::time_t lastModified = 0
+                            , const boost::filesystem::path &path = "unknown");
+IStream::pointer memIStream(File type, const SharedData &data
+                            , std::time_t lastModified = 0
+                            , const boost::filesystem::path &path = "unknown");
+IStream::pointer memIStream(TileFile type, const SharedData &data
+                            , std::time_t lastModified = 0
+                            , const boost::filesystem::path &path = "unknown");
+
 } } // namespace vtslibs::storage
 
 #endif // vtslibs_storage_driver_sstreams_hpp_included_
@@ -113,6 +113,20 @@ struct ReadOnlyFd {
     {}
 };
 
+/** Read only memory block.
+ *  Can be returned by IStream to access data directly without copying.
+ *
+ *  Memory is valid as long as the stream that returned it is alive.
+ */
+struct ReadOnlyMemory {
+    const char *data;
+    std::size_t size;
+
+    ReadOnlyMemory(const char *data, std::size_t size)
+        : data(data), size(size)
+    {}
+};
+
 class StreamBase : boost::noncopyable {
 public:
     StreamBase(const char *contentType) : contentType_(contentType) {}
@@ -170,6 +184,11 @@ public:
      *  stream is not associated with real file but resides in memory, etc.)
      */
     virtual boost::optional<ReadOnlyFd> fd() { return {}; }
+
+    /** Returns memory block holding whole content of this stream. Returns
+     *  boost::none if stream content is not available in memory.
+     */
+    virtual boost::optional<ReadOnlyMemory> memory() { return {}; }
 };
 
 /** Special in-memory stream.
@@ -51,6 +51,7 @@ UTILITY_GENERATE_ENUM_IO(Tilar::CreateMode,
 UTILITY_GENERATE_ENUM_IO(Tilar::OpenMode,
                          ((readOnly))
                          ((readWrite))
+                         ((readOnlyMapped))
                          )
 
 template<typename CharT, typename Traits>
@@ -33,6 +33,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 
 #include <boost/noncopyable.hpp>
@@ -42,6 +43,7 @@
 #include <boost/iostreams/stream.hpp>
 #include <boost/iostreams/categories.hpp>
 #include <boost/iostreams/positioning.hpp>
+#include <boost/iostreams/device/array.hpp>
 
 #include "dbglog/dbglog.hpp"
 
@@ -118,7 +120,7 @@ inline int flags(bool readOnly)
 
 inline int flags(Tilar::OpenMode openMode)
 {
-    return flags(openMode == Tilar::OpenMode::readOnly);
+    return flags(openMode != Tilar::OpenMode::readWrite);
 }
 
 inline int flags(Tilar::CreateMode createMode)
@@ -429,6 +431,11 @@ public:
 
     FileStat stat(const FileIndex &index) const;
 
+    /** Checks that every file lies inside first size bytes of given archive
+     *  file. Throws BadFileFormat otherwise.
+     */
+    void checkBounds(const fs::path &path, std::size_t size) const;
+
     bool exists(const FileIndex &index) const {
         if (!((index.col < edge_) && (index.row < edge_)
               && (index.type < options_.filesPerTile)))
@@ -605,6 +612,21 @@ Tilar::Entry::list ArchiveIndex::list() const
     return list;
 }
 
+void ArchiveIndex::checkBounds(const fs::path &path, std::size_t size)
+    const
+{
+    for (const auto &slot : grid_) {
+        if (!slot.valid()) { continue; }
+        // computed in 64 bits, 32-bit end can overflow
+        if ((std::uint64_t(slot.start) + slot.size) > size) {
+            LOGTHROW(err1, BadFileFormat)
+                << "File at [" << slot.start << ", +" << slot.size
+                << ") lies past the end of archive " << path << " ("
+                << size << " bytes).";
+        }
+    }
+}
+
 Tilar::Info ArchiveIndex::info() const
 {
     return { loadedFrom_, previous_, overhead_, std::time_t(timestamp_) };
@@ -617,6 +639,67 @@ FileStat ArchiveIndex::stat(const FileIndex &index) const
             , "application/octet-stream" };
 }
 
+/** Read-only memory mapping of whole archive file.
+ */
+class Mapping : boost::noncopyable {
+public:
+    typedef std::shared_ptr<Mapping> pointer;
+
+    Mapping(const Filedes &fd, std::size_t size);
+
+    ~Mapping();
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+    /** Hints kernel that given range is going to be accessed soon.
+     */
+    void willNeed(std::size_t start, std::size_t end) const;
+
+private:
+    char *data_;
+    std::size_t size_;
+};
+
+Mapping::Mapping(const Filedes &fd, std::size_t size)
+    : data_(nullptr), size_(size)
+{
+    if (!size_) { return; }
+
+    auto data(::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0));
+    if (MAP_FAILED == data) {
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError
+             ("Unable to map tilar file %s.", fd.path()));
+        LOG(err2) << e.what();
+        throw e;
+    }
+    data_ = static_cast<char*>(data);
+
+    // tiles are accessed randomly, readahead would only pollute page cache
+    if (-1 == ::madvise(data_, size_, MADV_RANDOM)) {
+        LOG(warn1) << "Unable to advise kernel about random access to "
+                   << "tilar file " << fd.path() << ": "
+                   << std::system_category().message(errno) << ".";
+    }
+}
+
+Mapping::~Mapping()
+{
+    if (data_) { ::munmap(data_, size_); }
+}
+
+void Mapping::willNeed(std::size_t start, std::size_t end) const
+{
+    static const std::size_t pageSize(::sysconf(_SC_PAGESIZE));
+
+    if (end <= start) { return; }
+    start -= (start % pageSize);
+    // failure is harmless here: it is just a hint
+    ::madvise(data_ + start, end - start, MADV_WILLNEED);
+}
+
 } // namespace
 
 struct Tilar::Detail
@@ -630,7 +713,7 @@ struct Tilar::Detail
 
     Detail(std::uint8_t version, const Options &options
            , Filedes &&srcFd, bool readOnly
-           , std::uint32_t indexOffset)
+           , std::uint32_t indexOffset, bool mapped = false)
         : version(version), options(options), fd(std::move(srcFd))
         , readOnly(readOnly), index(options)
         , checkpoint(fileSize(fd)), currentEnd(checkpoint), tx(0)
@@ -640,6 +723,15 @@ struct Tilar::Detail
     {
         OpenFiles::inc();
         loadIndex();
+
+        if (mapped) {
+            // mapped streams access data directly, corrupted index must not
+            // point outside the mapping
+            index.checkBounds(fd.path(), checkpoint);
+
+            // read-only file cannot grow, map everything up to checkpoint
+            mapping = std::make_shared<Mapping>(fd, checkpoint);
+        }
     }
 
     ~Detail();
@@ -795,6 +887,11 @@ struct Tilar::Detail
 
     ContentTypes contentTypes;
 
+    /** Whole file mapping, valid only in readOnlyMapped mode. Mapping
+     *  survives file detachment.
+     */
+    Mapping::pointer mapping;
+
 private:
     /** Number of open streams.
      */
@@ -909,7 +1006,8 @@ Tilar Tilar::open(const fs::path &path, OpenMode openMode)
     auto header(loadHeader(fd));
     return { std::make_shared<Detail>
             (std::get<1>(header), std::get<0>(header)
-             , std::move(fd), (openMode == OpenMode::readOnly), 0) };
+             , std::move(fd), (openMode != OpenMode::readWrite), 0
+             , (openMode == OpenMode::readOnlyMapped)) };
 }
 
 Tilar Tilar::open(const fs::path &path, const NullWhenNotFound_t&
@@ -917,12 +1015,13 @@ Tilar Tilar::open(const fs::path &path, const NullWhenNotFound_t&
 {
     // open file; return -1 when file not found
     auto fd(openFile(path, flags(openMode), false));
-    if (!fd) { return {{}}; }
+    if (!fd) { return {}; }
 
     auto header(loadHeader(fd));
     return { std::make_shared<Detail>
             (std::get<1>(header), std::get<0>(header)
-             , std::move(fd), (openMode == OpenMode::readOnly), 0) };
+             , std::move(fd), (openMode != OpenMode::readWrite), 0
+             , (openMode == OpenMode::readOnlyMapped)) };
 }
 
 Tilar Tilar::open(const fs::path &path, std::uint32_t indexOffset)
@@ -1258,6 +1357,87 @@ private:
     std::istream stream_;
 };
 
+/** Input stream served directly from mapped archive.
+ */
+class Tilar::MappedStream
+    : private ContentTypeHolder
+    , public storage::IStream
+{
+public:
+    MappedStream(const Tilar::Detail::pointer &owner, const FileIndex &index)
+        : ContentTypeHolder(owner->getContentType(index.type))
+        , IStream(contentType.c_str())
+        , owner_(owner), index_(index), start_(), size_()
+        , buffer_(range())
+        , stream_(&buffer_)
+    {
+        stream_.exceptions(std::ios::badbit | std::ios::failbit);
+        owner_->mapping->willNeed(start_, start_ + size_);
+        owner_->share();
+    }
+
+    virtual ~MappedStream() { owner_->unshare(); }
+
+    virtual std::istream& get() UTILITY_OVERRIDE { return stream_; }
+    virtual void close() UTILITY_OVERRIDE { buffer_.close(); }
+    virtual std::string name() const UTILITY_OVERRIDE {
+        std::ostringstream os;
+        os << owner_->path().string()
+           << ':' << index_.col << ',' << index_.row << ',' << index_.type;
+        return os.str();
+    }
+
+    virtual std::size_t read(char *buf, std::size_t size
+                             , std::istream::pos_type off)
+        UTILITY_OVERRIDE
+    {
+        // trim if out of range
+        const std::size_t pos(off);
+        if (pos >= size_) { return 0; }
+        size = std::min(size, size_ - pos);
+        std::copy(data() + pos, data() + pos + size, buf);
+        return size;
+    }
+
+    virtual FileStat stat_impl() const UTILITY_OVERRIDE {
+        return owner_->stat(index_);
+    }
+
+    virtual boost::optional<ReadOnlyFd> fd() UTILITY_OVERRIDE {
+        return ReadOnlyFd(owner_->getFd().get(), start_, start_ + size_
+                          , true);
+    }
+
+    virtual boost::optional<ReadOnlyMemory> memory() UTILITY_OVERRIDE {
+        return ReadOnlyMemory(data(), size_);
+    }
+
+private:
+    const char* data() const { return owner_->mapping->data() + start_; }
+
+    boost::iostreams::array_source range() {
+        const auto &slot(owner_->index.get(index_));
+        if (!slot.valid()) {
+            LOGTHROW(err1, NoSuchFile)
+                << "File [" << index_.col << ',' << index_.row
+                << ',' << index_.type << "] does not exist in the archive "
+                << owner_->path() << ".";
+        }
+
+        start_ = slot.start;
+        size_ = slot.size;
+        return { data(), size_ };
+    }
+
+    Tilar::Detail::pointer owner_;
+    const FileIndex index_;
+    std::size_t start_;
+    std::size_t size_;
+
+    boost::iostreams::stream_buffer<boost::iostreams::array_source> buffer_;
+    std::istream stream_;
+};
+
 std::streamsize Tilar::Sink::write(const char *data, std::streamsize size)
 {
     const auto &fd(device_->fd());
@@ -1416,6 +1596,9 @@ OStream::pointer Tilar::output(const FileIndex &index)
 IStream::pointer Tilar::input(const FileIndex &index)
 {
     LOG(debug) << "input(" << detail().fd.path() << ", " << index << ")";
+    if (detail_->mapping) {
+        return std::make_shared<MappedStream>(detail_, index);
+    }
     return std::make_shared<Source::Stream>(detail_, index);
 }
 
@@ -1424,6 +1607,9 @@ IStream::pointer Tilar::input(const FileIndex &index
 {
     LOG(debug) << "input(" << detail().fd.path() << ", " << index << ")";
     if (!detail_->index.exists(index)) { return {}; }
+    if (detail_->mapping) {
+        return std::make_shared<MappedStream>(detail_, index);
+    }
     return std::make_shared<Source::Stream>(detail_, index);
 }
 
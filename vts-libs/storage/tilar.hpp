@@ -59,7 +59,12 @@ public:
         , appendOrTruncate
     };
 
-    enum class OpenMode { readOnly, readWrite };
+    /** Open mode.
+     *
+     *  readOnlyMapped: read-only access, whole archive is mapped into memory
+     *  at open and input streams are served directly from the mapping.
+     */
+    enum class OpenMode { readOnly, readWrite, readOnlyMapped };
 
     struct Options {
         /** square edge = 2^binaryOrder
@@ -94,7 +99,7 @@ public:
     /** Opens existing tilar files.
      *
      *  \param path to the tilar file
-     *  \param openMode open mode (r/o, r/w)
+     *  \param openMode open mode (r/o, r/w, mapped r/o)
      *  \return open tilar file
      */
     static Tilar open(const boost::filesystem::path &path
@@ -103,7 +108,7 @@ public:
     /** Opens existing tilar files.
      *
      *  \param path to the tilar file
-     *  \param openMode open mode (r/o, r/w)
+     *  \param openMode open mode (r/o, r/w, mapped r/o)
      *  \return open tilar file
      */
     static Tilar open(const boost::filesystem::path &path
@@ -114,7 +119,7 @@ public:
      *
      *  \param path to the tilar file
      *  \param options expected options
-     *  \param openMode open mode (r/o, r/w)
+     *  \param openMode open mode (r/o, r/w, mapped r/o)
      *  \return open tilar file
      */
     static Tilar open(const boost::filesystem::path &path
@@ -126,7 +131,7 @@ public:
      *
      *  \param path to the tilar file
      *  \param options expected options
-     *  \param openMode open mode (r/o, r/w)
+     *  \param openMode open mode (r/o, r/w, mapped r/o)
      *  \return open tilar file
      */
     static Tilar open(const boost::filesystem::path &path
@@ -153,6 +158,10 @@ public:
     static Tilar open(const boost::filesystem::path &path
                       , std::uint32_t indexOffset);
 
+    /** Null archive, evaluates to false.
+     */
+    Tilar() {}
+
     ~Tilar();
 
     /** Associates file type with content type.
@@ -294,6 +303,7 @@ private:
     class Device; friend class Device;
     class Source; friend class Source;
     class Sink; friend class Sink;
+    class MappedStream; friend class MappedStream;
 };
 
 inline Tilar Tilar::open(const boost::filesystem::path &path
@@ -74,6 +74,13 @@ TmpTsEncoder::TmpTsEncoder(const boost::filesystem::path &path
            , optionalPath(config_.resume, tmpset_.root() / "navtile.info"))
 {
     tmpset_.keep(config.keepTmpset);
+
+    if (config_.navtileMemoryBudget) {
+        TiledHeightMap::Config tc;
+        tc.memoryBudget = config_.navtileMemoryBudget << 20;
+        tc.tmpDir = tmpset_.root();
+        ntg_.tiled(tc);
+    }
 }
 
 TmpTsEncoder::~TmpTsEncoder()
@@ -143,7 +150,7 @@ public:
                , const Mesh::pointer &mesh
                , const HybridAtlas::pointer &atlas)
         : MeshOpInput::DataSource({}), nodeInfo_(nodeInfo)
-        , mesh_(mesh), atlas_(atlas)
+        , mesh_(mesh), atlas_(atlas), node_(std::make_shared<MetaNode>())
     {}
 
     virtual ~DataSource() {}
@@ -163,11 +170,11 @@ private:
         return (TileIndex::Flag::mesh | TileIndex::Flag::atlas);
     }
 
-    virtual const MetaNode* findMetaNode_impl(const TileId &tileId)
+    virtual MetaNode::pointer findMetaNode_impl(const TileId &tileId)
         const
     {
         check(tileId);
-        return &node_;
+        return node_;
     }
 
     virtual Mesh::pointer
@@ -203,7 +210,7 @@ private:
     NodeInfo nodeInfo_;
     Mesh::pointer mesh_;
     HybridAtlas::pointer atlas_;
-    MetaNode node_;
+    MetaNode::pointer node_;
 };
 
 const auto mergeOptions([]() -> MergeOptions
@@ -445,6 +452,13 @@ void TmpTsEncoder::Config::configuration(po::options_description &config)
          ->default_value(dtmExtractionRadius)->required()
          , "Radius (in meters) of DTM extraction element (in meters).")
 
+        ("navtile.memoryBudget"
+         , po::value(&navtileMemoryBudget)
+         ->default_value(navtileMemoryBudget)->required()
+         , "Memory budget (in MB) for out-of-core navtile generation. "
+         "Heightmaps are processed in blocks backed by temporary files. "
+         "Zero means in-memory generation.")
+
         ("force.watertight", po::value(&forceWatertight)
          ->default_value(false)->implicit_value(true)
          , "Enforces full coverage mask to every generated tile even "
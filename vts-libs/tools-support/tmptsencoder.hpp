@@ -46,6 +46,11 @@ public:
         int textureQuality;
         double dtmExtractionRadius;
 
+        /** Memory budget (in MB) for out-of-core navtile generation. Zero
+         *  means in-memory generation.
+         */
+        std::size_t navtileMemoryBudget;
+
         bool forceWatertight;
         bool resume;
         bool keepTmpset;
@@ -57,6 +62,7 @@ public:
 
         Config()
             : textureQuality(85), dtmExtractionRadius(40.0)
+            , navtileMemoryBudget(0)
             , forceWatertight(false), resume(false), keepTmpset(false)
             , fuseSubmeshes(true)
         {}
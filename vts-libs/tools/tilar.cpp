@@ -23,11 +23,22 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <system_error>
+
 #include <boost/uuid/uuid_io.hpp>
+#include <boost/format.hpp>
+#include <boost/filesystem.hpp>
 
 #include "dbglog/dbglog.hpp"
 
 #include "utility/enum-io.hpp"
+#include "utility/filedes.hpp"
 #include "utility/gccversion.hpp"
 #include "utility/streams.hpp"
 #include "utility/time.hpp"
@@ -47,6 +58,7 @@ UTILITY_GENERATE_ENUM(Command,
                       ((append))
                       ((remove))
                       ((extract))
+                      ((bench))
                       )
 
 
@@ -98,6 +110,8 @@ public:
                               | service::ENABLE_UNRECOGNIZED_OPTIONS))
         , command_(Command::list)
         , createOptions_{ 5, 1 }
+        , iterations_(10), benchArchives_(16), benchFileSize_(8 << 10)
+        , benchCold_(true)
     {
     }
 
@@ -158,6 +172,8 @@ private:
 
     int extract();
 
+    int bench();
+
     fs::path file_;
     Command command_;
 
@@ -165,6 +181,10 @@ private:
     File::list files_;
     FileIndex::list indices_;
     boost::optional<std::uint32_t> indexOffset_;
+    unsigned int iterations_;
+    unsigned int benchArchives_;
+    std::size_t benchFileSize_;
+    bool benchCold_;
 
     std::map<Command, std::shared_ptr<UP> >
     commandParsers_;
@@ -238,6 +258,33 @@ void Tilar::configuration(po::options_description &cmdline
             ;
         p.positional.add("files", -1);
     });
+
+    createParser(cmdline, Command::bench
+                 , "--command=bench: generates synthetic archive set in "
+                 "given (non-existent) directory and measures read "
+                 "throughput of all its files, both via pread and via "
+                 "memory mapping; the directory is removed afterwards"
+                 , [&](UP &p)
+    {
+        optionsConfiguration(p.options);
+        p.options.add_options()
+            ("iterations", po::value(&iterations_)
+             ->default_value(iterations_)->required()
+             , "Number of rounds; every round runs one pass over the whole "
+             "archive set in each mode, order of modes rotates between "
+             "rounds.")
+            ("archives", po::value(&benchArchives_)
+             ->default_value(benchArchives_)->required()
+             , "Number of archives to generate.")
+            ("fileSize", po::value(&benchFileSize_)
+             ->default_value(benchFileSize_)->required()
+             , "Average size of generated file (in bytes); sizes are "
+             "uniformly distributed in [fileSize/2, 3*fileSize/2].")
+            ("cold", po::value(&benchCold_)
+             ->default_value(benchCold_)->required()
+             , "Drop archives from page cache before every pass.")
+            ;
+    });
 }
 
 po::ext_parser Tilar::extraParser()
@@ -351,6 +398,7 @@ int Tilar::run()
         case Command::append: return append();
         case Command::remove: return remove();
         case Command::extract: return extract();
+        case Command::bench: return bench();
         }
     } catch (const std::exception &e) {
         std::cerr << "tilar: " << e.what() << std::endl;
@@ -453,6 +501,203 @@ int Tilar::extract()
     return EXIT_SUCCESS;
 }
 
+namespace {
+
+struct BenchResult {
+    std::size_t files;
+    std::size_t bytes;
+    double seconds;
+
+    BenchResult() : files(), bytes(), seconds() {}
+
+    BenchResult& operator+=(const BenchResult &o) {
+        files += o.files;
+        bytes += o.bytes;
+        seconds += o.seconds;
+        return *this;
+    }
+};
+
+typedef std::vector<fs::path> Paths;
+
+/** Generates archive set with all slots filled with random data.
+ */
+Paths generateArchives(const fs::path &root
+                       , const vs::Tilar::Options &options
+                       , unsigned int count, std::size_t fileSize)
+{
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<std::size_t> size
+        (fileSize / 2, fileSize + fileSize / 2);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    const unsigned int edge(1 << options.binaryOrder);
+    std::vector<char> data;
+
+    Paths paths;
+    for (unsigned int i(0); i < count; ++i) {
+        paths.push_back(root / str(boost::format("%u.tilar") % i));
+        auto arch(vs::Tilar::create(paths.back(), options
+                                    , vs::Tilar::CreateMode::failIfExists));
+
+        for (unsigned int row(0); row < edge; ++row) {
+            for (unsigned int col(0); col < edge; ++col) {
+                for (unsigned int type(0); type < options.filesPerTile;
+                     ++type)
+                {
+                    data.resize(size(gen));
+                    for (auto &c : data) { c = char(byte(gen)); }
+
+                    auto os(arch.output(vs::Tilar::FileIndex
+                                        (col, row, type)));
+                    os->get().write(data.data(), data.size());
+                    os->close();
+                }
+            }
+        }
+        arch.commit();
+    }
+
+    return paths;
+}
+
+/** Flushes given files and drops them from page cache.
+ */
+void dropCache(const Paths &paths)
+{
+    for (const auto &path : paths) {
+        utility::Filedes fd(::open(path.string().c_str(), O_RDONLY), path);
+        if (!fd) {
+            std::system_error e
+                (errno, std::system_category()
+                 , "Unable to open " + path.string());
+            LOG(err2) << e.what();
+            throw e;
+        }
+        ::fdatasync(fd);
+        if (const auto err = ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED))
+        {
+            LOG(warn2) << "Unable to drop " << path << " from page cache: "
+                       << std::system_category().message(err) << ".";
+        }
+    }
+}
+
+/** Reads all files from all archives in random (but fixed) order, i.e. the
+ *  way tile server accesses them.
+ */
+BenchResult benchRead(const Paths &paths, vs::Tilar::OpenMode openMode
+                      , bool zeroCopy)
+{
+    typedef std::chrono::steady_clock clock;
+
+    BenchResult res;
+    std::vector<char> buf;
+    volatile char sink(0);
+
+    const auto start(clock::now());
+
+    std::vector<vs::Tilar> archives;
+    std::vector<std::pair<std::size_t, vs::Tilar::Entry> > entries;
+    for (const auto &path : paths) {
+        archives.push_back(vs::Tilar::open(path, openMode));
+        for (const auto &entry : archives.back().list()) {
+            entries.emplace_back(archives.size() - 1, entry);
+        }
+    }
+    std::shuffle(entries.begin(), entries.end(), std::mt19937(0));
+
+    for (const auto &item : entries) {
+        const auto &entry(item.second);
+        auto is(archives[item.first].input(entry.index));
+        if (zeroCopy) {
+            if (auto memory = is->memory()) {
+                // touch every page to make sure data are really read
+                for (std::size_t off(0); off < memory->size; off += 4096) {
+                    sink = memory->data[off];
+                }
+                res.bytes += memory->size;
+                ++res.files;
+                continue;
+            }
+        }
+
+        buf.resize(entry.size);
+        res.bytes += is->read(buf.data(), buf.size(), 0);
+        ++res.files;
+    }
+
+    res.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    (void) sink;
+    return res;
+}
+
+void report(const std::string &what, const BenchResult &res)
+{
+    std::cout << what << ": " << res.files << " files, "
+              << res.bytes << " bytes in " << res.seconds << " s ("
+              << (res.seconds ? (res.files / res.seconds) : 0.0)
+              << " files/s, "
+              << (res.seconds ? (res.bytes / res.seconds / (1 << 20)) : 0.0)
+              << " MiB/s)\n";
+}
+
+} // namespace
+
+int Tilar::bench()
+{
+    if (fs::exists(file_)) {
+        std::cerr << "tilar: " << file_ << " already exists" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // generated archive set is removed when leaving
+    fs::create_directories(file_);
+    struct Cleanup {
+        const fs::path &root;
+        ~Cleanup() {
+            boost::system::error_code ec;
+            fs::remove_all(root, ec);
+        }
+    } cleanup{file_};
+
+    std::cout << "Generating " << benchArchives_ << " archive(s) in "
+              << file_ << "." << std::endl;
+    const auto paths(generateArchives(file_, createOptions_, benchArchives_
+                                      , benchFileSize_));
+
+    struct Mode {
+        const char *name;
+        vs::Tilar::OpenMode openMode;
+        bool zeroCopy;
+        BenchResult result;
+    };
+
+    std::vector<Mode> modes = {
+        { "pread", vs::Tilar::OpenMode::readOnly, false, {} }
+        , { "mmap (copy)", vs::Tilar::OpenMode::readOnlyMapped, false, {} }
+        , { "mmap (zero-copy)", vs::Tilar::OpenMode::readOnlyMapped
+            , true, {} }
+    };
+
+    // rotate modes between rounds so no mode is systematically favoured by
+    // page cache state left by the previous one
+    for (unsigned int round(0); round < iterations_; ++round) {
+        for (std::size_t i(0); i < modes.size(); ++i) {
+            auto &mode(modes[(round + i) % modes.size()]);
+            if (benchCold_) { dropCache(paths); }
+            mode.result += benchRead(paths, mode.openMode, mode.zeroCopy);
+        }
+    }
+
+    std::cout << (benchCold_ ? "cold" : "warm") << " page cache, "
+              << iterations_ << " round(s):\n";
+    for (const auto &mode : modes) { report(mode.name, mode.result); }
+    std::cout.flush();
+
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[])
 {
     return Tilar()(argc, argv);
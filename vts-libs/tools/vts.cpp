@@ -27,7 +27,16 @@
 #include <unistd.h>
 
 #include <cerrno>
+#include <map>
+#include <set>
 #include <queue>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <functional>
+#include <algorithm>
 
 #include <boost/format.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -59,17 +68,25 @@
 
 #include "../registry/po.hpp"
 #include "../registry/urlexpander.hpp"
+#include "../storage/sstreams.hpp"
 #include "../vts.hpp"
 #include "../vts/io.hpp"
 #include "../vts/mesh.hpp"
+#include "../vts/meshio.hpp"
+#include "../vts/compactmesh.hpp"
+#include "../vts/compactqtree.hpp"
+#include "../vts/mappedtileindex.hpp"
 #include "../vts/atlas.hpp"
 #include "../vts/tileflags.hpp"
 #include "../vts/metaflags.hpp"
 #include "../vts/encodeflags.hpp"
 #include "../vts/opencv/colors.hpp"
+#include "../vts/opencv/atlas.hpp"
 #include "../vts/opencv/navtile.hpp"
 #include "../vts/tileset/delivery.hpp"
 #include "../vts/tileset/driver.hpp"
+#include "../vts/tileset/driver/remotecache.hpp"
+#include "../vts/tileset/tilesetindex.hpp"
 #include "../vts/2d.hpp"
 #include "../vts/visit.hpp"
 #include "../vts/csconvertor.hpp"
@@ -113,6 +130,7 @@ namespace tools = vtslibs::vts::tools;
     ((tileIndexInfo)("tileindex-info"))                             \
     ((tileIndexRanges)("tileindex-ranges"))                         \
     ((convertTileIndex)("convert-tileindex"))                       \
+    ((mapTileIndex)("map-tileindex"))                               \
     ((concat)("concat"))                                            \
     ((aggregate)("aggregate"))                                      \
     ((remote)("remote"))                                            \
@@ -138,8 +156,17 @@ namespace tools = vtslibs::vts::tools;
     ((virtualSurfaceInfo)("vs-info"))                               \
                                                                     \
     ((checkMetatileTree)("check-metatile-tree"))                   \
+    ((checkRemoteCache)("check-remote-cache"))                     \
                                                                     \
     ((locker2Stresser)("locker2-stresser"))                         \
+    ((benchRead)("bench-read"))                                     \
+    ((benchTileSetRead)("bench-tileset-read"))                      \
+    ((benchMetatile)("bench-metatile"))                             \
+    ((benchMesh)("bench-mesh"))                                     \
+    ((benchCsConvertor)("bench-csconvertor"))                       \
+    ((benchQTree)("bench-qtree"))                                   \
+    ((benchDelivery2d)("bench-delivery-2d"))                        \
+    ((benchGlue)("bench-glue"))                                     \
                                                                     \
     ((decodeTsMap)("decode-tsmap"))                                 \
                                                                     \
@@ -221,6 +248,9 @@ public:
         , queryLod_(), textureQuality_(70), meshFormat_(MeshFormat::normalized)
         , generate_(false), sameType_(false)
         , timeout_(5000)
+        , benchThreads_(std::thread::hardware_concurrency())
+        , benchCount_(100000)
+        , benchIterations_(10)
     {
         addOptions_.textureQuality = 0;
         addOptions_.checkTileindexIdentity = true;
@@ -331,6 +361,8 @@ private:
 
     int convertTileIndex();
 
+    int mapTileIndex();
+
     int concat();
 
     int aggregate();
@@ -367,10 +399,28 @@ private:
 
     int checkMetatileTree();
 
+    int checkRemoteCache();
+
     int queryNavtile();
 
     int locker2Stresser();
 
+    int benchRead();
+
+    int benchTileSetRead();
+
+    int benchMetatile();
+
+    int benchMesh();
+
+    int benchCsConvertor();
+
+    int benchQTree();
+
+    int benchDelivery2d();
+
+    int benchGlue();
+
     int decodeTsMap();
 
     int listReferenceFrames();
@@ -423,6 +473,11 @@ private:
     boost::optional<std::string> expandRemote_;
     long timeout_;
 
+    unsigned int benchThreads_;
+    std::size_t benchCount_;
+    std::size_t benchIterations_;
+    vts::OpenOptions benchOpenOptions_;
+
     /** External lock.
      */
     boost::optional<std::string> lock_;
@@ -516,6 +571,21 @@ void configureProgress(const po::variables_map &vars
     options.progress = std::make_shared<MergeProgress>(std::move(dup), period);
 }
 
+void glueWorkersConfiguration(po::options_description &options
+                              , vts::Storage::AddOptions &addOptions)
+{
+    options.add_options()
+        ("glue.workers", po::value(&addOptions.glueWorkers)
+         ->default_value(addOptions.glueWorkers)->required()
+         , "Number of glues generated concurrently. 0 means number of "
+         "available CPUs.")
+        ("glue.workerMemory", po::value(&addOptions.glueWorkerMemory)
+         ->default_value(addOptions.glueWorkerMemory)->required()
+         , "Memory budget (in bytes) of single glue worker. "
+         "0 means no limit.")
+        ;
+}
+
 void configureGeneratesetModifier(const po::variables_map &vars
                        , vts::GlueCreationOptions &options)
 {
@@ -702,6 +772,7 @@ void VtsStorage::configuration(po::options_description &cmdline
         vts::configuration(p.options, addOptions_);
 
         progressConfiguration(p.options);
+        glueWorkersConfiguration(p.options, addOptions_);
 
         p.positional.add("tileset", 1);
 
@@ -817,6 +888,7 @@ void VtsStorage::configuration(po::options_description &cmdline
         vts::configuration(p.options, addOptions_);
 
         progressConfiguration(p.options);
+        glueWorkersConfiguration(p.options, addOptions_);
 
         p.positional.add("tileset", 1);
 
@@ -866,6 +938,7 @@ void VtsStorage::configuration(po::options_description &cmdline
         vts::configuration(p.options, addOptions_);
 
         progressConfiguration(p.options);
+        glueWorkersConfiguration(p.options, addOptions_);
 
         p.positional.add("tileset", -1);
 
@@ -1143,6 +1216,18 @@ void VtsStorage::configuration(po::options_description &cmdline
         p.positional.add("output", -1);
     });
 
+    createParser(cmdline, Command::mapTileIndex
+                 , "--command=map-tileindex: tile-index conversion to "
+                 "memory-mappable format"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("output", po::value(&outputPath_)->required()
+             , "Path of output mappable tileindex.")
+            ;
+        p.positional.add("output", -1);
+    });
+
     createParser(cmdline, Command::concat
                  , "--command=concat: concatenate tilesets into one set"
                  , [&](UP &p)
@@ -1633,6 +1718,15 @@ void VtsStorage::configuration(po::options_description &cmdline
         p.positional.add("tileId", 1);
     });
 
+    createParser(cmdline, Command::checkRemoteCache
+                 , "--command=check-remote-cache: exercise remote cache "
+                 "(hit, miss, generation rollover and revision switch) "
+                 "with a stub fetcher in scratch directory path"
+                 , [&](UP &p)
+    {
+        (void) p;
+    });
+
     createParser(cmdline, Command::queryNavtile
                  , "--command=query-navtile: query navtiles at given position "
                  "and LOD"
@@ -1667,6 +1761,181 @@ void VtsStorage::configuration(po::options_description &cmdline
         (void) p;
     });
 
+    createParser(cmdline, Command::benchRead
+                 , "--command=bench-read: "
+                 "measure concurrent tile read throughput of a tileset"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("threads", po::value(&benchThreads_)
+             ->default_value(benchThreads_)->required()
+             , "Number of reading threads.")
+            ("count", po::value(&benchCount_)
+             ->default_value(benchCount_)->required()
+             , "Number of reads per thread.")
+            ;
+        benchOpenOptions_.configuration(p.options);
+
+        p.configure = [&](const po::variables_map &vars) {
+            benchOpenOptions_.configure(vars);
+        };
+    });
+
+    createParser(cmdline, Command::benchTileSetRead
+                 , "--command=bench-tileset-read: "
+                 "measure concurrent read and decode throughput of "
+                 "read-only tileset (metanode, mesh, atlas and navtile)"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("threads", po::value(&benchThreads_)
+             ->default_value(benchThreads_)->required()
+             , "Number of reading threads.")
+            ("count", po::value(&benchCount_)
+             ->default_value(benchCount_)->required()
+             , "Number of tiles read per thread.")
+            ;
+        benchOpenOptions_.configuration(p.options);
+
+        p.configure = [&](const po::variables_map &vars) {
+            benchOpenOptions_.configure(vars);
+        };
+    });
+
+    createParser(cmdline, Command::benchMetatile
+                 , "--command=bench-metatile: "
+                 "compare memory and lookup speed of regular and packed "
+                 "metatile loaded from file"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("referenceFrame", po::value<std::string>()->required()
+             , "Reference frame this metatile is for.")
+            ("count", po::value(&benchCount_)
+             ->default_value(benchCount_)->required()
+             , "Number of lookups.")
+            ;
+
+        p.configure = [&](const po::variables_map &vars) {
+            referenceFrame_  = vr::system.referenceFrames
+            (vars["referenceFrame"].as<std::string>());
+        };
+
+        p.positional.add("referenceFrame", 1);
+    });
+
+    createParser(cmdline, Command::benchMesh
+                 , "--command=bench-mesh: "
+                 "measure mesh decoding throughput of stream and buffer "
+                 "decoders on meshes from given tileset"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("count", po::value(&benchCount_)
+             ->default_value(1000)->required()
+             , "Number of meshes to decode.")
+            ("iterations", po::value(&benchIterations_)
+             ->default_value(10)->required()
+             , "Number of decoding rounds.")
+            ;
+        benchOpenOptions_.configuration(p.options);
+
+        p.configure = [&](const po::variables_map &vars) {
+            benchOpenOptions_.configure(vars);
+        };
+    });
+
+    createParser(cmdline, Command::benchCsConvertor
+                 , "--command=bench-csconvertor: "
+                 "measure throughput of per-point and batch conversion of "
+                 "mesh vertices from given tileset to node SRS"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("count", po::value(&benchCount_)
+             ->default_value(1000)->required()
+             , "Number of meshes to convert.")
+            ("iterations", po::value(&benchIterations_)
+             ->default_value(10)->required()
+             , "Number of conversion rounds.")
+            ;
+        benchOpenOptions_.configuration(p.options);
+
+        p.configure = [&](const po::variables_map &vars) {
+            benchOpenOptions_.configure(vars);
+        };
+    });
+
+    createParser(cmdline, Command::benchQTree
+                 , "--command=bench-qtree: "
+                 "compare lookup and traversal speed and memory use of "
+                 "regular and compact quad trees built from tile index of "
+                 "given tileset"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("count", po::value(&benchCount_)
+             ->default_value(1000000)->required()
+             , "Number of random lookups.")
+            ("iterations", po::value(&benchIterations_)
+             ->default_value(10)->required()
+             , "Number of benchmark rounds.")
+            ;
+        benchOpenOptions_.configuration(p.options);
+
+        p.configure = [&](const po::variables_map &vars) {
+            benchOpenOptions_.configure(vars);
+        };
+    });
+
+    createParser(cmdline, Command::benchDelivery2d
+                 , "--command=bench-delivery-2d: "
+                 "measure concurrent throughput of generated 2D tiles "
+                 "(masks and 2D metatiles) served by delivery; use "
+                 "delivery.pngCompression to tune encoder"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("threads", po::value(&benchThreads_)
+             ->default_value(benchThreads_)->required()
+             , "Number of reading threads.")
+            ("count", po::value(&benchCount_)
+             ->default_value(benchCount_)->required()
+             , "Number of tiles read per thread.")
+            ("tile2dCacheLimit", po::value<std::size_t>()
+             ->default_value(vts::Delivery::tile2dCacheLimit())
+             , "Memory limit (in bytes) of process-wide cache of encoded "
+             "2D tiles. Zero disables the cache.")
+            ;
+        benchOpenOptions_.configuration(p.options);
+
+        p.configure = [&](const po::variables_map &vars) {
+            benchOpenOptions_.configure(vars);
+            vts::Delivery::tile2dCacheLimit
+                (vars["tile2dCacheLimit"].as<std::size_t>());
+        };
+    });
+
+    createParser(cmdline, Command::benchGlue
+                 , "--command=bench-glue: "
+                 "generate glue of given tilesets serially and in parallel "
+                 "into path/serial and path/parallel, report durations and "
+                 "verify that both glues are identical tile by tile"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("tileset", po::value(&tilesets_)->required()
+             , "Glued tileset, priority grows from left to right.")
+            ;
+        p.positional.add("tileset", -1);
+
+        vts::configuration(p.options, addOptions_);
+
+        p.configure = [&](const po::variables_map &vars) {
+            vts::configure(vars, addOptions_);
+        };
+    });
+
     createParser(cmdline, Command::decodeTsMap
                  , "--command=decode-tsmap: "
                  "decodes tileset.map file"
@@ -2479,7 +2748,7 @@ int VtsStorage::tileInfo()
 
     auto ts(vts::openTileSet(path_));
 
-    const auto *n(ts.getMetaNode(tileId_, std::nothrow));
+    const auto n(ts.findMetaNode(tileId_));
     if (!n) {
         std::cerr << tileId_ << ": no such tile" << '\n';
         return EXIT_FAILURE;
@@ -2851,6 +3120,19 @@ int VtsStorage::exportMesh()
 
 int VtsStorage::tileIndexInfo()
 {
+    if (vts::MappedTileIndex::check(path_)) {
+        const vts::MappedTileIndex ti(path_);
+        std::cout << "lodRange: " << ti.lodRange()
+                  << "\ncount: " << ti.count()
+                  << "\nmapped: true\n";
+
+        for (const auto &tileId : tileIds_) {
+            auto flags(ti.get(tileId));
+            std::cout << tileId << ": " << vts::TileFlags(flags) << '\n';
+        }
+        return EXIT_SUCCESS;
+    }
+
     vts::TileIndex ti;
     ti.load(path_);
     std::cout << "lodRange: " << ti.lodRange() << '\n';
@@ -2949,6 +3231,23 @@ int VtsStorage::convertTileIndex()
     return EXIT_SUCCESS;
 }
 
+int VtsStorage::mapTileIndex()
+{
+    vts::TileIndex ti;
+    ti.load(path_);
+    vts::MappedTileIndex::write(ti, outputPath_);
+
+    // sanity check
+    const vts::MappedTileIndex mti(outputPath_);
+    if (mti.count() != ti.count()) {
+        std::cerr << outputPath_ << ": tile count mismatch ("
+                  << mti.count() << " != " << ti.count() << ")" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
 int VtsStorage::concat()
 {
     vts::CloneOptions createOptions;
@@ -3705,6 +4004,110 @@ int VtsStorage::checkMetatileTree()
     return EXIT_SUCCESS;
 }
 
+int VtsStorage::checkRemoteCache()
+{
+    namespace driver = vts::driver;
+
+    const std::string url("stub://check-remote-cache");
+    const auto type(vts::TileFile::mesh);
+    // ~1 KiB per file, generation is switched after 32 files
+    const std::size_t limit(64 << 10);
+
+    fs::remove_all(path_);
+
+    std::size_t failures(0);
+    auto check([&](bool ok, const std::string &what)
+    {
+        std::cout << what << ": " << (ok ? "ok" : "FAILED") << std::endl;
+        if (!ok) { ++failures; }
+    });
+
+    auto content([](const vts::TileId &tileId) -> std::string
+    {
+        return boost::lexical_cast<std::string>(tileId)
+            + std::string(1 << 10, '.');
+    });
+
+    // stub fetcher: generates content from tile ID, counts calls
+    std::size_t fetches(0);
+    auto fetch([&](const vts::TileId &tileId) -> vs::IStream::pointer
+    {
+        ++fetches;
+        return vs::memIStream(type, content(tileId), 0, "stub");
+    });
+
+    // the same lookup as in remote driver
+    auto input([&](driver::RemoteCache &cache, const vts::TileId &tileId)
+               -> bool
+    {
+        auto is(cache.input(tileId, type));
+        if (!is) { is = cache.store(tileId, type, fetch(tileId)); }
+        std::ostringstream os;
+        os << is->get().rdbuf();
+        return os.str() == content(tileId);
+    });
+
+    auto fetched([&](driver::RemoteCache &cache, const vts::TileId &tileId)
+                 -> bool
+    {
+        const auto before(fetches);
+        const auto valid(input(cache, tileId));
+        return valid && (fetches != before);
+    });
+
+    auto cached([&](driver::RemoteCache &cache, const vts::TileId &tileId)
+                -> bool
+    {
+        const auto before(fetches);
+        const auto valid(input(cache, tileId));
+        return valid && (fetches == before);
+    });
+
+    const vts::TileId first(10, 0, 0);
+    auto tile([](unsigned int index) { return vts::TileId(10, index, 1); });
+
+    {
+        auto cache(driver::RemoteCache::open(path_, url, 1, limit));
+        check(fetched(*cache, first), "miss");
+        check(cached(*cache, first), "hit");
+
+        // fill first generation, first tile lands in the previous one
+        for (unsigned int i(0); i < 40; ++i) { input(*cache, tile(i)); }
+        check(cached(*cache, first), "hit in previous generation");
+        check(cache->stats().promotions == 1, "promotion");
+
+        // overflow the whole cache, oldest generation is dropped
+        for (unsigned int i(40); i < 160; ++i) { input(*cache, tile(i)); }
+        const auto stats(cache->stats());
+        check(stats.evictions > 0, "generation drop");
+        check(fetched(*cache, tile(0)), "miss after generation drop");
+        check(cached(*cache, tile(159)), "hit in current generation");
+    }
+
+    {
+        auto cache(driver::RemoteCache::open(path_, url, 1, limit));
+        check(cached(*cache, tile(159)), "hit after reopen");
+    }
+
+    {
+        auto cache(driver::RemoteCache::open(path_, url, 2, limit));
+        check(fetched(*cache, tile(159)), "miss in new revision");
+
+        // path/URL-UUID/REVISION
+        std::size_t revisions(0);
+        for (fs::directory_iterator u(path_), e; u != e; ++u) {
+            for (fs::directory_iterator r(u->path()); r != e; ++r) {
+                ++revisions;
+            }
+        }
+        check(revisions == 1, "old revision removed");
+    }
+
+    fs::remove_all(path_);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 namespace {
 
 class MultiSrsPoint {
@@ -3831,6 +4234,746 @@ int VtsStorage::locker2Stresser()
     return EXIT_SUCCESS;
 }
 
+int VtsStorage::benchRead()
+{
+    typedef std::chrono::steady_clock clock;
+
+    auto ts(vts::openTileSet(path_, benchOpenOptions_));
+
+    std::vector<vts::TileId> tiles;
+    traverse(ts.tileIndex(), [&](const vts::TileId &tileId
+                                 , vts::QTree::value_type flags)
+    {
+        if (flags & vts::TileIndex::Flag::mesh) { tiles.push_back(tileId); }
+    });
+
+    if (tiles.empty()) {
+        std::cerr << path_ << ": no tiles to read" << '\n';
+        return EXIT_FAILURE;
+    }
+
+    const auto &driver(ts.driver());
+    std::atomic<std::size_t> bytes(0);
+
+    const auto start(clock::now());
+    std::vector<std::thread> threads;
+    for (unsigned int t(0); t < benchThreads_; ++t) {
+        threads.emplace_back([&, t]()
+        {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<std::size_t>
+                pick(0, tiles.size() - 1);
+            std::vector<char> buf;
+            std::size_t total(0);
+
+            for (std::size_t i(0); i < benchCount_; ++i) {
+                auto is(driver.input(tiles[pick(gen)], vts::TileFile::mesh));
+                buf.resize(is->stat().size);
+                total += is->read(buf.data(), buf.size(), 0);
+            }
+
+            bytes += total;
+        });
+    }
+
+    for (auto &thread : threads) { thread.join(); }
+    const std::chrono::duration<double> elapsed(clock::now() - start);
+
+    const auto reads(benchThreads_ * benchCount_);
+    std::cout << "threads: " << benchThreads_
+              << "\nreads: " << reads
+              << "\nbytes: " << bytes
+              << "\nelapsed: " << elapsed.count() << " s"
+              << "\nreads/s: " << (reads / elapsed.count())
+              << "\nMiB/s: " << (bytes / elapsed.count() / (1 << 20))
+              << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+int VtsStorage::benchTileSetRead()
+{
+    typedef std::chrono::steady_clock clock;
+
+    const auto ts(vts::openTileSet(path_, benchOpenOptions_));
+
+    typedef std::pair<vts::TileId, vts::QTree::value_type> Tile;
+    std::vector<Tile> tiles;
+    traverse(ts.tileIndex(), [&](const vts::TileId &tileId
+                                 , vts::QTree::value_type flags)
+    {
+        if (flags & vts::TileIndex::Flag::content) {
+            tiles.emplace_back(tileId, flags);
+        }
+    });
+
+    if (tiles.empty()) {
+        std::cerr << path_ << ": no tiles to read" << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::atomic<std::size_t> meshes(0);
+    std::atomic<std::size_t> atlases(0);
+    std::atomic<std::size_t> navtiles(0);
+    std::atomic<std::size_t> failures(0);
+
+    // all threads read through one tileset, no external locking
+    const auto start(clock::now());
+    std::vector<std::thread> threads;
+    for (unsigned int t(0); t < benchThreads_; ++t) {
+        threads.emplace_back([&, t]()
+        {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<std::size_t>
+                pick(0, tiles.size() - 1);
+
+            for (std::size_t i(0); i < benchCount_; ++i) {
+                const auto &tile(tiles[pick(gen)]);
+                const auto &tileId(tile.first);
+                const auto flags(tile.second);
+
+                try {
+                    ts.getMetaNode(tileId);
+
+                    if (flags & vts::TileIndex::Flag::mesh) {
+                        ts.getMesh(tileId);
+                        ++meshes;
+                    }
+
+                    if (flags & vts::TileIndex::Flag::atlas) {
+                        vts::opencv::Atlas atlas;
+                        ts.getAtlas(tileId, atlas);
+                        ++atlases;
+                    }
+
+                    if (flags & vts::TileIndex::Flag::navtile) {
+                        vts::opencv::NavTile navtile;
+                        ts.getNavTile(tileId, navtile);
+                        ++navtiles;
+                    }
+                } catch (const std::exception &e) {
+                    LOG(err2) << "Failed to read tile " << tileId << ": "
+                              << e.what();
+                    ++failures;
+                }
+            }
+        });
+    }
+
+    for (auto &thread : threads) { thread.join(); }
+    const std::chrono::duration<double> elapsed(clock::now() - start);
+
+    const auto reads(benchThreads_ * benchCount_);
+    std::cout << "threads: " << benchThreads_
+              << "\ntiles: " << reads
+              << "\nmeshes: " << meshes
+              << "\natlases: " << atlases
+              << "\nnavtiles: " << navtiles
+              << "\nfailures: " << failures
+              << "\nelapsed: " << elapsed.count() << " s"
+              << "\ntiles/s: " << (reads / elapsed.count())
+              << std::endl;
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int VtsStorage::benchMetatile()
+{
+    typedef std::chrono::steady_clock clock;
+    typedef std::chrono::duration<double> seconds;
+
+    const auto binaryOrder(referenceFrame_.metaBinaryOrder);
+
+    auto start(clock::now());
+    const auto meta(vts::loadMetaTile(path_, binaryOrder));
+    const seconds metaLoad(clock::now() - start);
+
+    auto pool(std::make_shared<vts::PackedMetaTile::CreditPool>());
+    vts::PackedMetaTile packed(binaryOrder, pool);
+    {
+        utility::ifstreambuf f(path_.string());
+        start = clock::now();
+        packed.load(f, path_);
+        f.close();
+    }
+    const seconds packedLoad(clock::now() - start);
+
+    // estimate regular metatile memory
+    std::size_t metaMemory(sizeof(meta) + meta.size() * meta.size()
+                           * sizeof(vts::MetaNode));
+    meta.for_each([&](const vts::TileId&, const vts::MetaNode &node)
+    {
+        metaMemory += node.credits().size() * sizeof(vs::CreditId);
+    });
+
+    std::cout << "Metatile ID: " << meta.origin()
+              << "\nregular: " << metaMemory << " B, loaded in "
+              << metaLoad.count() << " s"
+              << "\npacked: " << packed.memory() << " B ("
+              << packed.nodeCount() << " nodes, "
+              << pool->size() << " credit sets), loaded in "
+              << packedLoad.count() << " s\n";
+
+    const auto e(meta.validExtents());
+    if (!math::valid(e)) {
+        std::cout << "No valid tile in this metatile." << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    // random lookups inside valid extents
+    std::vector<vts::TileId> tiles;
+    {
+        std::mt19937 gen(0);
+        std::uniform_int_distribution<unsigned int> x(e.ll(0), e.ur(0));
+        std::uniform_int_distribution<unsigned int> y(e.ll(1), e.ur(1));
+        const auto &origin(meta.origin());
+        for (std::size_t i(0); i < benchCount_; ++i) {
+            tiles.emplace_back(origin.lod, origin.x + x(gen)
+                               , origin.y + y(gen));
+        }
+    }
+
+    std::size_t sum(0);
+    start = clock::now();
+    for (const auto &tileId : tiles) {
+        sum += meta.get(tileId, std::nothrow)->flags();
+    }
+    const seconds metaLookup(clock::now() - start);
+
+    start = clock::now();
+    for (const auto &tileId : tiles) { sum += packed.flags(tileId); }
+    const seconds packedLookup(clock::now() - start);
+
+    start = clock::now();
+    for (const auto &tileId : tiles) {
+        sum += packed.get(tileId, std::nothrow)->flags();
+    }
+    const seconds packedGet(clock::now() - start);
+
+    std::cout << "lookups: " << tiles.size()
+              << "\nregular flags lookup: " << metaLookup.count() << " s"
+              << "\npacked flags lookup: " << packedLookup.count() << " s"
+              << "\npacked node unpack: " << packedGet.count() << " s"
+              << "\n(checksum " << sum << ")" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+int VtsStorage::benchMesh()
+{
+    typedef std::chrono::steady_clock clock;
+    typedef std::chrono::duration<double> seconds;
+
+    auto ts(vts::openTileSet(path_, benchOpenOptions_));
+
+    std::vector<vts::TileId> tiles;
+    traverse(ts.tileIndex(), [&](const vts::TileId &tileId
+                                 , vts::QTree::value_type flags)
+    {
+        if (flags & vts::TileIndex::Flag::mesh) { tiles.push_back(tileId); }
+    });
+
+    if (tiles.empty()) {
+        std::cerr << path_ << ": no mesh to decode" << '\n';
+        return EXIT_FAILURE;
+    }
+
+    // pick meshes and re-encode them as raw version 3 mesh proper
+    std::shuffle(tiles.begin(), tiles.end(), std::mt19937(0));
+    if (tiles.size() > benchCount_) { tiles.resize(benchCount_); }
+
+    std::vector<std::string> meshes;
+    std::size_t bytes(0), vertices(0), memory(0), compactMemory(0);
+    for (const auto &tileId : tiles) {
+        const auto mesh(ts.getMesh(tileId));
+        std::ostringstream os;
+        vts::detail::saveMeshProper(os, vts::submeshRange(mesh), nullptr, 3);
+        meshes.push_back(os.str());
+        bytes += meshes.back().size();
+        for (const auto &sm : mesh) {
+            vertices += sm.vertices.size();
+            memory += (sizeof(sm)
+                       + sm.vertices.capacity() * sizeof(math::Point3d)
+                       + sm.tc.capacity() * sizeof(math::Point2d)
+                       + sm.etc.capacity() * sizeof(math::Point2d)
+                       + sm.faces.capacity() * sizeof(vts::Face)
+                       + sm.facesTc.capacity() * sizeof(vts::Face));
+        }
+        compactMemory += vts::CompactMesh(mesh).memory();
+    }
+
+    const auto total(double(bytes) * benchIterations_);
+    const auto totalVertices(double(vertices) * benchIterations_);
+    auto report([&](const char *what, const seconds &elapsed)
+    {
+        std::cout << what << ": " << elapsed.count() << " s, "
+                  << (total / elapsed.count() / (1 << 20)) << " MiB/s, "
+                  << (totalVertices / elapsed.count() / 1e6)
+                  << " Mvertices/s" << std::endl;
+    });
+
+    std::cout << "meshes: " << meshes.size()
+              << "\nbytes: " << bytes
+              << "\nvertices: " << vertices
+              << "\nsubmesh memory: " << memory
+              << "\ncompact submesh memory: " << compactMemory
+              << "\niterations: " << benchIterations_ << std::endl;
+
+    std::size_t sum(0);
+    auto run([&](const char *what, const std::function
+                 <std::size_t(const std::string&)> &decode)
+    {
+        const auto start(clock::now());
+        for (std::size_t i(0); i < benchIterations_; ++i) {
+            for (const auto &data : meshes) { sum += decode(data); }
+        }
+        report(what, clock::now() - start);
+    });
+
+    run("stream", [&](const std::string &data) -> std::size_t
+    {
+        std::istringstream is(data);
+        is.exceptions(std::ios::badbit | std::ios::failbit);
+        vts::Mesh mesh;
+        vts::detail::loadMeshProper(is, "bench", mesh);
+        return mesh.submeshes.size();
+    });
+
+    run("buffer (double)", [&](const std::string &data) -> std::size_t
+    {
+        vts::Mesh mesh;
+        vts::detail::loadMeshProper(data.data(), data.size(), "bench", mesh);
+        return mesh.submeshes.size();
+    });
+
+    run("buffer (float32)", [&](const std::string &data) -> std::size_t
+    {
+        vts::detail::SubMeshBuffers<float>::list mesh;
+        vts::detail::loadMeshProper(data.data(), data.size(), "bench", mesh);
+        return mesh.size();
+    });
+
+    run("buffer (quantized)", [&](const std::string &data) -> std::size_t
+    {
+        vts::detail::SubMeshBuffers<std::int32_t>::list mesh;
+        vts::detail::loadMeshProper(data.data(), data.size(), "bench", mesh);
+        return mesh.size();
+    });
+
+    run("buffer (compact)", [&](const std::string &data) -> std::size_t
+    {
+        vts::CompactSubMesh::list mesh;
+        vts::detail::loadMeshProper(data.data(), data.size(), "bench", mesh);
+        return mesh.size();
+    });
+
+    std::cout << "(checksum " << sum << ")" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+int VtsStorage::benchCsConvertor()
+{
+    typedef std::chrono::steady_clock clock;
+    typedef std::chrono::duration<double> seconds;
+
+    auto ts(vts::openTileSet(path_, benchOpenOptions_));
+    const auto &rf(ts.referenceFrame());
+
+    std::vector<vts::TileId> tiles;
+    traverse(ts.tileIndex(), [&](const vts::TileId &tileId
+                                 , vts::QTree::value_type flags)
+    {
+        if (flags & vts::TileIndex::Flag::mesh) { tiles.push_back(tileId); }
+    });
+
+    if (tiles.empty()) {
+        std::cerr << path_ << ": no mesh to convert" << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::shuffle(tiles.begin(), tiles.end(), std::mt19937(0));
+    if (tiles.size() > benchCount_) { tiles.resize(benchCount_); }
+
+    // collect vertices grouped by destination SRS
+    std::map<std::string, math::Points3> vertices;
+    std::size_t count(0);
+    for (const auto &tileId : tiles) {
+        const auto mesh(ts.getMesh(tileId));
+        auto &points(vertices[vts::NodeInfo(rf, tileId).srs()]);
+        for (const auto &sm : mesh) {
+            points.insert(points.end(), sm.vertices.begin()
+                          , sm.vertices.end());
+            count += sm.vertices.size();
+        }
+    }
+
+    std::cout << "meshes: " << tiles.size()
+              << "\nvertices: " << count
+              << "\nSRS: " << vertices.size()
+              << "\niterations: " << benchIterations_ << std::endl;
+
+    const auto total(double(count) * benchIterations_);
+    double sum(0);
+    auto run([&](const char *what, const std::function
+                 <void(const std::string&, math::Points3&)> &convert)
+    {
+        seconds elapsed(0);
+        for (std::size_t i(0); i < benchIterations_; ++i) {
+            for (const auto &item : vertices) {
+                auto points(item.second);
+                const auto start(clock::now());
+                convert(item.first, points);
+                elapsed += clock::now() - start;
+                if (!points.empty()) { sum += points.front()(2); }
+            }
+        }
+        std::cout << what << ": " << elapsed.count() << " s, "
+                  << (total / elapsed.count() / 1e6) << " Mpoints/s, "
+                  << (elapsed.count() * 1e9 / total) << " ns/point"
+                  << std::endl;
+    });
+
+    run("per-point", [&](const std::string &srs, math::Points3 &points)
+    {
+        const vts::CsConvertor conv(rf.model.physicalSrs, srs);
+        for (auto &p : points) { p = conv(p); }
+    });
+
+    run("cached per-point", [&](const std::string &srs
+                                , math::Points3 &points)
+    {
+        const auto &conv(vts::cachedCsConvertor(rf.model.physicalSrs, srs));
+        for (auto &p : points) { p = conv(p); }
+    });
+
+    run("batch", [&](const std::string &srs, math::Points3 &points)
+    {
+        vts::cachedCsConvertor(rf.model.physicalSrs, srs).convert(points);
+    });
+
+    run("parallel batch", [&](const std::string &srs, math::Points3 &points)
+    {
+        vts::csConvert(rf.model.physicalSrs, srs
+                       , points.data(), points.size());
+    });
+
+    std::cout << "(checksum " << sum << ")" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+int VtsStorage::benchQTree()
+{
+    typedef std::chrono::steady_clock clock;
+    typedef std::chrono::duration<double> seconds;
+
+    auto ts(vts::openTileSet(path_, benchOpenOptions_));
+    const auto &ti(ts.tileIndex());
+
+    std::vector<const vts::QTree*> trees;
+    std::vector<vts::CompactQTree> ctrees;
+    std::size_t memory(0);
+    std::size_t cmemory(0);
+    std::size_t nodes(0);
+    for (const auto &tree : ti.trees()) {
+        trees.push_back(&tree);
+        ctrees.emplace_back(tree);
+
+        // regular tree: one heap block of 4 nodes per inner node
+        const auto blocks((ctrees.back().nodeCount() - 1) / 4);
+        memory += (sizeof(tree) + blocks * (4 * (sizeof(vts::QTree::value_type)
+                                                 + sizeof(void*))
+                                            + 2 * sizeof(void*)));
+        cmemory += ctrees.back().memory();
+        nodes += ctrees.back().nodeCount();
+    }
+
+    if (trees.empty()) {
+        std::cerr << path_ << ": empty tile index" << '\n';
+        return EXIT_FAILURE;
+    }
+
+    // random lookups in all lods
+    struct Query { std::size_t tree; unsigned int x; unsigned int y; };
+    std::vector<Query> queries;
+    queries.reserve(benchCount_);
+    std::mt19937 rng(0);
+    for (std::size_t i(0); i < benchCount_; ++i) {
+        const auto tree(rng() % trees.size());
+        const auto size(trees[tree]->size().width);
+        queries.push_back({ tree, unsigned(rng() % size)
+                    , unsigned(rng() % size) });
+    }
+
+    std::cout << "lods: " << trees.size()
+              << "\nnodes: " << nodes
+              << "\nqtree memory (approx.): " << memory << " B"
+              << "\ncompact memory: " << cmemory << " B"
+              << "\nlookups: " << queries.size()
+              << "\niterations: " << benchIterations_ << std::endl;
+
+    std::size_t sum(0);
+    auto run([&](const char *what, const std::function<void()> &op
+                 , double total, const char *unit)
+    {
+        seconds elapsed(0);
+        for (std::size_t i(0); i < benchIterations_; ++i) {
+            const auto start(clock::now());
+            op();
+            elapsed += clock::now() - start;
+        }
+        total *= benchIterations_;
+        std::cout << what << ": " << elapsed.count() << " s, "
+                  << (elapsed.count() * 1e9 / total) << " ns/" << unit
+                  << std::endl;
+    });
+
+    run("qtree lookup", [&]() {
+        for (const auto &q : queries) { sum += trees[q.tree]->get(q.x, q.y); }
+    }, queries.size(), "lookup");
+
+    run("compact lookup", [&]() {
+        for (const auto &q : queries) { sum += ctrees[q.tree].get(q.x, q.y); }
+    }, queries.size(), "lookup");
+
+    auto visit([&](unsigned int x, unsigned int y, unsigned int size
+                   , vts::QTree::value_type value)
+    {
+        sum += x + y + size + value;
+    });
+
+    run("qtree traversal", [&]() {
+        for (const auto *tree : trees) { tree->forEachNode(visit); }
+    }, nodes, "node");
+
+    run("compact traversal", [&]() {
+        for (const auto &tree : ctrees) { tree.forEachNode(visit); }
+    }, nodes, "node");
+
+    std::cout << "(checksum " << sum << ")" << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+int VtsStorage::benchDelivery2d()
+{
+    typedef std::chrono::steady_clock clock;
+
+    const auto delivery(vts::Delivery::open(path_, benchOpenOptions_));
+
+    // mask for each mesh tile, 2D metatile for each area with any mesh
+    typedef std::pair<vts::TileId, vts::TileFile> Tile;
+    std::vector<Tile> tiles;
+    std::set<vts::TileId> metaIds;
+    traverse(delivery->index().tileIndex, [&](const vts::TileId &tileId
+                                              , vts::QTree::value_type flags)
+    {
+        if (!(flags & vts::TileIndex::Flag::mesh)) { return; }
+        tiles.emplace_back(tileId, vts::TileFile::mask);
+        metaIds.insert(vts::Meta2d::metaId(tileId));
+    });
+
+    for (const auto &metaId : metaIds) {
+        tiles.emplace_back(metaId, vts::TileFile::meta2d);
+    }
+
+    if (tiles.empty()) {
+        std::cerr << path_ << ": no tiles to read" << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::atomic<std::size_t> masks(0);
+    std::atomic<std::size_t> meta2ds(0);
+    std::atomic<std::size_t> bytes(0);
+    std::atomic<std::size_t> failures(0);
+
+    const auto start(clock::now());
+    std::vector<std::thread> threads;
+    for (unsigned int t(0); t < benchThreads_; ++t) {
+        threads.emplace_back([&, t]()
+        {
+            std::mt19937 gen(t);
+            std::uniform_int_distribution<std::size_t>
+                pick(0, tiles.size() - 1);
+            std::vector<char> buf;
+            std::size_t total(0);
+
+            for (std::size_t i(0); i < benchCount_; ++i) {
+                const auto &tile(tiles[pick(gen)]);
+
+                try {
+                    auto is(delivery->input(tile.first, tile.second
+                                            , vts::FileFlavor::regular));
+                    buf.resize(is->stat().size);
+                    total += is->read(buf.data(), buf.size(), 0);
+
+                    if (tile.second == vts::TileFile::mask) {
+                        ++masks;
+                    } else {
+                        ++meta2ds;
+                    }
+                } catch (const std::exception &e) {
+                    LOG(err2) << "Failed to read " << tile.second
+                              << " tile " << tile.first << ": " << e.what();
+                    ++failures;
+                }
+            }
+
+            bytes += total;
+        });
+    }
+
+    for (auto &thread : threads) { thread.join(); }
+    const std::chrono::duration<double> elapsed(clock::now() - start);
+
+    const auto stats(vts::Delivery::tile2dCacheStats());
+    const auto reads(benchThreads_ * benchCount_);
+    std::cout << "threads: " << benchThreads_
+              << "\ntiles: " << reads
+              << "\nmasks: " << masks
+              << "\nmeta2d: " << meta2ds
+              << "\nfailures: " << failures
+              << "\nbytes: " << bytes
+              << "\ncache hits: " << stats.hits
+              << "\ncache misses: " << stats.misses
+              << "\ncache evictions: " << stats.evictions
+              << "\ncache size: " << stats.size << " B"
+              << "\nelapsed: " << elapsed.count() << " s"
+              << "\ntiles/s: " << (reads / elapsed.count())
+              << std::endl;
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int VtsStorage::benchGlue()
+{
+    typedef std::chrono::steady_clock clock;
+
+    if (tilesets_.size() < 2) {
+        std::cerr << "bench-glue: at least two tilesets are needed"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    vts::TileSet::list sets;
+    for (const auto &path : tilesets_) {
+        sets.push_back(vts::openTileSet(path));
+    }
+
+    // generates glue with given number of threads; both glues share the same
+    // ID to have comparable output
+    auto generate([&](const std::string &name, std::size_t threads)
+                  -> fs::path
+    {
+        const auto gPath(path_ / name);
+
+        vts::TileSetProperties gprop;
+        gprop.id = "glue";
+        gprop.referenceFrame = sets.front().getProperties().referenceFrame;
+
+        auto gts(vts::createTileSet(gPath, gprop
+                                    , vts::CreateMode::overwrite));
+
+        vts::GlueCreationOptions options(addOptions_);
+        options.threadCount = threads;
+
+        const auto start(clock::now());
+        vts::TileSet::createGlue(gts, sets, options);
+        gts.flush();
+        const std::chrono::duration<double> elapsed(clock::now() - start);
+
+        std::cout << name << ": threads: " << threads
+                  << ", elapsed: " << elapsed.count() << " s" << std::endl;
+
+        // start next run with cold input caches
+        for (const auto &ts : sets) { ts.emptyCache(); }
+        return gPath;
+    });
+
+    const auto serial(vts::openTileSet(generate("serial", 1)));
+    const auto parallel(vts::openTileSet
+                        (generate("parallel", addOptions_.threadCount)));
+
+    // compare tile indices
+    std::size_t differences(0);
+    auto differs([&](const vts::TileId &tileId, const std::string &what)
+    {
+        std::cout << tileId << ": " << what << " differs" << std::endl;
+        ++differences;
+    });
+
+    const auto &sti(serial.tileIndex());
+    const auto &pti(parallel.tileIndex());
+    traverse(sti, [&](const vts::TileId &tileId, vts::QTree::value_type flags)
+    {
+        if (pti.get(tileId) != flags) { differs(tileId, "tile index"); }
+    });
+    traverse(pti, [&](const vts::TileId &tileId, vts::QTree::value_type flags)
+    {
+        if (!sti.get(tileId) && flags) { differs(tileId, "tile index"); }
+    });
+
+    // compare raw content of all files
+    auto read([](const vts::Driver &driver, const vts::TileId &tileId
+                 , vts::TileFile type) -> std::vector<char>
+    {
+        std::vector<char> buf;
+        if (auto is = driver.input(tileId, type, vts::NullWhenNotFound)) {
+            buf.resize(is->stat().size);
+            buf.resize(is->read(buf.data(), buf.size(), 0));
+        }
+        return buf;
+    });
+
+    auto compare([&](const vts::TileId &tileId, vts::TileFile type)
+    {
+        if (read(serial.driver(), tileId, type)
+            != read(parallel.driver(), tileId, type))
+        {
+            differs(tileId, boost::lexical_cast<std::string>(type));
+        }
+    });
+
+    const auto mbo(serial.referenceFrame().metaBinaryOrder);
+    std::set<vts::TileId> metaIds;
+    std::size_t tiles(0);
+    traverse(sti, [&](vts::TileId tileId, vts::QTree::value_type flags)
+    {
+        if (!(flags & vts::TileIndex::Flag::content)) { return; }
+        ++tiles;
+
+        if (flags & vts::TileIndex::Flag::mesh) {
+            compare(tileId, vts::TileFile::mesh);
+        }
+        if (flags & vts::TileIndex::Flag::atlas) {
+            compare(tileId, vts::TileFile::atlas);
+        }
+        if (flags & vts::TileIndex::Flag::navtile) {
+            compare(tileId, vts::TileFile::navtile);
+        }
+
+        // metatiles of this tile and all its ancestors
+        for (;;) {
+            metaIds.insert(vts::TileId(tileId.lod
+                                       , tileId.x & ~((1 << mbo) - 1)
+                                       , tileId.y & ~((1 << mbo) - 1)));
+            if (!tileId.lod) { break; }
+            tileId = vts::parent(tileId);
+        }
+    });
+
+    for (const auto &metaId : metaIds) {
+        compare(metaId, vts::TileFile::meta);
+    }
+
+    std::cout << "tiles: " << tiles
+              << "\nmetatiles: " << metaIds.size()
+              << "\ndifferences: " << differences << std::endl;
+
+    return differences ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 int VtsStorage::decodeTsMap()
 {
     utility::ifstreambuf is(path_.string());
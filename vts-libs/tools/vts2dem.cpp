@@ -279,13 +279,8 @@ void process(cv::Mat *data, geo::GeoDataset::Mask *mask
 
         UTILITY_OMP(task)
         {
-            auto mesh([&]() -> vts::Mesh
-            {
-                vts::Mesh m;
-                UTILITY_OMP(critical)
-                    m = ts->getMesh(tileId);
-                return m;
-            }());
+            // read-only tileset is safe for concurrent readers
+            auto mesh(ts->getMesh(tileId));
 
             const auto ni(ts->nodeInfo(tileId));
             const auto &size(config->samplesPerTile);
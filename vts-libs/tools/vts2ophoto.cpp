@@ -391,14 +391,10 @@ void process(geo::GeoDataset *dataset
 
         UTILITY_OMP(task)
         {
-            vts::Mesh mesh;
+            // read-only tileset is safe for concurrent readers
+            auto mesh(ts->getMesh(tileId));
             vts::opencv::Atlas atlas;
-
-            UTILITY_OMP(critical(Vts2Ophoto_process))
-            {
-                mesh = ts->getMesh(tileId);
-                ts->getAtlas(tileId, atlas);
-            }
+            ts->getAtlas(tileId, atlas);
 
             const auto ni(ts->nodeInfo(tileId));
             const auto &size(config->samplesPerTile);
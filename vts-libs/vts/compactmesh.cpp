@@ -0,0 +1,247 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/compactmesh.cpp
+ *
+ * Compact (quantized) mesh representation.
+ */
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "math/math.hpp"
+
+#include "compactmesh.hpp"
+
+namespace vtslibs { namespace vts {
+
+constexpr std::uint16_t CompactSubMesh::quant;
+
+namespace {
+
+inline std::uint16_t quantize(double value, double origin, double size)
+{
+    if (!size) { return 0; }
+    return std::uint16_t
+        (std::round(((value - origin) * CompactSubMesh::quant) / size));
+}
+
+inline std::uint16_t quantize(double value)
+{
+    return std::uint16_t(std::round(math::clamp(value, 0.0, 1.0)
+                                    * CompactSubMesh::quant));
+}
+
+void quantize(const math::Points2d &in, CompactSubMesh::Coordinates &out)
+{
+    out.resize(2 * in.size());
+    auto iout(out.begin());
+    for (const auto &tc : in) {
+        *iout++ = quantize(tc(0));
+        *iout++ = quantize(tc(1));
+    }
+}
+
+void dequantize(const CompactSubMesh::Coordinates &in, math::Points2d &out)
+{
+    out.resize(in.size() / 2);
+    auto iin(in.begin());
+    for (auto &tc : out) {
+        tc(0) = double(*iin++) / CompactSubMesh::quant;
+        tc(1) = double(*iin++) / CompactSubMesh::quant;
+    }
+}
+
+template <typename T>
+std::size_t memory(const std::vector<T> &v)
+{
+    return v.capacity() * sizeof(T);
+}
+
+} // namespace
+
+CompactFaces::CompactFaces(const Faces &faces)
+    : count_(faces.size())
+{
+    std::uint32_t max(0);
+    for (const auto &face : faces) {
+        max = std::max(max, std::max(face(0), std::max(face(1), face(2))));
+    }
+
+    if (max <= std::numeric_limits<std::uint16_t>::max()) {
+        narrow_.reserve(3 * faces.size());
+        for (const auto &face : faces) {
+            narrow_.push_back(face(0));
+            narrow_.push_back(face(1));
+            narrow_.push_back(face(2));
+        }
+    } else {
+        wide_.reserve(3 * faces.size());
+        for (const auto &face : faces) {
+            wide_.push_back(face(0));
+            wide_.push_back(face(1));
+            wide_.push_back(face(2));
+        }
+    }
+}
+
+CompactFaces::CompactFaces(std::vector<std::uint16_t> &&indices)
+    : count_(indices.size() / 3), narrow_(std::move(indices))
+{}
+
+std::uint32_t CompactFaces::index(std::size_t face, int vertex) const
+{
+    const auto i(3 * face + vertex);
+    return (wide_.empty() ? narrow_[i] : wide_[i]);
+}
+
+Face CompactFaces::operator[](std::size_t face) const
+{
+    return Face(index(face, 0), index(face, 1), index(face, 2));
+}
+
+Faces CompactFaces::faces() const
+{
+    Faces faces;
+    faces.reserve(count_);
+    for (std::size_t i(0); i < count_; ++i) {
+        faces.push_back(operator[](i));
+    }
+    return faces;
+}
+
+std::size_t CompactFaces::memory() const
+{
+    return vts::memory(narrow_) + vts::memory(wide_);
+}
+
+CompactSubMesh::CompactSubMesh(const SubMesh &submesh)
+    : textureMode(submesh.textureMode), textureLayer(submesh.textureLayer)
+    , surfaceReference(submesh.surfaceReference)
+    , uvAreaScale(submesh.uvAreaScale), zIndex(submesh.zIndex)
+{
+    // same processing as when saving mesh
+    const auto sm(submesh.cleanUp());
+
+    bbox = extents(sm);
+    const math::Point3d size(bbox.ur - bbox.ll);
+
+    vertices.resize(3 * sm.vertices.size());
+    auto ivertices(vertices.begin());
+    for (const auto &vertex : sm.vertices) {
+        for (int i(0); i < 3; ++i) {
+            *ivertices++ = quantize(vertex(i), bbox.ll(i), size(i));
+        }
+    }
+
+    quantize(sm.tc, tc);
+    quantize(sm.etc, etc);
+
+    faces = CompactFaces(sm.faces);
+    facesTc = CompactFaces(sm.facesTc);
+}
+
+SubMesh CompactSubMesh::submesh() const
+{
+    SubMesh sm;
+    sm.textureMode = textureMode;
+    sm.textureLayer = textureLayer;
+    sm.surfaceReference = surfaceReference;
+    sm.uvAreaScale = uvAreaScale;
+    sm.zIndex = zIndex;
+
+    sm.vertices.resize(vertexCount());
+    for (std::size_t i(0), e(sm.vertices.size()); i < e; ++i) {
+        sm.vertices[i] = vertex(i);
+    }
+
+    dequantize(tc, sm.tc);
+    dequantize(etc, sm.etc);
+
+    sm.faces = faces.faces();
+    sm.facesTc = facesTc.faces();
+
+    return sm;
+}
+
+math::Point3d CompactSubMesh::vertex(std::size_t index) const
+{
+    // same arithmetic as mesh loader
+    const auto *q(&vertices[3 * index]);
+    math::Point3d v;
+    for (int i(0); i < 3; ++i) {
+        v(i) = bbox.ll(i) + ((q[i] * (bbox.ur(i) - bbox.ll(i))) / quant);
+    }
+    return v;
+}
+
+math::Point2d CompactSubMesh::texCoord(std::size_t index) const
+{
+    return math::Point2d(double(tc[2 * index]) / quant
+                         , double(tc[2 * index + 1]) / quant);
+}
+
+math::Point2d CompactSubMesh::externalTexCoord(std::size_t index) const
+{
+    return math::Point2d(double(etc[2 * index]) / quant
+                         , double(etc[2 * index + 1]) / quant);
+}
+
+std::size_t CompactSubMesh::memory() const
+{
+    return (sizeof(*this) + vts::memory(vertices) + vts::memory(tc)
+            + vts::memory(etc) + faces.memory() + facesTc.memory());
+}
+
+CompactMesh::CompactMesh(bool fullyCovered)
+    : coverageMask(Mesh::coverageOrder, fullyCovered)
+{}
+
+CompactMesh::CompactMesh(const Mesh &mesh)
+    : submeshes(mesh.submeshes.begin(), mesh.submeshes.end())
+    , coverageMask(mesh.coverageMask)
+{}
+
+Mesh CompactMesh::mesh() const
+{
+    Mesh mesh;
+    mesh.coverageMask = coverageMask;
+    mesh.submeshes.reserve(submeshes.size());
+    for (const auto &sm : submeshes) {
+        mesh.submeshes.push_back(sm.submesh());
+    }
+    return mesh;
+}
+
+std::size_t CompactMesh::memory() const
+{
+    std::size_t total(sizeof(*this));
+    for (const auto &sm : submeshes) { total += sm.memory(); }
+    return total;
+}
+
+} } // namespace vtslibs::vts
@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/compactmesh.hpp
+ *
+ * Compact (quantized) mesh representation.
+ */
+
+#ifndef vtslibs_vts_compactmesh_hpp
+#define vtslibs_vts_compactmesh_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include "mesh.hpp"
+
+namespace vtslibs { namespace vts {
+
+/** Face indices stored as flat array of 16 bit indices if all indices fit,
+ *  otherwise as flat array of 32 bit indices.
+ */
+class CompactFaces {
+public:
+    CompactFaces() : count_() {}
+
+    /** Builds compact faces from regular faces.
+     */
+    explicit CompactFaces(const Faces &faces);
+
+    /** Takes ownership of flat array of 16 bit indices (index triplets).
+     */
+    explicit CompactFaces(std::vector<std::uint16_t> &&indices);
+
+    std::size_t size() const { return count_; }
+    bool empty() const { return !count_; }
+
+    /** Returns true if indices are stored in 16 bits.
+     */
+    bool narrow() const { return wide_.empty(); }
+
+    /** Index of given face's vertex.
+     */
+    std::uint32_t index(std::size_t face, int vertex) const;
+
+    Face operator[](std::size_t face) const;
+
+    /** Converts back to regular faces.
+     */
+    Faces faces() const;
+
+    /** Memory occupied by indices (in bytes).
+     */
+    std::size_t memory() const;
+
+private:
+    std::size_t count_;
+    std::vector<std::uint16_t> narrow_;
+    std::vector<std::uint32_t> wide_;
+};
+
+/** Compact submesh.
+ *
+ *  Vertices are quantized to 16 bits inside submesh bounding box, texture
+ *  coordinates are quantized to 16 bits inside [0, 1]. This is exactly the
+ *  precision of mesh format version 2 (default format) therefore mesh loaded
+ *  into compact submesh and saved again is bit-identical.
+ *
+ *  Uses ~4 times less memory than SubMesh.
+ *
+ *  All coordinates are stored in flat arrays:
+ *
+ *      vertex(i) = bbox.ll(i) + (bbox.ur(i) - bbox.ll(i))
+ *                               * vertices[3 * index + i] / 65535
+ *      tc(i) = tc[2 * index + i] / 65535
+ *      etc(i) = etc[2 * index + i] / 65535
+ */
+struct CompactSubMesh {
+    typedef std::vector<CompactSubMesh> list;
+    typedef std::vector<std::uint16_t> Coordinates;
+
+    /** Quantization range.
+     */
+    static constexpr std::uint16_t quant = 0xffff;
+
+    /** Vertex quantization box.
+     */
+    math::Extents3 bbox;
+
+    /** Quantized vertices, 3 values per vertex.
+     */
+    Coordinates vertices;
+
+    /** Quantized internal texture coordinates, 2 values per coordinate.
+     */
+    Coordinates tc;
+
+    /** Quantized external texture coordinates, 2 values per vertex.
+     */
+    Coordinates etc;
+
+    /** Indices to face vertices.
+     */
+    CompactFaces faces;
+
+    /** Indices to internal texture coordinates.
+     */
+    CompactFaces facesTc;
+
+    SubMesh::TextureMode textureMode;
+    boost::optional<std::uint16_t> textureLayer;
+    SubMesh::SurfaceReference surfaceReference;
+    double uvAreaScale;
+    SubMesh::ZIndex zIndex;
+
+    CompactSubMesh()
+        : textureMode(SubMesh::TextureMode::internal), surfaceReference(1)
+        , uvAreaScale(1.0), zIndex()
+    {}
+
+    /** Quantizes given submesh. Submesh is cleaned up (see SubMesh::cleanUp)
+     *  before quantization exactly as when saving it to a file.
+     */
+    explicit CompactSubMesh(const SubMesh &submesh);
+
+    /** Dequantizes to regular submesh.
+     */
+    SubMesh submesh() const;
+
+    std::size_t vertexCount() const { return vertices.size() / 3; }
+    std::size_t tcCount() const { return tc.size() / 2; }
+    bool empty() const { return vertices.empty(); }
+
+    /** Dequantized vertex.
+     */
+    math::Point3d vertex(std::size_t index) const;
+
+    /** Dequantized internal texture coordinate.
+     */
+    math::Point2d texCoord(std::size_t index) const;
+
+    /** Dequantized external texture coordinate.
+     */
+    math::Point2d externalTexCoord(std::size_t index) const;
+
+    /** Memory occupied by this submesh's data (in bytes).
+     */
+    std::size_t memory() const;
+};
+
+/** Compact mesh with submeshes and mask.
+ */
+struct CompactMesh {
+    CompactSubMesh::list submeshes;
+    Mesh::CoverageMask coverageMask;
+
+    CompactMesh(bool fullyCovered = true);
+
+    /** Quantizes given mesh.
+     */
+    explicit CompactMesh(const Mesh &mesh);
+
+    /** Dequantizes to regular mesh.
+     */
+    Mesh mesh() const;
+
+    std::size_t size() const { return submeshes.size(); }
+    bool empty() const { return submeshes.empty(); }
+
+    /** Memory occupied by this mesh's data (in bytes).
+     */
+    std::size_t memory() const;
+};
+
+/** Loads compact mesh from mesh file. Mesh proper is decoded directly into
+ *  quantized form.
+ *
+ * \param in input stream
+ * \param path file path (informative)
+ * \param memory stream content in memory (optional)
+ */
+CompactMesh loadCompactMesh(std::istream &in
+                            , const boost::filesystem::path &path
+                            , const boost::optional<storage::ReadOnlyMemory>
+                            &memory = boost::none);
+
+CompactMesh loadCompactMesh(const storage::IStream::pointer &in);
+
+CompactMesh loadCompactMesh(const boost::filesystem::path &path);
+
+/** Saves compact mesh to mesh file. Mesh proper is always written in version
+ *  2 (quantized data are written as-is).
+ */
+void saveCompactMesh(std::ostream &out, const CompactMesh &mesh);
+
+void saveCompactMesh(const boost::filesystem::path &path
+                     , const CompactMesh &mesh);
+
+} } // namespace vtslibs::vts
+
+#endif // vtslibs_vts_compactmesh_hpp
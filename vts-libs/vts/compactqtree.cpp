@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <algorithm>
+
+#include "dbglog/dbglog.hpp"
+
+#include "../storage/error.hpp"
+
+#include "compactqtree.hpp"
+
+namespace vtslibs { namespace vts {
+
+namespace {
+
+/** QTree::convert converter building compact node array.
+ */
+template <typename Node>
+class Builder {
+public:
+    typedef std::vector<Node> Nodes;
+
+    Builder(Nodes &nodes) : nodes_(nodes), current_() {
+        nodes_.clear();
+    }
+
+    void root(const QTree::opt_value_type &value) {
+        nodes_.emplace_back(value ? *value : 0);
+    }
+
+    std::uint32_t children(const QTree::opt_value_type &ul
+                           , const QTree::opt_value_type &ur
+                           , const QTree::opt_value_type &ll
+                           , const QTree::opt_value_type &lr)
+    {
+        const std::uint32_t block(nodes_.size());
+        nodes_[current_].children = block;
+        for (const auto *value : { &ul, &ur, &ll, &lr }) {
+            // inner nodes get their children index in their children() call
+            nodes_.emplace_back(*value ? **value : 0);
+        }
+        return block;
+    }
+
+    void enter(std::uint32_t block, int nodeIndex) {
+        stack_.push_back(current_);
+        current_ = block + nodeIndex;
+    }
+
+    void leave(std::uint32_t, int) {
+        current_ = stack_.back();
+        stack_.pop_back();
+    }
+
+private:
+    Nodes &nodes_;
+    std::uint32_t current_;
+    std::vector<std::uint32_t> stack_;
+};
+
+} // namespace
+
+CompactQTree::CompactQTree(unsigned int order, value_type value)
+    : order_(order), size_(1 << order), nodes_(1, Node(value))
+    , count_(value ? (std::size_t(size_) * size_) : 0)
+    , allSetFlags_(value)
+{}
+
+CompactQTree::CompactQTree(const QTree &tree)
+    : order_(tree.order()), size_(1 << order_), count_(), allSetFlags_()
+{
+    Builder<Node> builder(nodes_);
+    tree.convert(builder);
+    nodes_.shrink_to_fit();
+    recount();
+}
+
+QTree CompactQTree::qtree() const
+{
+    QTree tree(order_);
+    forEachNode([&](unsigned int x, unsigned int y, unsigned int size
+                    , value_type value)
+    {
+        tree.set(x, y, x + size - 1, y + size - 1, value);
+    }, Filter::white);
+    return tree;
+}
+
+CompactQTreeView::value_type
+CompactQTreeView::get(unsigned int depth, unsigned int x, unsigned int y)
+    const
+{
+    // not trimming -> regular get
+    if (depth >= order_) {
+        // too deep, move up
+        return get(x >> (depth - order_), y >> (depth - order_));
+    }
+
+    // get in trimmed tree
+    return getSized(1 << depth, x, y);
+}
+
+std::uint32_t CompactQTreeView::find(unsigned int depth
+                                     , unsigned int x, unsigned int y) const
+{
+    std::uint32_t index(0);
+    // descend while both tree and depth allow
+    while (depth && !nodes_[index].leaf()) {
+        --depth;
+        unsigned int mask(1 << depth);
+        index = (children(nodes_[index])
+                 + (((x & mask) ? 1 : 0) | ((y & mask) ? 2 : 0)));
+    }
+    return index;
+}
+
+void CompactQTreeView::invalidChildren(const Node &node) const
+{
+    LOGTHROW(err1, storage::BadFileFormat)
+        << "Compact quad tree node references children block at "
+        << node.children << " outside of " << nodeCount_ << " nodes.";
+}
+
+CompactQTree::Node CompactQTree::contract(Nodes &out, std::uint32_t block)
+{
+    const auto value(out[block].value);
+    for (std::uint32_t i(0); i < 4; ++i) {
+        const auto &node(out[block + i]);
+        if (!node.leaf() || (node.value != value)) {
+            // cannot contract
+            Node res;
+            res.children = block;
+            return res;
+        }
+    }
+
+    // all 4 children are the same leaf -> drop block (nothing follows it)
+    out.resize(block);
+    return Node(value);
+}
+
+void CompactQTree::recount()
+{
+    std::size_t count(0);
+    value_type flags(0);
+    forEachNode([&](unsigned int, unsigned int, unsigned int size
+                    , value_type value)
+    {
+        count += std::size_t(size) * size;
+        flags |= value;
+    }, Filter::white);
+    count_ = count;
+    allSetFlags_ = flags;
+}
+
+std::size_t CompactQTree::memory() const
+{
+    return sizeof(*this) + nodes_.capacity() * sizeof(Node);
+}
+
+} } // namespace vtslibs::vts
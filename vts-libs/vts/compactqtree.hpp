@@ -0,0 +1,473 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/compactqtree.hpp
+ *
+ * Compact (pointerless) quad tree representation.
+ */
+
+#ifndef vtslibs_vts_compactqtree_hpp_included_
+#define vtslibs_vts_compactqtree_hpp_included_
+
+#include <cstdint>
+#include <vector>
+
+#include "qtree.hpp"
+
+namespace vtslibs { namespace vts {
+
+/** Read-only view of compact quad tree node array owned by someone else (e.g.
+ *  CompactQTree or memory-mapped file).
+ *
+ *  Children of inner node are stored as a block of 4 consecutive nodes (ul,
+ *  ur, ll, lr) and node references its children block by index. Blocks are
+ *  laid out in depth-first order, i.e. every subtree occupies contiguous part
+ *  of the array.
+ *
+ *  Semantics of all operations mirror their QTree counterparts.
+ */
+class CompactQTreeView {
+public:
+    typedef QTree::value_type value_type;
+    typedef QTree::Filter Filter;
+
+    /** Tree node. Layout is part of the MappedTileIndex on-disk format.
+     */
+    struct Node {
+        value_type value;
+
+        /** Index of first child; 0 (i.e. root's index) marks leaf.
+         */
+        std::uint32_t children;
+
+        Node(value_type value = 0) : value(value), children() {}
+
+        bool leaf() const { return !children; }
+    };
+
+    /** Creates view of given node array. Child block referenced outside of
+     *  the array (e.g. in truncated or corrupted file) is reported by
+     *  storage::BadFileFormat when reached.
+     */
+    CompactQTreeView(unsigned int order, const Node *nodes
+                     , std::size_t nodeCount)
+        : order_(order), size_(1 << order), nodes_(nodes)
+        , nodeCount_(nodeCount)
+    {}
+
+    /** Read value from pixel at (x, y).
+     */
+    value_type get(unsigned int x, unsigned int y) const;
+
+    /** Read value from pixel from node (x, y) in tree reduced to given depth.
+     *  Same semantics as QTree::get(depth, x, y).
+     */
+    value_type get(unsigned int depth, unsigned int x, unsigned int y) const;
+
+    /** Runs op(x, y, xsize, value) for each node based on filter.
+     */
+    template <typename Op>
+    void forEachNode(const Op &op, Filter filter = Filter::both) const;
+
+    /** Runs op(x, y, xsize, value) for each node based on filter in subtree
+     *  starting at given index.
+     */
+    template <typename Op>
+    void forEachNode(unsigned int depth, unsigned int x, unsigned int y
+                     , const Op &op, Filter filter = Filter::both) const;
+
+    /** Runs op(x, y, value) for each element based on filter.
+     */
+    template <typename Op>
+    void forEach(const Op &op, Filter filter = Filter::both) const;
+
+    unsigned int order() const { return order_; }
+
+    math::Size2 size() const { return math::Size2(size_, size_); }
+
+    const Node* nodes() const { return nodes_; }
+
+    std::size_t nodeCount() const { return nodeCount_; }
+
+private:
+    template <typename Op>
+    void descend(std::uint32_t index, unsigned int mask
+                 , unsigned int x, unsigned int y
+                 , const Op &op, Filter filter) const;
+
+    /** Index of node covering (x, y) in tree trimmed to given depth.
+     */
+    std::uint32_t find(unsigned int depth, unsigned int x, unsigned int y)
+        const;
+
+    /** Value at (x, y) in tree (possibly trimmed) of given size.
+     */
+    value_type getSized(unsigned int size, unsigned int x, unsigned int y)
+        const;
+
+    /** Index of inner node's children block, checked against node count.
+     */
+    std::uint32_t children(const Node &node) const;
+
+    /** Throws storage::BadFileFormat.
+     */
+    void invalidChildren(const Node &node) const;
+
+    unsigned int order_;
+    unsigned int size_;
+    const Node *nodes_;
+    std::size_t nodeCount_;
+};
+
+static_assert(sizeof(CompactQTreeView::Node) == 8
+              , "Unexpected size of compact quad tree node.");
+
+/** Read-mostly quad tree stored in one flat node array (see
+ *  CompactQTreeView for layout). Node occupies 8 bytes and there are no
+ *  per-node heap allocations.
+ */
+class CompactQTree {
+public:
+    typedef QTree::value_type value_type;
+    typedef QTree::Filter Filter;
+
+    CompactQTree(unsigned int order = 0, value_type value = 0);
+
+    /** Converts regular quad tree into compact one.
+     */
+    explicit CompactQTree(const QTree &tree);
+
+    /** Converts compact quad tree back to regular one.
+     */
+    QTree qtree() const;
+
+    /** Read-only view of this tree.
+     */
+    CompactQTreeView view() const {
+        return CompactQTreeView(order_, nodes_.data(), nodes_.size());
+    }
+
+    /** Read value from pixel at (x, y).
+     */
+    value_type get(unsigned int x, unsigned int y) const {
+        return view().get(x, y);
+    }
+
+    /** Read value from pixel from node (x, y) in tree reduced to given depth.
+     *  Same semantics as QTree::get(depth, x, y).
+     */
+    value_type get(unsigned int depth, unsigned int x, unsigned int y) const {
+        return view().get(depth, x, y);
+    }
+
+    /** Runs op(x, y, xsize, value) for each node based on filter.
+     */
+    template <typename Op>
+    void forEachNode(const Op &op, Filter filter = Filter::both) const {
+        view().forEachNode(op, filter);
+    }
+
+    /** Runs op(x, y, xsize, value) for each node based on filter in subtree
+     *  starting at given index.
+     */
+    template <typename Op>
+    void forEachNode(unsigned int depth, unsigned int x, unsigned int y
+                     , const Op &op, Filter filter = Filter::both) const
+    {
+        view().forEachNode(depth, x, y, op, filter);
+    }
+
+    /** Runs op(x, y, value) for each element based on filter.
+     */
+    template <typename Op>
+    void forEach(const Op &op, Filter filter = Filter::both) const {
+        view().forEach(op, filter);
+    }
+
+    /** Merge nodes. Same semantics as QTree::merge.
+     */
+    template <typename FilterOp>
+    void merge(const CompactQTree &other, const FilterOp &filter);
+
+    /** Returns number of non-zero elements.
+     */
+    std::size_t count() const { return count_; }
+
+    /** Returns true if there is no non-zero element.
+     */
+    bool empty() const { return !count_; }
+
+    /** Returns true if there is no zero element.
+     */
+    bool full() const { return count_ == std::size_t(size_) * size_; }
+
+    unsigned int order() const { return order_; }
+
+    math::Size2 size() const { return math::Size2(size_, size_); }
+
+    /** Return all set flags.
+     */
+    value_type allSetFlags() const { return allSetFlags_; }
+
+    /** Number of nodes (both inner nodes and leaves).
+     */
+    std::size_t nodeCount() const { return nodes_.size(); }
+
+    /** Memory occupied by the tree (in bytes).
+     */
+    std::size_t memory() const;
+
+    void swap(CompactQTree &other);
+
+private:
+    typedef CompactQTreeView::Node Node;
+    typedef std::vector<Node> Nodes;
+
+    enum Type { black, white, gray };
+
+    template <typename FilterOp>
+    static Type type(const Node &node, const FilterOp &filter) {
+        if (!node.leaf()) { return Type::gray; }
+        return filter(node.value) ? Type::white : Type::black;
+    }
+
+    /** Copies subtree of node at given index in given tree to the end of
+     *  given node array. Values of nodes that do not satisfy the filter are
+     *  set to 0 if filterOut is true. Returns node to be stored in parent's
+     *  slot.
+     */
+    template <typename FilterOp>
+    static Node copy(Nodes &out, const Nodes &nodes, std::uint32_t index
+                     , const FilterOp &filter, bool filterOut);
+
+    template <typename FilterOp>
+    static Node merge(Nodes &out, const Nodes &a, std::uint32_t ai
+                      , const Nodes &b, std::uint32_t bi
+                      , const FilterOp &filter);
+
+    /** Replaces freshly built children block at index with one leaf if all
+     *  children are leaves with the same value.
+     */
+    static Node contract(Nodes &out, std::uint32_t block);
+
+    void recount();
+
+    unsigned int order_;
+    unsigned int size_;
+    Nodes nodes_;
+    std::size_t count_;
+    value_type allSetFlags_;
+};
+
+// inlines
+
+inline std::uint32_t CompactQTreeView::children(const Node &node) const
+{
+    if ((std::size_t(node.children) + 3) >= nodeCount_) {
+        invalidChildren(node);
+    }
+    return node.children;
+}
+
+inline CompactQTreeView::value_type
+CompactQTreeView::getSized(unsigned int size, unsigned int x, unsigned int y)
+    const
+{
+    // size check
+    if ((x >= size) || (y >= size)) { return 0; }
+
+    std::uint32_t index(0);
+    for (unsigned int mask(size >> 1);; mask >>= 1) {
+        const auto &node(nodes_[index]);
+        if (node.leaf()) { return node.value; }
+        if (!mask) { return ~value_type(0); }
+        index = children(node) + (((x & mask) ? 1 : 0) | ((y & mask) ? 2 : 0));
+    }
+}
+
+inline CompactQTreeView::value_type CompactQTreeView::get(unsigned int x
+                                                          , unsigned int y)
+    const
+{
+    return getSized(size_, x, y);
+}
+
+template <typename Op>
+void CompactQTreeView::descend(std::uint32_t index, unsigned int mask
+                           , unsigned int x, unsigned int y
+                           , const Op &op, Filter filter) const
+{
+    const auto &node(nodes_[index]);
+    if (!node.leaf()) {
+        // process children if allowed by depth
+        if (auto nmask = (mask >> 1)) {
+            const auto c(children(node));
+            descend(c, nmask, x, y, op, filter);
+            descend(c + 1, nmask, x + nmask, y, op, filter);
+            descend(c + 2, nmask, x, y + nmask, op, filter);
+            descend(c + 3, nmask, x + nmask, y + nmask, op, filter);
+        }
+        return;
+    }
+
+    switch (filter) {
+    case Filter::black: if (node.value) { return; }; break;
+    case Filter::white: if (!node.value) { return; }; break;
+    default: break;
+    }
+
+    // call operation for node
+    op(x, y, mask, node.value);
+}
+
+template <typename Op>
+inline void CompactQTreeView::forEachNode(const Op &op, Filter filter) const
+{
+    descend(0, size_, 0, 0, op, filter);
+}
+
+template <typename Op>
+inline void CompactQTreeView::forEachNode(unsigned int depth
+                                          , unsigned int x, unsigned int y
+                                          , const Op &op, Filter filter) const
+{
+    auto subdepth((depth < order_) ? (order_ - depth) : 1);
+    descend(find(depth, x, y), 1 << subdepth, 0, 0, op, filter);
+}
+
+template <typename Op>
+inline void CompactQTreeView::forEach(const Op &op, Filter filter) const
+{
+    forEachNode([&](unsigned int x, unsigned int y, unsigned int size
+                    , value_type value)
+    {
+        // rasterize node
+        unsigned int ex(x + size);
+        unsigned int ey(y + size);
+
+        for (unsigned int j(y); j < ey; ++j) {
+            for (unsigned int i(x); i < ex; ++i) {
+                op(i, j, value);
+            }
+        }
+    }, filter);
+}
+
+template <typename FilterOp>
+CompactQTree::Node CompactQTree::copy(Nodes &out, const Nodes &nodes
+                                      , std::uint32_t index
+                                      , const FilterOp &filter
+                                      , bool filterOut)
+{
+    const auto &node(nodes[index]);
+    if (node.leaf()) {
+        // BLACK -> zero
+        if (filterOut && !filter(node.value)) { return Node(0); }
+        return node;
+    }
+
+    // allocate children block and fill it
+    const std::uint32_t block(out.size());
+    out.resize(block + 4);
+    for (std::uint32_t i(0); i < 4; ++i) {
+        const auto child(copy(out, nodes, node.children + i
+                              , filter, filterOut));
+        out[block + i] = child;
+    }
+
+    if (filterOut) { return contract(out, block); }
+
+    Node res;
+    res.children = block;
+    return res;
+}
+
+template <typename FilterOp>
+CompactQTree::Node CompactQTree::merge(Nodes &out
+                                       , const Nodes &a, std::uint32_t ai
+                                       , const Nodes &b, std::uint32_t bi
+                                       , const FilterOp &filter)
+{
+    const auto &an(a[ai]);
+    const auto &bn(b[bi]);
+    const auto tt(type(an, filter));
+    const auto ot(type(bn, filter));
+
+    if ((tt == Type::white) || (ot == Type::black)) {
+        // merge(WHITE, anything) = WHITE (keep)
+        // merge(anything, BLACK) = anything (keep)
+        return copy(out, a, ai, filter, false);
+    }
+
+    if (ot == Type::white) {
+        // merge(anything, WHITE) = WHITE
+        return bn;
+    }
+
+    // OK, other is gray
+    if (tt == Type::black) {
+        // merge(BLACK, GRAY) = GRAY
+        return copy(out, b, bi, filter, true);
+    }
+
+    // merge(GRAY, GRAY) = go down
+    const std::uint32_t block(out.size());
+    out.resize(block + 4);
+    for (std::uint32_t i(0); i < 4; ++i) {
+        const auto child(merge(out, a, an.children + i
+                               , b, bn.children + i, filter));
+        out[block + i] = child;
+    }
+
+    // contract if possible
+    return contract(out, block);
+}
+
+template <typename FilterOp>
+void CompactQTree::merge(const CompactQTree &other, const FilterOp &filter)
+{
+    Nodes out(1);
+    out.reserve(std::max(nodes_.size(), other.nodes_.size()));
+    const auto root(merge(out, nodes_, 0, other.nodes_, 0, filter));
+    out[0] = root;
+    out.shrink_to_fit();
+
+    nodes_.swap(out);
+    recount();
+}
+
+inline void CompactQTree::swap(CompactQTree &other)
+{
+    std::swap(order_, other.order_);
+    std::swap(size_, other.size_);
+    nodes_.swap(other.nodes_);
+    std::swap(count_, other.count_);
+    std::swap(allSetFlags_, other.allSetFlags_);
+}
+
+} } // namespace vtslibs::vts
+
+#endif // vtslibs_vts_compactqtree_hpp_included_
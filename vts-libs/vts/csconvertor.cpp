@@ -23,6 +23,15 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+
+#include "utility/openmp.hpp"
+
 #include "csconvertor.hpp"
 
 namespace vtslibs { namespace vts {
@@ -227,4 +236,194 @@ math::Extents2 CsConvertor::operator()(const math::Extents2 &e) const
     return out;
 }
 
+void CsConvertor::convert(math::Point3 *points, std::size_t count) const
+{
+    // no conversion needed if no convertor present
+    if (!conv_) { return; }
+
+    // un-vert-adjusts -> converts -> vert-adjusts
+    const auto &conv(*conv_);
+    for (auto *p(points), *e(points + count); p != e; ++p) {
+        *p = dstAdjuster_(conv(srcAdjuster_(*p, true)));
+    }
+}
+
+void CsConvertor::convert(math::Point2 *points, std::size_t count) const
+{
+    // no conversion needed if no convertor present
+    if (!conv_) { return; }
+
+    // since z-component is zero -> nothing to adjust
+    const auto &conv(*conv_);
+    for (auto *p(points), *e(points + count); p != e; ++p) {
+        *p = conv(*p);
+    }
+}
+
+const CsConvertor& CsConvertor::noop()
+{
+    static const CsConvertor noop;
+    return noop;
+}
+
+namespace {
+
+struct CacheKey {
+    const registry::Registry *reg;
+    std::string srsIdFrom;
+    std::string srsIdTo;
+
+    CacheKey(const registry::Registry *reg, const std::string &srsIdFrom
+             , const std::string &srsIdTo)
+        : reg(reg), srsIdFrom(srsIdFrom), srsIdTo(srsIdTo)
+    {}
+
+    bool operator<(const CacheKey &o) const {
+        if (reg < o.reg) { return true; }
+        if (o.reg < reg) { return false; }
+        if (srsIdFrom < o.srsIdFrom) { return true; }
+        if (o.srsIdFrom < srsIdFrom) { return false; }
+        return srsIdTo < o.srsIdTo;
+    }
+
+    bool matches(const registry::Registry *r, const std::string &from
+                 , const std::string &to) const
+    {
+        return (reg == r) && (srsIdFrom == from) && (srsIdTo == to);
+    }
+};
+
+typedef std::map<CacheKey, CsConvertor> ConvertorCache;
+
+std::atomic<std::size_t> cacheBuilt(0);
+
+/** Per-thread hit counter. Incremented only by its own thread (no shared
+ *  cache line on the fast path), summed on demand by csConvertorCacheStats().
+ *  Counts of finished threads are kept in retiredHits.
+ */
+struct HitCounter {
+    std::atomic<std::size_t> hits;
+
+    HitCounter();
+    ~HitCounter();
+
+    void hit() {
+        hits.store(hits.load(std::memory_order_relaxed) + 1
+                   , std::memory_order_relaxed);
+    }
+};
+
+std::mutex countersMutex;
+std::set<const HitCounter*> counters;
+std::size_t retiredHits(0);
+
+HitCounter::HitCounter()
+    : hits(0)
+{
+    std::lock_guard<std::mutex> lock(countersMutex);
+    counters.insert(this);
+}
+
+HitCounter::~HitCounter()
+{
+    std::lock_guard<std::mutex> lock(countersMutex);
+    retiredHits += hits;
+    counters.erase(this);
+}
+
+} // namespace
+
+const CsConvertor& cachedCsConvertor(const std::string &srsIdFrom
+                                     , const std::string &srsIdTo
+                                     , const registry::Registry &reg)
+{
+    thread_local ConvertorCache cache;
+    // last used entry, callers usually ask for the same convertor repeatedly
+    thread_local ConvertorCache::const_iterator last(cache.end());
+    thread_local HitCounter hits;
+
+    if ((last != cache.end()) && last->first.matches(&reg, srsIdFrom, srsIdTo))
+    {
+        hits.hit();
+        return last->second;
+    }
+
+    CacheKey key(&reg, srsIdFrom, srsIdTo);
+    auto fcache(cache.find(key));
+    if (fcache == cache.end()) {
+        fcache = cache.insert
+            (ConvertorCache::value_type
+             (key, CsConvertor(srsIdFrom, srsIdTo, reg))).first;
+        ++cacheBuilt;
+    } else {
+        hits.hit();
+    }
+
+    last = fcache;
+    return fcache->second;
+}
+
+CsConvertorCacheStats csConvertorCacheStats()
+{
+    CsConvertorCacheStats stats;
+    stats.built = cacheBuilt;
+
+    std::lock_guard<std::mutex> lock(countersMutex);
+    stats.hits = retiredHits;
+    for (const auto *counter : counters) { stats.hits += counter->hits; }
+    return stats;
+}
+
+namespace {
+
+template <typename Point>
+void csConvertImpl(const std::string &srsIdFrom, const std::string &srsIdTo
+                   , Point *points, std::size_t count
+                   , const registry::Registry &reg
+                   , std::size_t parallelThreshold)
+{
+    if (!parallelThreshold || (count < parallelThreshold)) {
+        return cachedCsConvertor(srsIdFrom, srsIdTo, reg)
+            .convert(points, count);
+    }
+
+    // split into chunks, each thread uses its own convertor
+    const std::size_t chunk(1 << 12);
+    const std::size_t chunks((count + chunk - 1) / chunk);
+
+    std::exception_ptr error;
+
+    UTILITY_OMP(parallel for)
+    for (std::size_t i = 0; i < chunks; ++i) {
+        try {
+            const auto begin(i * chunk);
+            cachedCsConvertor(srsIdFrom, srsIdTo, reg)
+                .convert(points + begin, std::min(chunk, count - begin));
+        } catch (...) {
+            UTILITY_OMP(critical(vts_csConvert))
+            if (!error) { error = std::current_exception(); }
+        }
+    }
+
+    if (error) { std::rethrow_exception(error); }
+}
+
+} // namespace
+
+void csConvert(const std::string &srsIdFrom, const std::string &srsIdTo
+               , math::Point3 *points, std::size_t count
+               , const registry::Registry &reg
+               , std::size_t parallelThreshold)
+{
+    csConvertImpl(srsIdFrom, srsIdTo, points, count, reg, parallelThreshold);
+}
+
+void csConvert(const std::string &srsIdFrom, const std::string &srsIdTo
+               , math::Point2 *points, std::size_t count
+               , const registry::Registry &reg
+               , std::size_t parallelThreshold)
+{
+    csConvertImpl(srsIdFrom, srsIdTo, points, count, reg, parallelThreshold);
+}
+
 } } // namespace vtslibs::vts
@@ -117,6 +117,30 @@ public:
      */
     math::Point2 operator()(const math::Point2 &p) const;
 
+    /** Converts array of points in place. Same as calling operator() on each
+     *  point but checks are done only once per array.
+     *
+     * \param points first point
+     * \param count number of points
+     */
+    void convert(math::Point3 *points, std::size_t count) const;
+
+    /** Converts array of 2D points in place. Same as calling operator() on
+     *  each point but checks are done only once per array.
+     *
+     * \param points first point
+     * \param count number of points
+     */
+    void convert(math::Point2 *points, std::size_t count) const;
+
+    /** Converts all points in place.
+     */
+    void convert(math::Points3 &points) const;
+
+    /** Converts all 2D points in place.
+     */
+    void convert(math::Points2 &points) const;
+
     /** Returns bounding box of all 8 corners converted to TO SRS.
      */
     math::Extents3 operator()(const math::Extents3 &e) const;
@@ -129,6 +153,10 @@ public:
      */
     operator bool() const { return bool(conv_); }
 
+    /** Shared no-op convertor.
+     */
+    static const CsConvertor& noop();
+
 private:
     /** Helper constructor for conversion inversion.
      */
@@ -164,6 +192,73 @@ private:
     geo::VerticalAdjuster dstAdjuster_;
 };
 
+/** Returns convertor between two SRS specified as keys to given registry.
+ *
+ *  Convertors are cached per thread and keyed by (srsIdFrom, srsIdTo,
+ *  registry), i.e. each thread builds given convertor only once. Returned
+ *  reference is valid until calling thread ends and must not be passed to
+ *  other threads.
+ *
+ *  Registry is identified by its address; it must outlive any thread that
+ *  uses it here.
+ */
+const CsConvertor& cachedCsConvertor(const std::string &srsIdFrom
+                                     , const std::string &srsIdTo
+                                     , const registry::Registry &reg
+                                     = registry::system);
+
+/** Convertor cache statistics (over all threads).
+ */
+struct CsConvertorCacheStats {
+    /** Number of convertors built by the cache.
+     */
+    std::size_t built;
+
+    /** Number of requests served from the cache.
+     */
+    std::size_t hits;
+
+    CsConvertorCacheStats() : built(), hits() {}
+};
+
+CsConvertorCacheStats csConvertorCacheStats();
+
+/** Default minimal number of points to split conversion between threads.
+ */
+constexpr std::size_t CsConvertParallelThreshold = 1 << 14;
+
+/** Converts array of points in place between two SRS specified as keys to
+ *  given registry.
+ *
+ *  Arrays of at least parallelThreshold points are split between OpenMP
+ *  threads; each thread uses its own cached convertor (see
+ *  cachedCsConvertor). Pass 0 to disable parallel processing.
+ */
+void csConvert(const std::string &srsIdFrom, const std::string &srsIdTo
+               , math::Point3 *points, std::size_t count
+               , const registry::Registry &reg = registry::system
+               , std::size_t parallelThreshold = CsConvertParallelThreshold);
+
+/** Converts array of 2D points in place between two SRS specified as keys
+ *  to given registry. See 3D version for details.
+ */
+void csConvert(const std::string &srsIdFrom, const std::string &srsIdTo
+               , math::Point2 *points, std::size_t count
+               , const registry::Registry &reg = registry::system
+               , std::size_t parallelThreshold = CsConvertParallelThreshold);
+
+// inlines
+
+inline void CsConvertor::convert(math::Points3 &points) const
+{
+    convert(points.data(), points.size());
+}
+
+inline void CsConvertor::convert(math::Points2 &points) const
+{
+    convert(points.data(), points.size());
+}
+
 } } // namespace vtslibs::vts
 
 #endif // geo_vtslibs_vts_csconvert_hpp_included_
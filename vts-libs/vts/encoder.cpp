@@ -137,7 +137,12 @@ struct Encoder::Detail {
             process({}, ConstraintsFlag::build(constraints)
                     , NodeInfo(referenceFrame), {});
         }
-        LOG(info3) << "VTS Encoder: generated. Finishing.";
+        {
+            const auto stats(csConvertorCacheStats());
+            LOG(info3) << "VTS Encoder: generated. Finishing. (CS convertors "
+                       << "built: " << stats.built << ", reused: "
+                       << stats.hits << ").";
+        }
 
         // let the caller finish the tileset
         owner->finish(tileSet);
@@ -318,8 +323,11 @@ void Encoder::Detail::process(const TileId &tileId
             if (result == TileResult::Result::tile) {
                 const auto &t(tile.tile());
 
+                // encode in parallel, only store in critical section
+                const auto prepared(tileSet.prepareTile(tileId, t, nodeInfo));
+
                 UTILITY_OMP(critical)
-                tileSet.setTile(tileId, t, nodeInfo);
+                tileSet.commitTile(prepared);
 
                 hasMesh = bool(t.mesh);
             } else {
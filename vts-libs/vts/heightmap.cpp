@@ -25,7 +25,17 @@
  */
 
 #include <cmath>
+#include <cerrno>
+#include <limits>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
 #include <queue>
+#include <system_error>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
@@ -36,6 +46,7 @@
 
 #include "utility/format.hpp"
 #include "utility/openmp.hpp"
+#include "utility/filedes.hpp"
 
 #include "math/transform.hpp"
 
@@ -54,8 +65,11 @@
 
 namespace vtslibs { namespace vts {
 
+namespace fs = boost::filesystem;
+
 constexpr HeightMapBase::DataType HeightMapBase::Infinity;
 constexpr HeightMapBase::DataType HeightMapBase::InvalidHeight;
+constexpr TiledHeightMap::DataType TiledHeightMap::InvalidHeight;
 
 namespace def {
 const auto *DumpDir(::getenv("HEIGHTMAP_DUMP_DIR"));
@@ -103,6 +117,143 @@ private:
 
 } // namespace
 
+namespace {
+
+/** Creates anonymous temporary file in given directory (or in system
+ *  temporary directory if empty). File is unlinked right away, its content
+ *  lives until descriptor is closed.
+ */
+utility::Filedes createTmpFile(const fs::path &tmpDir, const char *pattern)
+{
+    const auto path((tmpDir.empty() ? fs::temp_directory_path() : tmpDir)
+                    / fs::unique_path(pattern));
+
+    utility::Filedes fd(::open(path.string().c_str()
+                               , O_RDWR | O_CREAT | O_EXCL, 0600)
+                        , path);
+    if (!fd) {
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError
+             ("Unable to create temporary heightmap file %s.", path));
+        LOG(err2) << e.what();
+        throw e;
+    }
+
+    fs::remove(path);
+    return fd;
+}
+
+void writeAt(const utility::Filedes &fd, const cv::Mat &data, off_t offset)
+{
+    auto left(data.total() * data.elemSize());
+    const auto *p(data.data);
+    while (left) {
+        auto bytes(::pwrite(fd, p, left, offset));
+        if (-1 == bytes) {
+            if (EINTR == errno) { continue; }
+            std::system_error e
+                (errno, std::system_category()
+                 , utility::formatError
+                 ("Failed to write to temporary heightmap file %s."
+                  , fd.path()));
+            LOG(err2) << e.what();
+            throw e;
+        }
+        left -= bytes;
+        p += bytes;
+        offset += bytes;
+    }
+}
+
+void readAt(const utility::Filedes &fd, cv::Mat &data, off_t offset)
+{
+    const auto size(data.total() * data.elemSize());
+    auto left(size);
+    auto *p(data.data);
+    while (left) {
+        auto bytes(::pread(fd, p, left, offset));
+        if (-1 == bytes) {
+            if (EINTR == errno) { continue; }
+            std::system_error e
+                (errno, std::system_category()
+                 , utility::formatError
+                 ("Failed to read from temporary heightmap file %s."
+                  , fd.path()));
+            LOG(err2) << e.what();
+            throw e;
+        }
+        if (!bytes) {
+            LOGTHROW(err1, std::runtime_error)
+                << "EOF while trying to read " << size
+                << " bytes from file " << fd.path() << ".";
+        }
+        left -= bytes;
+        p += bytes;
+        offset += bytes;
+    }
+}
+
+} // namespace
+
+/** Spill storage of heightmap accumulator.
+ */
+struct HeightMap::Accumulator::Spill {
+    typedef std::list<Index> Lru;
+
+    /** Maximum number of resident tiles.
+     */
+    std::size_t limit;
+
+    utility::Filedes fd;
+
+    /** Spill file size.
+     */
+    off_t size;
+
+    /** Resident tiles, most recently used first.
+     */
+    Lru lru;
+    std::map<Index, Lru::iterator> resident;
+
+    Spill(utility::Filedes &&fd) : limit(), fd(std::move(fd)), size() {}
+
+    void touch(const Index &index) {
+        auto fresident(resident.find(index));
+        if (fresident == resident.end()) {
+            lru.push_front(index);
+            resident.insert(std::make_pair(index, lru.begin()));
+        } else {
+            lru.splice(lru.begin(), lru, fresident->second);
+        }
+    }
+
+    /** Spills least recently used tiles until at most limit tiles are
+     *  resident.
+     */
+    void shrink(Tiles &tiles, std::size_t limit) {
+        while (lru.size() > limit) {
+            const auto index(lru.back());
+            auto &tile(tiles.at(index));
+            if (tile.offset < 0) {
+                tile.offset = size;
+                size += tile.data.total() * tile.data.elemSize();
+            }
+            writeAt(fd, tile.data, tile.offset);
+            tile.data.release();
+
+            lru.pop_back();
+            resident.erase(index);
+        }
+    }
+
+    void load(cv::Mat &data, const Tile &tile, const math::Size2 &tileSize) {
+        data.create(tileSize.height, tileSize.width
+                    , vts::opencv::NavTile::CvDataType);
+        readAt(fd, data, tile.offset);
+    }
+};
+
 HeightMap::Accumulator::Accumulator(vts::Lod lod)
     : lod_(lod)
     , tileSize_(vts::NavTile::size())
@@ -110,6 +261,33 @@ HeightMap::Accumulator::Accumulator(vts::Lod lod)
 {
 }
 
+HeightMap::Accumulator::~Accumulator() {}
+
+HeightMap::Accumulator::Tile&
+HeightMap::Accumulator::get(const Index &index)
+{
+    auto ftiles(tiles_.find(index));
+    if (ftiles == tiles_.end()) {
+        // create new tile (all values set to +oo
+        ftiles = tiles_.insert(Tiles::value_type(index, Tile())).first;
+        ftiles->second.data = cv::Mat
+            (tileSize_.height, tileSize_.width
+             , vts::opencv::NavTile::CvDataType, cv::Scalar(InvalidHeight));
+        update(tileRange_, index);
+    } else if (ftiles->second.data.empty()) {
+        // spilled tile, bring it back
+        spill_->load(ftiles->second.data, ftiles->second, tileSize_);
+    }
+
+    if (spill_) {
+        // current tile is the most recent one and thus is never spilled here
+        spill_->touch(index);
+        spill_->shrink(tiles_, spill_->limit);
+    }
+
+    return ftiles->second;
+}
+
 cv::Mat& HeightMap::Accumulator::tile(const vts::TileId &tileId)
 {
     if (tileId.lod != lod_) {
@@ -119,27 +297,72 @@ cv::Mat& HeightMap::Accumulator::tile(const vts::TileId &tileId)
             << lod_ << ".";
     }
 
-    const Index index(tileId.x, tileId.y);
+    return get(Index(tileId.x, tileId.y)).data;
+}
+
+void HeightMap::Accumulator::merge(const vts::TileId &tileId
+                                   , const cv::Mat &data)
+{
+    auto &tile(this->tile(tileId));
+    cv::max(tile, data, tile);
+}
+
+void HeightMap::Accumulator::memoryLimit(std::size_t limit
+                                         , const fs::path &tmpDir)
+{
+    if (!spill_) {
+        if (!limit) { return; }
 
-    const auto ftiles(tiles_.find(index));
-    if (ftiles != tiles_.end()) {
-        return ftiles->second;
+        spill_.reset(new Spill
+                     (createTmpFile(tmpDir, "heightmap-acc-%%%%-%%%%-%%%%")));
+        for (const auto &item : tiles_) { spill_->touch(item.first); }
     }
 
-    // create new tile (all values set to +oo
-    auto res
-        (tiles_.insert
-         (Tiles::value_type
-          (index, cv::Mat
-           (tileSize_.height, tileSize_.width, vts::opencv::NavTile::CvDataType
-            , cv::Scalar(InvalidHeight)))));
-    update(tileRange_, index);
+    const std::size_t tileBytes
+        (tileSize_.width * tileSize_.height * sizeof(DataType));
+    spill_->limit = (limit ? std::max(limit / tileBytes, std::size_t(1))
+                     : std::numeric_limits<std::size_t>::max());
+    spill_->shrink(tiles_, spill_->limit);
+}
+
+void HeightMap::Accumulator::spill()
+{
+    if (spill_) { spill_->shrink(tiles_, 0); }
+}
+
+void HeightMap::Accumulator::forEach
+(const std::function<void(const Index&, const cv::Mat&)> &op)
+{
+    cv::Mat tmp;
+    for (const auto &item : tiles_) {
+        const auto &tile(item.second);
+        if (!tile.data.empty()) {
+            op(item.first, tile.data);
+        } else {
+            spill_->load(tmp, tile, tileSize_);
+            op(item.first, tmp);
+        }
+    }
+}
 
-    return res.first->second;
+void HeightMap::Accumulator::clear()
+{
+    tiles_.clear();
+    spill_.reset();
 }
 
 namespace {
 
+/** Running min/max filter (van Herk/Gil-Werman).
+ *
+ *  Cost per pixel does not depend on kernel radius: input is split into
+ *  blocks of kernel size, prefix and suffix running values are computed
+ *  inside each block and every window is then covered by one suffix and one
+ *  prefix value.
+ *
+ *  Filter runs in vertical direction over strips of columns; inner loops run
+ *  over contiguous row data and strips are processed in parallel.
+ */
 template <typename Operator>
 class Morphology {
 public:
@@ -148,17 +371,17 @@ public:
     /** Apply morphology operator to data matrix in given kernel
      * radius. Application uses tmp matrix for temporary result.
      *
-     *  Operator is applied on in horizontal direction. To work in vertical
-     *  direction set transpose to true.
+     *  Operator is applied in vertical direction. To work in horizontal
+     *  direction set vertical to false.
      *
-     *  If invalidValue is set reset output to given value.
+     *  If invalidValue is set, such pixels are skipped and reset in output.
      */
     Morphology(cv::Mat &data, cv::Mat &tmp, int kernelRadius
-               , bool transpose
+               , bool vertical
                , boost::optional<value_type> invalidValue)
         : in_(data), tmp_(tmp), invalidValue_(invalidValue)
     {
-        if (transpose) {
+        if (!vertical) {
             // transpose and swap
             cv::transpose(in_, tmp_);
             std::swap(in_, tmp_);
@@ -170,12 +393,15 @@ public:
         if (invalidValue_) {
             // invalidate all pixels
             tmp_ = cv::Scalar(*invalidValue_);
+        } else {
+            // pixels without result keep their value
+            in_.copyTo(tmp_);
         }
 
-        run(kernelRadius);
+        run(std::max(kernelRadius, 0));
 
         // copy result to input matrix
-        if (transpose) {
+        if (!vertical) {
             // transpose back
             cv::transpose(tmp_, in_);
         } else {
@@ -187,9 +413,10 @@ public:
 private:
     void run(int kernelRadius);
 
-    bool valid(value_type value) const {
-        return !invalidValue_ || (value != *invalidValue_);
-    }
+    /** Processes columns [c0, c0 + width).
+     */
+    void run(int kernelRadius, int c0, int width
+             , std::vector<value_type> &g, std::vector<value_type> &h);
 
     cv::Mat &in_;
     cv::Mat &tmp_;
@@ -199,97 +426,157 @@ private:
 template <typename Operator>
 void Morphology<Operator>::run(int kernelRadius)
 {
-    const std::size_t total(in_.rows * in_.cols);
+    // columns processed together; keeps running buffers in cache
+    const int StripWidth(64);
+
+    const int strips((in_.cols + StripWidth - 1) / StripWidth);
+
+    UTILITY_OMP(parallel)
+    {
+        std::vector<value_type> g;
+        std::vector<value_type> h;
+
+        UTILITY_OMP(for schedule(dynamic))
+        for (int strip = 0; strip < strips; ++strip) {
+            const int c0(strip * StripWidth);
+            run(kernelRadius, c0, std::min(StripWidth, in_.cols - c0), g, h);
+        }
+    }
+}
+
+template <typename Operator>
+void Morphology<Operator>::run(int kernelRadius, int c0, int width
+                               , std::vector<value_type> &g
+                               , std::vector<value_type> &h)
+{
+    const value_type neutral(Operator::InvalidValue);
+    const bool checkInvalid(invalidValue_);
+    const value_type invalid(checkInvalid ? *invalidValue_ : neutral);
 
-    UTILITY_OMP(parallel for)
-    for (std::size_t idx = 0; idx < total; ++idx) {
-        int x = idx % in_.cols;
-        int y = idx / in_.cols;
+    // input padded by kernelRadius neutral rows at both ends
+    const int rows(in_.rows);
+    const int window(2 * kernelRadius + 1);
+    const int padded(rows + 2 * kernelRadius);
 
-        // skip invalid data
-        if (!valid(in_.at<value_type>(y, x))) { continue; }
+    g.resize(std::size_t(padded) * width);
+    h.resize(std::size_t(padded) * width);
 
-        Operator op;
+    // fetches padded row p into dst, invalid pixels become neutral
+    auto fetch([&](int p, value_type *dst)
+    {
+        const int y(p - kernelRadius);
+        if ((y < 0) || (y >= rows)) {
+            std::fill(dst, dst + width, neutral);
+            return;
+        }
+
+        const auto *src(in_.ptr<value_type>(y) + c0);
+        if (!checkInvalid) {
+            std::copy(src, src + width, dst);
+            return;
+        }
+        for (int c = 0; c < width; ++c) {
+            dst[c] = (src[c] == invalid) ? neutral : src[c];
+        }
+    });
 
-        for (int i = -kernelRadius; i <= kernelRadius; ++i) {
-            const int xx(x + i);
-            if ((xx < 0) || (xx >= in_.cols)) { continue; }
+    // prefix values inside blocks (g) and raw values (h)
+    for (int p = 0; p < padded; ++p) {
+        auto *gp(&g[std::size_t(p) * width]);
+        auto *hp(&h[std::size_t(p) * width]);
+        fetch(p, hp);
+
+        if (p % window) {
+            const auto *gprev(gp - width);
+            for (int c = 0; c < width; ++c) {
+                gp[c] = Operator::apply(gprev[c], hp[c]);
+            }
+        } else {
+            std::copy(hp, hp + width, gp);
+        }
+    }
 
-            auto value(in_.at<value_type>(y, xx));
-            if (!valid(value)) { continue; }
-            op(value);
+    // suffix values inside blocks (h)
+    for (int p = padded - 2; p >= 0; --p) {
+        if ((p % window) == (window - 1)) { continue; }
+        auto *hp(&h[std::size_t(p) * width]);
+        const auto *hnext(hp + width);
+        for (int c = 0; c < width; ++c) {
+            hp[c] = Operator::apply(hp[c], hnext[c]);
         }
+    }
 
-        // store only valid value
-        if (!op.valid()) { continue; }
+    // window of row y is [y, y + 2 * radius] in padded coordinates
+    for (int y = 0; y < rows; ++y) {
+        const auto *src(in_.ptr<value_type>(y) + c0);
+        auto *dst(tmp_.ptr<value_type>(y) + c0);
+        const auto *hp(&h[std::size_t(y) * width]);
+        const auto *gp(&g[std::size_t(y + 2 * kernelRadius) * width]);
 
-        // store
-        tmp_.at<value_type>(y, x) = op.get();
+        for (int c = 0; c < width; ++c) {
+            // skip invalid data
+            if (checkInvalid && (src[c] == invalid)) { continue; }
+
+            const auto value(Operator::apply(hp[c], gp[c]));
+
+            // store only valid value
+            if (value != neutral) { dst[c] = value; }
+        }
     }
 }
 
 template <typename ValueType>
-class Erosion {
-public:
+struct Erosion {
     typedef ValueType value_type;
     static constexpr value_type InvalidValue
     = std::numeric_limits<value_type>::max();
 
-    Erosion() : value_(InvalidValue) {}
-
-    inline void operator()(value_type value) {
-        value_ = std::min(value_, value);
+    static inline value_type apply(value_type a, value_type b) {
+        return std::min(a, b);
     }
-
-    inline bool valid() const { return value_ != InvalidValue; }
-    inline value_type get() const { return value_; }
-
-private:
-    value_type value_;
 };
 
 template <typename ValueType>
-class Dilation {
-public:
+struct Dilation {
     typedef ValueType value_type;
     static constexpr value_type InvalidValue
     = std::numeric_limits<value_type>::lowest();
 
-    inline Dilation() : value_(InvalidValue) {}
-
-    inline void operator()(value_type value) {
-        value_ = std::max(value_, value);
+    static inline value_type apply(value_type a, value_type b) {
+        return std::max(a, b);
     }
-
-    inline bool valid() const { return value_ != InvalidValue; }
-    inline value_type get() const { return value_; }
-
-private:
-    value_type value_;
 };
 
-void dtmize(cv::Mat &pane, int count)
+/** Morphological opening (erosion followed by dilation) in both directions.
+ */
+void opening(cv::Mat &pane, int count)
 {
-    LOG(info3) << "Generating DTM from heightmap ("
-               << pane.cols << "x" << pane.rows << " pixels).";
-
     cv::Mat tmp;
 
-    LOG(info2) << "Eroding heightmap Y (radius " << count << "px).";
+    LOG(debug) << "Eroding heightmap Y (radius " << count << "px).";
     Morphology<Erosion<HeightMap::DataType>>
         (pane, tmp, count, true, HeightMap::InvalidHeight);
-    LOG(info2) << "Eroding heightmap X (radius " << count << "px).";
+    LOG(debug) << "Eroding heightmap X (radius " << count << "px).";
     Morphology<Erosion<HeightMap::DataType>>
         (pane, tmp, count, false, HeightMap::InvalidHeight);
 
-    LOG(info2) << "Dilating heightmap Y (radius " << count << "px).";
+    LOG(debug) << "Dilating heightmap Y (radius " << count << "px).";
     Morphology<Dilation<HeightMap::DataType>>
         (pane, tmp, count, true, HeightMap::InvalidHeight);
-    LOG(info2) << "Dilating heightmap X (radius " << count << "px).";
+    LOG(debug) << "Dilating heightmap X (radius " << count << "px).";
     Morphology<Dilation<HeightMap::DataType>>
         (pane, tmp, count, false, HeightMap::InvalidHeight);
 }
 
+void dtmize(cv::Mat &pane, int count)
+{
+    LOG(info3) << "Generating DTM from heightmap ("
+               << pane.cols << "x" << pane.rows << " pixels).";
+
+    LOG(info2) << "Opening heightmap (radius " << count << "px).";
+    opening(pane, count);
+}
+
 template <typename ...Args>
 void debugDump(const HeightMap &hm, const std::string &format, Args &&...args)
 {
@@ -383,18 +670,19 @@ HeightMap::HeightMap(Accumulator &&a
     : HeightMapBase(referenceFrame, a.lod_, a.tileRange_)
 {
     LOG(info2) << "Copying heightmaps from tiles into one pane.";
-    for (const auto &item : a.tiles_) {
+    a.forEach([&](const Accumulator::Index &index, const cv::Mat &data)
+    {
         // copy tile in proper place
-        Accumulator::Index offset(item.first - tileRange_.ll);
+        Accumulator::Index offset(index - tileRange_.ll);
         offset(0) *= tileGrid_.width;
         offset(1) *= tileGrid_.height;
         cv::Mat tile(pane_, cv::Range(offset(1), offset(1) + tileSize_.height)
                      , cv::Range(offset(0), offset(0) + tileSize_.width));
-        item.second.copyTo(tile);
-    }
+        data.copyTo(tile);
+    });
 
     // drop original pane
-    a.tiles_.clear();
+    a.clear();
 
     debugDump(*this, "hm-plain.png");
     dtmize(pane_, std::ceil(dtmExtractionRadius));
@@ -510,6 +798,34 @@ void HeightMap::resize(vts::Lod lod)
     debugDump(*this, "hm-%d.png", lod_);
 }
 
+namespace {
+
+vts::NavTile::pointer navtileFromPane(const cv::Mat &tile)
+{
+    // create navtile
+    auto nt(std::make_shared<vts::opencv::NavTile>());
+
+    // copy data from pane
+    nt->data(tile);
+
+    // optimistic approach: start with full mask, unset invalid nodes
+    auto &cm(nt->coverageMask());
+    for (auto j(0); j < tile.rows; ++j) {
+        for (auto i(0); i < tile.cols; ++i) {
+            if (tile.at<HeightMap::DataType>(j, i)
+                == HeightMap::InvalidHeight)
+            {
+                cm.set(i, j, false);
+            }
+        }
+    }
+
+    // done
+    return nt;
+}
+
+} // namespace
+
 vts::NavTile::pointer HeightMap::navtile(const vts::TileId &tileId) const
 {
     if (tileId.lod != lod_) {
@@ -524,9 +840,6 @@ vts::NavTile::pointer HeightMap::navtile(const vts::TileId &tileId) const
         return {};
     }
 
-    // create navtile
-    auto nt(std::make_shared<vts::opencv::NavTile>());
-
     // we know that tileId is inside tileRange, get pixel offset
     math::Point2i offset((tileId.x - tileRange_.ll(0)) * tileGrid_.width
                          , (tileId.y - tileRange_.ll(1)) * tileGrid_.height);
@@ -535,23 +848,7 @@ vts::NavTile::pointer HeightMap::navtile(const vts::TileId &tileId) const
     cv::Mat tile(pane_, cv::Range(offset(1), offset(1) + tileSize_.height)
                  , cv::Range(offset(0), offset(0) + tileSize_.width));
 
-    // creat mask
-
-    // copy data from pane
-    nt->data(tile);
-
-    // optimistic approach: start with full mask, unset invalid nodes
-    auto &cm(nt->coverageMask());
-    for (auto j(0); j < tile.rows; ++j) {
-        for (auto i(0); i < tile.cols; ++i) {
-            if (tile.at<DataType>(j, i) == InvalidHeight) {
-                cm.set(i, j, false);
-            }
-        }
-    }
-
-    // done
-    return nt;
+    return navtileFromPane(tile);
 }
 
 namespace {
@@ -628,6 +925,54 @@ void HeightMap::dump(const boost::filesystem::path &filename) const
     imwrite(filename.string(), image);
 }
 
+namespace {
+
+/** Converts best position (location in pixels) to world coordinates and
+ *  computes its vertical extent.
+ */
+void bestPositionToWorld(HeightMap::BestPosition &out
+                         , const math::Extents2i &validExtents
+                         , const math::Extents2 &worldExtents
+                         , const math::Size2 &sizeInPixels)
+{
+    auto &c(out.location);
+
+    auto es(math::size(worldExtents));
+    auto eul(ul(worldExtents));
+
+    auto worldX([&](double x) {
+            return eul(0) + ((x * es.width) / sizeInPixels.width);
+        });
+    auto worldY([&](double y) {
+            return eul(1) - ((y * es.height) / sizeInPixels.height);
+        });
+
+    auto world([&](const math::Point3 &p) {
+            return math::Point3(worldX(p(0)), worldY(p(1)), p(2));
+        });
+
+    {
+        math::Point2 d1(math::Point2(c(0), c(1)) - validExtents.ll);
+        math::Point2 d2(validExtents.ur - math::Point2(c(0), c(1)));
+        double distance(std::max({ d1(0), d1(1), d2(0), d2(1) }));
+
+        // vertical extent points
+        math::Point3 e1(c(0), c(1) - distance, c(2));
+        math::Point3 e2(c(0), c(1) + distance, c(2));
+
+        e1 = world(e1);
+        e2 = world(e2);
+
+        distance = boost::numeric::ublas::norm_2(e2 - e1);
+
+        out.verticalExtent = distance;
+    }
+
+    c = world(c);
+}
+
+} // namespace
+
 HeightMap::BestPosition HeightMap::bestPosition() const
 {
     // TODO: what to do if centroid is not at valid pixel?
@@ -674,43 +1019,13 @@ HeightMap::BestPosition HeightMap::bestPosition() const
         c(2) = findNearestValid(pane_, c(0), c(1));
     }
 
-    auto es(math::size(worldExtents_));
-    auto eul(ul(worldExtents_));
-
-    auto worldX([&](double x) {
-            return eul(0) + ((x * es.width) / sizeInPixels_.width);
-        });
-    auto worldY([&](double y) {
-            return eul(1) - ((y * es.height) / sizeInPixels_.height);
-        });
-
-    auto world([&](const math::Point3 &p) {
-            return math::Point3(worldX(p(0)), worldY(p(1)), p(2));
-        });
-
-    {
-        math::Point2 d1(math::Point2(c(0), c(1)) - validExtents.ll);
-        math::Point2 d2(validExtents.ur - math::Point2(c(0), c(1)));
-        double distance(std::max({ d1(0), d1(1), d2(0), d2(1) }));
-
-        // vertical extent points
-        math::Point3 e1(c(0), c(1) - distance, c(2));
-        math::Point3 e2(c(0), c(1) + distance, c(2));
-
-        e1 = world(e1);
-        e2 = world(e2);
-
-        distance = boost::numeric::ublas::norm_2(e2 - e1);
-
-        out.verticalExtent = distance;
-    }
-
-    c = world(c);
+    bestPositionToWorld(out, validExtents, worldExtents_, sizeInPixels_);
 
     // done
     return out;
 }
 
+
 namespace {
 
 math::Extents2 addHalfPixel(const math::Extents2 &e
@@ -725,41 +1040,44 @@ math::Extents2 addHalfPixel(const math::Extents2 &e
 
 } // namespace
 
-void HeightMap::warp(const registry::ReferenceFrame &referenceFrame
-                     , vts::Lod lod, const vts::TileRange &tileRange)
-{
-    if (empty()) { return; }
+namespace {
 
+/** Warps pane covering srcExtents (dataset extents, i.e. inflated by half
+ *  pixel) in srcSrs into new pane of given size covering dstExtents (dataset
+ *  extents as well) in dstSrs (registry srs dstSrsId).
+ *
+ *  Heights are converted from srcNavSrs to dstNavSrs.
+ */
+cv::Mat warpPane(const cv::Mat &pane, const math::Extents2 &srcExtents
+                 , const geo::SrsDefinition &srcSrs
+                 , const math::Extents2 &dstExtents
+                 , const math::Size2 &dstSize
+                 , const geo::SrsDefinition &dstSrs
+                 , const std::string &dstSrsId
+                 , const std::string &srcNavSrs
+                 , const std::string &dstNavSrs)
+{
     // TODO: work with native type inside GeoDataset when GeoDataset interface
     // is ready
 
-    math::Size2 sizeInTiles(calculateSizeInTiles(tileRange));
-    math::Size2 sizeInPixels(calculateSizeInPixels(tileGrid_, sizeInTiles));
-
-    std::string srs;
-    auto extents(worldExtents(lod, tileRange, referenceFrame, srs));
-
-    auto srcSrs(registry::system.srs(srs_));
-    auto dstSrs(registry::system.srs(srs));
-
-    // create source dataset (extents are inflate by half pixel in each
-    // direction to facilitate grid registry)
+    // create source dataset
     auto srcDs(geo::GeoDataset::create
-               ("", srcSrs.srsDef
-                , addHalfPixel(worldExtents_, sizeInPixels_)
-                , sizeInPixels_
+               ("", srcSrs, srcExtents
+                , math::Size2(pane.cols, pane.rows)
                 , geo::GeoDataset::Format::dsm
                 (geo::GeoDataset::Format::Storage::memory)
-                , InvalidHeight));
+                , HeightMap::InvalidHeight));
 
     // prepare mask
     {
         auto &cm(srcDs.mask());
         // optimistic approach: start with full mask, unset invalid nodes
         cm.reset(true);
-        for (auto j(0); j < pane_.rows; ++j) {
-            for (auto i(0); i < pane_.cols; ++i) {
-                if (pane_.at<DataType>(j, i) == InvalidHeight) {
+        for (auto j(0); j < pane.rows; ++j) {
+            for (auto i(0); i < pane.cols; ++i) {
+                if (pane.at<HeightMap::DataType>(j, i)
+                    == HeightMap::InvalidHeight)
+                {
                     cm.set(i, j, false);
                 }
             }
@@ -767,61 +1085,94 @@ void HeightMap::warp(const registry::ReferenceFrame &referenceFrame
     }
 
     // copy data inside dataset
-    pane_.convertTo(srcDs.data(), srcDs.data().type());
+    pane.convertTo(srcDs.data(), srcDs.data().type());
     srcDs.flush();
 
-    // create destination dataset (extents are inflate by half pixel in each
-    // direction to facilitate grid registry)
+    // create destination dataset
     auto dstDs(geo::GeoDataset::deriveInMemory
-               (srcDs, dstSrs.srsDef, sizeInPixels
-                , addHalfPixel(extents, sizeInPixels)));
+               (srcDs, dstSrs, dstSize, dstExtents));
 
     // warp
     srcDs.warpInto(dstDs);
 
     /** fix Z component
      * for each valid point XY in navtile:
-     *     X'Y' = conv2d(XY, srs -> referenceFrame_.model.navigationSrs)
-     *     Z' = conv3d(X'Y'Z, referenceFrame_.model.navigationSrs
-     *                , referenceFrame.model.navigationSrs).Z
+     *     X'Y' = conv2d(XY, srs -> srcNavSrs)
+     *     Z' = conv3d(X'Y'Z, srcNavSrs, dstNavSrs).Z
      */
+
+    // destination pane
+    cv::Mat tmp(dstSize.height, dstSize.width
+                , vts::opencv::NavTile::CvDataType
+                , cv::Scalar(HeightMap::InvalidHeight));
+
+    // gather all valid points: raster position and 2D point in srs
+    std::vector<math::Point2i> positions;
+    math::Points2 navXY;
+    dstDs.cmask().forEach([&](int x, int y, bool)
     {
-        // temporary pane
-        cv::Mat tmp(sizeInPixels.height, sizeInPixels.width
-                    , vts::opencv::NavTile::CvDataType
-                    , cv::Scalar(InvalidHeight));
-        // 2d convertor between srs and referenceFrame_.model.navigationSrs
-        const vts::CsConvertor sds2srcNav
-            (srs, referenceFrame_->model.navigationSrs);
-
-        const vts::CsConvertor srcNav2dstNav
-            (referenceFrame_->model.navigationSrs
-             , referenceFrame.model.navigationSrs);
-
-        const auto &hf(dstDs.cdata());
-        dstDs.cmask().forEach([&](int x, int y, bool)
-        {
-            // compose 2D point in srs
-            const math::Point2 sdsXY
-                (dstDs.raster2geo(math::Point2(x, y), 0.0));
-            // height from current heightmap
-            const auto srcZ(hf.at<double>(y, x));
-
-            // convert to source nav system
-            const auto mavXY(sds2srcNav(sdsXY));
-
-            // nox, compose 3D point in source nav system and convert to
-            // destination nav system and store Z component into destination
-            // heightmap
-            const auto dstZ
-                (srcNav2dstNav(math::Point3(mavXY(0), mavXY(1), srcZ))(2));
-            tmp.at<float>(y, x) = dstZ;
-        }, geo::GeoDataset::Mask::Filter::white);
-
-        // done, swap panes
-        std::swap(tmp, pane_);
+        positions.emplace_back(x, y);
+        navXY.push_back(dstDs.raster2geo(math::Point2(x, y), 0.0));
+    }, geo::GeoDataset::Mask::Filter::white);
+
+    // convert all points to source nav system (2D)
+    vts::csConvert(dstSrsId, srcNavSrs, navXY.data(), navXY.size());
+
+    // now, compose 3D points in source nav system (using height from
+    // current heightmap)
+    const auto &hf(dstDs.cdata());
+    math::Points3 nav;
+    nav.reserve(navXY.size());
+    {
+        auto iNavXY(navXY.cbegin());
+        for (const auto &p : positions) {
+            const auto &xy(*iNavXY++);
+            nav.emplace_back(xy(0), xy(1), hf.at<double>(p(1), p(0)));
+        }
     }
 
+    // convert to destination nav system
+    vts::csConvert(srcNavSrs, dstNavSrs, nav.data(), nav.size());
+
+    // and store Z component into destination heightmap
+    {
+        auto iNav(nav.cbegin());
+        for (const auto &p : positions) {
+            tmp.at<float>(p(1), p(0)) = (*iNav++)(2);
+        }
+    }
+
+    return tmp;
+}
+
+} // namespace
+
+void HeightMap::warp(const registry::ReferenceFrame &referenceFrame
+                     , vts::Lod lod, const vts::TileRange &tileRange)
+{
+    if (empty()) { return; }
+
+    math::Size2 sizeInTiles(calculateSizeInTiles(tileRange));
+    math::Size2 sizeInPixels(calculateSizeInPixels(tileGrid_, sizeInTiles));
+
+    std::string srs;
+    auto extents(worldExtents(lod, tileRange, referenceFrame, srs));
+
+    auto srcSrs(registry::system.srs(srs_));
+    auto dstSrs(registry::system.srs(srs));
+
+    // warp pane (extents are inflate by half pixel in each direction to
+    // facilitate grid registry)
+    auto tmp(warpPane(pane_, addHalfPixel(worldExtents_, sizeInPixels_)
+                      , srcSrs.srsDef
+                      , addHalfPixel(extents, sizeInPixels), sizeInPixels
+                      , dstSrs.srsDef, srs
+                      , referenceFrame_->model.navigationSrs
+                      , referenceFrame.model.navigationSrs));
+
+    // done, swap panes
+    std::swap(tmp, pane_);
+
     // set new content
     lod_ = lod;
     tileRange_ = tileRange;
@@ -929,5 +1280,733 @@ void dtmize(geo::GeoDataset &dataset, const math::Size2 &count)
     Morphology<Dilation<double>>(pane, tmp, count.width, false, ndv);
 }
 
+/** Disk-backed raster of heightmap values.
+ *
+ *  Raster is split into square blocks stored in anonymous temporary file.
+ *  Resident blocks are kept in LRU cache bounded by memory limit, dirty
+ *  blocks are written back on eviction. Blocks never written read as
+ *  invalid heights.
+ *
+ *  Not thread-safe.
+ */
+class TiledHeightMap::Raster : boost::noncopyable {
+public:
+    static constexpr int BlockSize = 256;
+    static constexpr std::size_t BlockBytes
+        = BlockSize * BlockSize * sizeof(DataType);
+
+    Raster(const math::Size2 &size, std::size_t memoryLimit
+           , const fs::path &tmpDir)
+        : size_(size)
+        , blocks_((size.width + BlockSize - 1) / BlockSize
+                  , (size.height + BlockSize - 1) / BlockSize)
+        , limit_(std::max(memoryLimit / BlockBytes, std::size_t(1)))
+        , fd_(createTmpFile(tmpDir, "heightmap-%%%%-%%%%-%%%%"))
+        , stored_(std::size_t(blocks_.width) * blocks_.height, false)
+    {}
+
+    const math::Size2& size() const { return size_; }
+
+    cv::Rect bounds() const {
+        return cv::Rect(0, 0, size_.width, size_.height);
+    }
+
+    /** Reads given window. Pixels outside raster are set to invalid height.
+     */
+    cv::Mat read(const cv::Rect &window);
+
+    /** Writes data at given position. Data outside raster are ignored.
+     */
+    void write(const cv::Mat &data, int x, int y);
+
+    DataType at(int x, int y);
+
+private:
+    struct Block {
+        cv::Mat data;
+        bool dirty;
+        std::list<std::size_t>::iterator lru;
+    };
+
+    /** Returns block at given block position. Block content is not loaded if
+     *  load is false (i.e. block is to be overwritten as a whole).
+     *
+     *  Returned reference is valid until next call.
+     */
+    Block& block(int bx, int by, bool load = true);
+
+    void evict();
+
+    /** Calls op(block, part) for each block intersecting window. Part is
+     *  intersection in raster coordinates.
+     */
+    template <typename Op> void forEach(const cv::Rect &window, Op op);
+
+    const math::Size2 size_;
+    const math::Size2 blocks_;
+    const std::size_t limit_;
+    utility::Filedes fd_;
+    std::vector<bool> stored_;
+    std::unordered_map<std::size_t, Block> resident_;
+    std::list<std::size_t> lru_;
+};
+
+constexpr int TiledHeightMap::Raster::BlockSize;
+constexpr std::size_t TiledHeightMap::Raster::BlockBytes;
+
+TiledHeightMap::Raster::Block&
+TiledHeightMap::Raster::block(int bx, int by, bool load)
+{
+    const std::size_t index(std::size_t(by) * blocks_.width + bx);
+
+    auto fresident(resident_.find(index));
+    if (fresident != resident_.end()) {
+        auto &block(fresident->second);
+        lru_.splice(lru_.begin(), lru_, block.lru);
+        return block;
+    }
+
+    while (resident_.size() >= limit_) { evict(); }
+
+    auto &block(resident_[index]);
+    block.data.create(BlockSize, BlockSize, vts::opencv::NavTile::CvDataType);
+    block.dirty = false;
+    if (load) {
+        if (stored_[index]) {
+            readAt(fd_, block.data, off_t(index) * BlockBytes);
+        } else {
+            block.data = cv::Scalar(InvalidHeight);
+        }
+    }
+
+    lru_.push_front(index);
+    block.lru = lru_.begin();
+    return block;
+}
+
+void TiledHeightMap::Raster::evict()
+{
+    const auto index(lru_.back());
+    auto fresident(resident_.find(index));
+
+    auto &block(fresident->second);
+    if (block.dirty) {
+        writeAt(fd_, block.data, off_t(index) * BlockBytes);
+        stored_[index] = true;
+    }
+
+    lru_.pop_back();
+    resident_.erase(fresident);
+}
+
+template <typename Op>
+void TiledHeightMap::Raster::forEach(const cv::Rect &window, Op op)
+{
+    const auto clip(window & bounds());
+    if (!clip.area()) { return; }
+
+    const int bx1((clip.x + clip.width - 1) / BlockSize);
+    const int by1((clip.y + clip.height - 1) / BlockSize);
+    for (int by(clip.y / BlockSize); by <= by1; ++by) {
+        for (int bx(clip.x / BlockSize); bx <= bx1; ++bx) {
+            const cv::Rect blockRect
+                (bx * BlockSize, by * BlockSize, BlockSize, BlockSize);
+            op(bx, by, blockRect, blockRect & clip);
+        }
+    }
+}
+
+cv::Mat TiledHeightMap::Raster::read(const cv::Rect &window)
+{
+    cv::Mat data(window.height, window.width
+                 , vts::opencv::NavTile::CvDataType);
+    if ((window & bounds()) != window) {
+        data = cv::Scalar(InvalidHeight);
+    }
+
+    forEach(window, [&](int bx, int by, const cv::Rect &blockRect
+                        , const cv::Rect &part)
+    {
+        cv::Mat dst(data, part - window.tl());
+        block(bx, by).data(part - blockRect.tl()).copyTo(dst);
+    });
+
+    return data;
+}
+
+void TiledHeightMap::Raster::write(const cv::Mat &data, int x, int y)
+{
+    const cv::Rect window(x, y, data.cols, data.rows);
+
+    forEach(window, [&](int bx, int by, const cv::Rect &blockRect
+                        , const cv::Rect &part)
+    {
+        auto &b(block(bx, by, part != blockRect));
+        cv::Mat dst(b.data, part - blockRect.tl());
+        data(part - window.tl()).copyTo(dst);
+        b.dirty = true;
+    });
+}
+
+TiledHeightMap::DataType TiledHeightMap::Raster::at(int x, int y)
+{
+    return block(x / BlockSize, y / BlockSize)
+        .data.at<DataType>(y % BlockSize, x % BlockSize);
+}
+
+namespace {
+
+typedef TiledHeightMap::Raster Raster;
+
+/** Calls op(block) for each processing block of raster of given size.
+ */
+template <typename Op>
+void forEachBlock(const math::Size2 &size, int blockSize, Op op)
+{
+    for (int y(0); y < size.height; y += blockSize) {
+        for (int x(0); x < size.width; x += blockSize) {
+            op(cv::Rect(x, y, std::min(blockSize, size.width - x)
+                        , std::min(blockSize, size.height - y)));
+        }
+    }
+}
+
+bool allInvalid(const cv::Mat &data)
+{
+    return !cv::countNonZero(data != HeightMap::InvalidHeight);
+}
+
+cv::Rect inflate(const cv::Rect &r, int halo)
+{
+    return cv::Rect(r.x - halo, r.y - halo
+                    , r.width + 2 * halo, r.height + 2 * halo);
+}
+
+/** Window covering all source positions in [ll, ur] inflated by halo.
+ */
+cv::Rect sourceWindow(const math::Point2 &ll, const math::Point2 &ur
+                      , int halo)
+{
+    const cv::Point tl(std::floor(ll(0)) - halo, std::floor(ll(1)) - halo);
+    const cv::Point br(std::ceil(ur(0)) + halo + 1
+                       , std::ceil(ur(1)) + halo + 1);
+    return cv::Rect(tl, br);
+}
+
+/** Finds nearest valid pixel (in Manhattan distance) to given position.
+ */
+double findNearestValid(Raster &pane, int x, int y)
+{
+    const auto &size(pane.size());
+    const int maxDistance(std::max(x, size.width - 1 - x)
+                          + std::max(y, size.height - 1 - y));
+
+    const auto valid([&](int i, int j) -> bool
+    {
+        if ((i < 0) || (j < 0) || (i >= size.width) || (j >= size.height)) {
+            return false;
+        }
+        return pane.at(i, j) != HeightMap::InvalidHeight;
+    });
+
+    for (int d(0); d <= maxDistance; ++d) {
+        // walk diamond of pixels in distance d
+        for (int k(0); k <= d; ++k) {
+            const int dx(k), dy(d - k);
+            for (const auto &p : { math::Point2i(x + dx, y + dy)
+                        , math::Point2i(x - dx, y + dy)
+                        , math::Point2i(x + dx, y - dy)
+                        , math::Point2i(x - dx, y - dy) })
+            {
+                if (valid(p(0), p(1))) { return pane.at(p(0), p(1)); }
+            }
+        }
+    }
+
+    // not found, force zero
+    return 0.0;
+}
+
+} // namespace
+
+TiledHeightMap::TiledHeightMap(HeightMap::Accumulator &&a
+                               , const registry::ReferenceFrame
+                               &referenceFrame
+                               , double dtmExtractionRadius
+                               , const Config &config)
+    : referenceFrame_(&referenceFrame)
+    , config_(config)
+    , tileSize_(vts::NavTile::size())
+    , tileGrid_(tileSize_.width - 1, tileSize_.height - 1)
+    , lod_(a.lod_)
+    , tileRange_(a.tileRange_)
+    , sizeInTiles_(calculateSizeInTiles(tileRange_))
+    , sizeInPixels_(calculateSizeInPixels(tileGrid_, sizeInTiles_))
+{
+    updateWorldExtents(worldExtents(lod_, tileRange_, *referenceFrame_, srs_));
+
+    pane_ = raster(sizeInPixels_);
+
+    LOG(info2) << "Copying heightmaps from tiles into tiled pane.";
+    a.forEach([&](const HeightMap::Accumulator::Index &index
+                  , const cv::Mat &data)
+    {
+        // copy tile in proper place
+        HeightMap::Accumulator::Index offset(index - tileRange_.ll);
+        pane_->write(data, offset(0) * tileGrid_.width
+                     , offset(1) * tileGrid_.height);
+    });
+
+    // drop original tiles
+    a.clear();
+
+    const int count(std::ceil(dtmExtractionRadius));
+
+    LOG(info3) << "Generating DTM from tiled heightmap ("
+               << sizeInPixels_.width << "x" << sizeInPixels_.height
+               << " pixels).";
+
+    // opening reaches twice the radius
+    const int halo(2 * count);
+    const int bs(blockSize(halo));
+
+    auto dst(raster(sizeInPixels_));
+    forEachBlock(sizeInPixels_, bs, [&](const cv::Rect &block)
+    {
+        const auto window(inflate(block, halo) & pane_->bounds());
+        auto data(pane_->read(window));
+        if (allInvalid(data)) { return; }
+
+        opening(data, count);
+        dst->write(data(block - window.tl()), block.x, block.y);
+    });
+    pane_ = std::move(dst);
+}
+
+TiledHeightMap::~TiledHeightMap() {}
+
+std::unique_ptr<TiledHeightMap::Raster>
+TiledHeightMap::raster(const math::Size2 &size) const
+{
+    // at most two rasters live at the same time, each gets one quarter of
+    // the budget; the rest is left for processing windows
+    return std::unique_ptr<Raster>
+        (new Raster(size, config_.memoryBudget / 4, config_.tmpDir));
+}
+
+int TiledHeightMap::blockSize(int halo, double scale) const
+{
+    const std::size_t budget(config_.memoryBudget / 2);
+
+    // input window (with processing temporary) and output block
+    const auto memory([&](int size) -> std::size_t
+    {
+        const std::size_t src(std::ceil(size * scale) + 2 * halo);
+        return (2 * src * src + std::size_t(size) * size) * sizeof(DataType);
+    });
+
+    int size(Raster::BlockSize);
+    if (memory(size) <= budget) {
+        while (memory(2 * size) <= budget) { size *= 2; }
+        return size;
+    }
+
+    while ((size > 16) && (memory(size) > budget)) { size /= 2; }
+    if (memory(size) > budget) {
+        LOG(warn2)
+            << "Heightmap processing window (halo " << halo
+            << "px) exceeds memory budget of " << config_.memoryBudget
+            << " bytes.";
+    }
+    return size;
+}
+
+void TiledHeightMap::updateWorldExtents(const math::Extents2 &we)
+{
+    worldExtents_ = we;
+    world2Grid_ = boost::numeric::ublas::identity_matrix<double>(4);
+    const auto es(size(worldExtents_));
+
+    // scales
+    math::Size2f scale((sizeInPixels_.width - 1) / es.width
+                       , (sizeInPixels_.height - 1) / es.height);
+
+    // scale to grid
+    world2Grid_(0, 0) = scale.width;
+    world2Grid_(1, 1) = -scale.height;
+
+    // shift
+    world2Grid_(0, 3) = -worldExtents_.ll(0) * scale.width;
+    world2Grid_(1, 3) = worldExtents_.ur(1) * scale.height;
+}
+
+void TiledHeightMap::resize(vts::Lod lod)
+{
+    if (lod > lod_) {
+        LOGTHROW(err2, std::runtime_error)
+            << "Heightmap can be only shrinked.";
+    }
+    // no-op if same lod
+    if (lod == lod_) { return; }
+
+    LOG(info2) << "Resizing tiled heightmap from LOD " << lod_
+               << " to LOD " << lod << ".";
+
+    // calculate new tile range
+    // go up in the tile tree
+    vts::TileId ll(lod_, tileRange_.ll(0), tileRange_.ll(1));
+    vts::TileId ur(lod_, tileRange_.ur(0), tileRange_.ur(1));
+    auto localId(vts::local(lod, ll));
+    int scale(1 << localId.lod);
+    ll = vts::parent(ll, localId.lod);
+    ur = vts::parent(ur, localId.lod);
+
+    vts::TileRange tileRange(ll.x, ll.y, ur.x, ur.y);
+    math::Size2 sizeInTiles(math::size(tileRange));
+    ++sizeInTiles.width; ++sizeInTiles.height;
+    math::Size2 sizeInPixels(calculateSizeInPixels(tileGrid_, sizeInTiles));
+    math::Point2i offset(-localId.x * tileGrid_.width
+                         , -localId.y * tileGrid_.height);
+
+    // filter heightmap from pane_ into new raster block by block
+    const math::CatmullRom2 filter(4.0 * localId.lod, 4.0 * localId.lod);
+    const int halo(std::ceil(4.0 * localId.lod) + 2);
+
+    auto dst(raster(sizeInPixels));
+    forEachBlock(sizeInPixels, blockSize(halo, scale)
+                 , [&](const cv::Rect &block)
+    {
+        const auto window
+            (sourceWindow(math::Point2(scale * block.x + offset(0)
+                                       , scale * block.y + offset(1))
+                          , math::Point2
+                          (scale * (block.x + block.width - 1) + offset(0)
+                           , scale * (block.y + block.height - 1)
+                           + offset(1))
+                          , halo)
+             & pane_->bounds());
+        if (!window.area()) { return; }
+
+        const auto src(pane_->read(window));
+        if (allInvalid(src)) { return; }
+
+        const HeightMapRaster srcRaster(src, InvalidHeight);
+        cv::Mat tmp(block.height, block.width
+                    , vts::opencv::NavTile::CvDataType);
+
+        UTILITY_OMP(parallel for)
+        for (int j = 0; j < tmp.rows; ++j) {
+            for (int i(0); i < tmp.cols; ++i) {
+                // map x,y into source window (applying scale and tile
+                // offset)
+                math::Point2 srcPos
+                    (scale * (block.x + i) + offset(0) - window.x
+                     , scale * (block.y + j) + offset(1) - window.y);
+
+                // reconstruct value
+                tmp.at<DataType>(j, i)
+                    = imgproc::reconstruct(srcRaster, filter, srcPos)[0];
+            }
+        }
+
+        dst->write(tmp, block.x, block.y);
+    });
+
+    // set new content
+    lod_ = lod;
+    tileRange_ = tileRange;
+    sizeInTiles_ = sizeInTiles;
+    sizeInPixels_ = sizeInPixels;
+    pane_ = std::move(dst);
+    updateWorldExtents(worldExtents(lod_, tileRange_, *referenceFrame_, srs_));
+}
+
+void TiledHeightMap::halve()
+{
+    // compute new dimension, limit size to at least 2 grid samples (i.e. 1
+    // pixel)
+    math::Size2 sizeInPixels(std::round(sizeInPixels_.width / 2)
+                             , std::round(sizeInPixels_.height / 2));
+
+    if (sizeInPixels.width < 2) { sizeInPixels.width = 2; }
+    if (sizeInPixels.height < 2) { sizeInPixels.height = 2; }
+
+    // compute scaling from destination raster to source raster
+    imgproc::GridScaling2 scaling(sizeInPixels, sizeInPixels_);
+    const auto der(scaling.derivatives({}));
+
+    const math::CatmullRom2 filter(2.0 * std::max(der(0), 1.0)
+                                   , 2.0 * std::max(der(1), 1.0));
+    const int halo(std::ceil(2.0 * std::max({ der(0), der(1), 1.0 })) + 2);
+
+    auto dst(raster(sizeInPixels));
+    forEachBlock(sizeInPixels
+                 , blockSize(halo, std::max({ der(0), der(1), 1.0 }))
+                 , [&](const cv::Rect &block)
+    {
+        const auto window
+            (sourceWindow(scaling.map(math::Point2(block.x, block.y))
+                          , scaling.map
+                          (math::Point2(block.x + block.width - 1
+                                        , block.y + block.height - 1))
+                          , halo)
+             & pane_->bounds());
+        if (!window.area()) { return; }
+
+        const auto src(pane_->read(window));
+        if (allInvalid(src)) { return; }
+
+        const HeightMapRaster srcRaster(src, InvalidHeight);
+        cv::Mat tmp(block.height, block.width
+                    , vts::opencv::NavTile::CvDataType);
+
+        UTILITY_OMP(parallel for)
+        for (int j = 0; j < tmp.rows; ++j) {
+            for (int i(0); i < tmp.cols; ++i) {
+                // map x,y into source window via scaling mapper
+                auto srcPos(scaling.map(math::Point2(block.x + i
+                                                     , block.y + j)));
+                srcPos(0) -= window.x;
+                srcPos(1) -= window.y;
+
+                // reconstruct value
+                tmp.at<DataType>(j, i)
+                    = imgproc::reconstruct(srcRaster, filter, srcPos)[0];
+            }
+        }
+
+        dst->write(tmp, block.x, block.y);
+    });
+
+    // set new content, keep other stuff intact
+    sizeInPixels_ = sizeInPixels;
+    pane_ = std::move(dst);
+
+    // force world2grid matrix recomputations
+    updateWorldExtents(worldExtents_);
+}
+
+void TiledHeightMap::warp(const registry::ReferenceFrame &referenceFrame
+                          , vts::Lod lod, const vts::TileRange &tileRange)
+{
+    if (empty()) { return; }
+
+    math::Size2 sizeInTiles(calculateSizeInTiles(tileRange));
+    math::Size2 sizeInPixels(calculateSizeInPixels(tileGrid_, sizeInTiles));
+
+    std::string srs;
+    auto extents(worldExtents(lod, tileRange, referenceFrame, srs));
+
+    auto srcSrs(registry::system.srs(srs_));
+    auto dstSrs(registry::system.srs(srs));
+
+    // dataset extents (inflated by half pixel in each direction to
+    // facilitate grid registry) and pixel sizes
+    const auto srcExtents(addHalfPixel(worldExtents_, sizeInPixels_));
+    const auto dstExtents(addHalfPixel(extents, sizeInPixels));
+    const auto srcEs(size(srcExtents));
+    const auto dstEs(size(dstExtents));
+    const math::Size2f srcPixel(srcEs.width / sizeInPixels_.width
+                                , srcEs.height / sizeInPixels_.height);
+    const math::Size2f dstPixel(dstEs.width / sizeInPixels.width
+                                , dstEs.height / sizeInPixels.height);
+
+    const vts::CsConvertor dst2src(srs, srs_);
+
+    // pixel in source raster
+    const auto srcGrid([&](const math::Point2 &p)
+    {
+        return math::Point2((p(0) - srcExtents.ll(0)) / srcPixel.width
+                            , (srcExtents.ur(1) - p(1)) / srcPixel.height);
+    });
+
+    // block extents in destination SRS
+    const auto blockExtents([&](const cv::Rect &block)
+    {
+        return math::Extents2
+            (math::Point2
+             (dstExtents.ll(0) + block.x * dstPixel.width
+              , dstExtents.ur(1) - (block.y + block.height) * dstPixel.height)
+             , math::Point2
+             (dstExtents.ll(0) + (block.x + block.width) * dstPixel.width
+              , dstExtents.ur(1) - block.y * dstPixel.height));
+    });
+
+    // estimate scale between destination and source pixels
+    double scale(1.0);
+    {
+        const auto e(dst2src(dstExtents));
+        const auto es(size(e));
+        scale = std::max({ scale
+                    , (es.width / srcPixel.width) / sizeInPixels.width
+                    , (es.height / srcPixel.height) / sizeInPixels.height });
+    }
+
+    const int halo(4);
+
+    auto dst(raster(sizeInPixels));
+    forEachBlock(sizeInPixels, blockSize(halo, scale)
+                 , [&](const cv::Rect &block)
+    {
+        const auto be(blockExtents(block));
+
+        // sample block boundary and convert it to source SRS
+        const int samples(16);
+        const auto bes(size(be));
+        math::Points2 boundary;
+        for (int i(0); i <= samples; ++i) {
+            const double x(be.ll(0) + (i * bes.width) / samples);
+            const double y(be.ll(1) + (i * bes.height) / samples);
+            boundary.emplace_back(x, be.ll(1));
+            boundary.emplace_back(x, be.ur(1));
+            boundary.emplace_back(be.ll(0), y);
+            boundary.emplace_back(be.ur(0), y);
+        }
+        dst2src.convert(boundary);
+
+        math::Extents2 se(math::InvalidExtents{});
+        for (const auto &p : boundary) { update(se, srcGrid(p)); }
+
+        const auto window(sourceWindow(se.ll, se.ur, halo)
+                          & pane_->bounds());
+        if (!window.area()) { return; }
+
+        const auto src(pane_->read(window));
+        if (allInvalid(src)) { return; }
+
+        // source window extents
+        const math::Extents2 we
+            (math::Point2
+             (srcExtents.ll(0) + window.x * srcPixel.width
+              , srcExtents.ur(1)
+              - (window.y + window.height) * srcPixel.height)
+             , math::Point2
+             (srcExtents.ll(0) + (window.x + window.width) * srcPixel.width
+              , srcExtents.ur(1) - window.y * srcPixel.height));
+
+        dst->write(warpPane(src, we, srcSrs.srsDef, be
+                            , math::Size2(block.width, block.height)
+                            , dstSrs.srsDef, srs
+                            , referenceFrame_->model.navigationSrs
+                            , referenceFrame.model.navigationSrs)
+                   , block.x, block.y);
+    });
+
+    // set new content
+    lod_ = lod;
+    tileRange_ = tileRange;
+    sizeInTiles_ = sizeInTiles;
+    sizeInPixels_ = sizeInPixels;
+    pane_ = std::move(dst);
+    srs_ = srs;
+    updateWorldExtents(extents);
+    referenceFrame_ = &referenceFrame;
+}
+
+vts::NavTile::pointer TiledHeightMap::navtile(const vts::TileId &tileId)
+    const
+{
+    if (tileId.lod != lod_) {
+        LOGTHROW(err2, std::runtime_error)
+            << "Cannot generate navtile for " << tileId << " from data at LOD "
+            << lod_ << ".";
+    }
+
+    // find place for tile data and copy if in valid range
+    if (!inside(tileRange_, vts::point(tileId))) {
+        LOG(info1) << "No navtile data for tile " << tileId << ".";
+        return {};
+    }
+
+    // we know that tileId is inside tileRange, get pixel offset
+    const cv::Rect window((tileId.x - tileRange_.ll(0)) * tileGrid_.width
+                          , (tileId.y - tileRange_.ll(1)) * tileGrid_.height
+                          , tileSize_.width, tileSize_.height);
+
+    return navtileFromPane(pane_->read(window));
+}
+
+boost::optional<TiledHeightMap::DataType>
+TiledHeightMap::reconstruct(const math::Point2 &point) const
+{
+    // sanity check
+    if (!math::inside(worldExtents_, point)) { return boost::none; }
+
+    const math::Point2 pos(math::transform(world2Grid_, point));
+
+    // read neighbourhood covering filter support
+    const int halo(4);
+    const auto window(sourceWindow(pos, pos, halo) & pane_->bounds());
+    if (!window.area()) { return boost::none; }
+    const auto src(pane_->read(window));
+
+    // try to reconstruct
+    const HeightMapRaster raster(src, InvalidHeight);
+    const auto height(imgproc::reconstruct
+                      (raster, math::CatmullRom2(2.0, 2.0)
+                       , math::Point2(pos(0) - window.x
+                                      , pos(1) - window.y))[0]);
+
+    if (height == InvalidHeight) {
+        return boost::none;
+    }
+
+    return height;
+}
+
+HeightMap::BestPosition TiledHeightMap::bestPosition() const
+{
+    HeightMap::BestPosition out;
+
+    if (empty()) { return out; }
+
+    auto &c(out.location);
+
+    math::Extents2i validExtents(math::InvalidExtents{});
+
+    long count(0);
+    forEachBlock(sizeInPixels_, blockSize(0), [&](const cv::Rect &block)
+    {
+        const auto data(pane_->read(block));
+        for (int j(0); j < data.rows; ++j) {
+            for (int i(0); i < data.cols; ++i) {
+                if (data.at<DataType>(j, i) == InvalidHeight) { continue; }
+
+                c(0) += block.x + i;
+                c(1) += block.y + j;
+                ++count;
+                update(validExtents
+                       , math::Point2i(block.x + i, block.y + j));
+            }
+        }
+    });
+
+    if (count) {
+        c(0) /= count;
+        c(1) /= count;
+    } else {
+        auto cc(math::center(validExtents));
+        c(0) = cc(0);
+        c(1) = cc(1);
+    }
+
+    if (count) {
+        c(2) = pane_->at(c(0), c(1));
+    } else {
+        // no valid pixel -> zero
+        c(2) = 0;
+    }
+
+    if (c(2) == InvalidHeight) {
+        // invalid pixel samples, find nearest valid pixel
+        c(2) = findNearestValid(*pane_, c(0), c(1));
+    }
+
+    bestPositionToWorld(out, validExtents, worldExtents_, sizeInPixels_);
+
+    // done
+    return out;
+}
+
 } } // vtslibs::vts
 
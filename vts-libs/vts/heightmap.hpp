@@ -27,8 +27,12 @@
 #define vts_heightmap_hpp_included_
 
 #include <limits>
+#include <map>
+#include <memory>
+#include <functional>
 
 #include <boost/optional.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include <opencv2/core/core.hpp>
@@ -153,21 +157,158 @@ struct HeightMap::BestPosition {
 class HeightMap::Accumulator {
 public:
     Accumulator(Lod lod);
+    ~Accumulator();
 
+    /** Returns tile data, creates new tile if not present.
+     *
+     *  Returned reference is valid only until next call to tile() or merge()
+     *  when memory limit is set since other tiles can be spilled to disk.
+     */
     cv::Mat& tile(const TileId &tileId);
 
+    /** Merges tile data into accumulated tile (per-pixel maximum).
+     */
+    void merge(const TileId &tileId, const cv::Mat &data);
+
+    /** Limits memory occupied by accumulated tiles. Least recently used tiles
+     *  over the limit are spilled to temporary file in tmpDir.
+     *
+     *  Zero limit means no limit.
+     */
+    void memoryLimit(std::size_t limit, const boost::filesystem::path &tmpDir);
+
+    /** Spills all resident tiles if memory limit is set.
+     */
+    void spill();
+
     const math::Size2& tileSize() const { return tileSize_; }
 
     typedef TileRange::point_type Index;
 
 private:
     friend class HeightMap;
+    friend class TiledHeightMap;
+
+    struct Tile {
+        /** Tile data, empty if tile is spilled.
+         */
+        cv::Mat data;
+
+        /** Offset in spill file, negative if never spilled.
+         */
+        long offset;
+
+        Tile() : offset(-1) {}
+    };
+    typedef std::map<Index, Tile> Tiles;
+
+    struct Spill;
+
+    Tile& get(const Index &index);
+
+    /** Calls op(index, data) for each tile, including spilled ones.
+     */
+    void forEach(const std::function<void(const Index&, const cv::Mat&)> &op);
+
+    void clear();
 
     Lod lod_;
     math::Size2 tileSize_;
-    typedef std::map<Index, cv::Mat> Tiles;
     Tiles tiles_;
     TileRange tileRange_;
+    std::unique_ptr<Spill> spill_;
+};
+
+/** Out-of-core heightmap.
+ *
+ *  Same functionality as HeightMap needed for navtile generation but pane is
+ *  kept in disk-backed raster split into blocks. All operations are processed
+ *  block by block (with halo wide enough for given operation), peak memory is
+ *  thus bounded by configured budget instead of heightmap size.
+ */
+class TiledHeightMap : boost::noncopyable {
+public:
+    typedef HeightMap::DataType DataType;
+    static constexpr DataType InvalidHeight = HeightMap::InvalidHeight;
+
+    struct Config {
+        /** Memory budget (in bytes) for whole heightmap processing.
+         */
+        std::size_t memoryBudget;
+
+        /** Directory for temporary files. Uses system temporary directory
+         *  if empty.
+         */
+        boost::filesystem::path tmpDir;
+
+        Config() : memoryBudget(std::size_t(1) << 30) {}
+    };
+
+    /** Heightmap generation constructor. Consumes accumulator.
+     */
+    TiledHeightMap(HeightMap::Accumulator &&accumulator
+                   , const registry::ReferenceFrame &referenceFrame
+                   , double dtmExtractionRadius
+                   , const Config &config = Config());
+
+    ~TiledHeightMap();
+
+    math::Size2 size() const { return sizeInPixels_; };
+
+    bool empty() const { return math::empty(sizeInPixels_); };
+
+    /** Resizes this heightmap. Same semantics as HeightMap::resize.
+     */
+    void resize(Lod lod);
+
+    /** Halve pane size to one half. Same semantics as HeightMap::halve.
+     */
+    void halve();
+
+    /** Generic warper. Same semantics as HeightMap::warp.
+     */
+    void warp(const registry::ReferenceFrame &referenceFrame
+              , Lod lod, const TileRange &tileRange);
+
+    /** Returns navtile for given tile.
+     *  Throws when tileId.lod != lod_.
+     */
+    NavTile::pointer navtile(const TileId &tileId) const;
+
+    HeightMap::BestPosition bestPosition() const;
+
+    /** Reconstruct point at given world position.
+     */
+    boost::optional<DataType> reconstruct(const math::Point2 &point) const;
+
+    class Raster;
+
+private:
+    /** Sets world extents and grid transformation.
+     */
+    void updateWorldExtents(const math::Extents2 &we);
+
+    /** Creates new raster with given size.
+     */
+    std::unique_ptr<Raster> raster(const math::Size2 &size) const;
+
+    /** Processing block size (in output pixels) for given halo and
+     *  input/output scale.
+     */
+    int blockSize(int halo, double scale = 1.0) const;
+
+    const registry::ReferenceFrame *referenceFrame_;
+    Config config_;
+    math::Size2 tileSize_;
+    math::Size2 tileGrid_;
+    Lod lod_;
+    TileRange tileRange_;
+    math::Size2 sizeInTiles_;
+    math::Size2 sizeInPixels_;
+    std::unique_ptr<Raster> pane_;
+    std::string srs_; // registry srs
+    math::Extents2 worldExtents_;
+    math::Matrix4 world2Grid_;
 };
 
 /** DTMize geodataset. Applies morphological opening `count` times in each
@@ -0,0 +1,341 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <fstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+
+#include <boost/filesystem.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "utility/filedes.hpp"
+#include "utility/raise.hpp"
+#include "utility/path.hpp"
+#include "utility/binaryio.hpp"
+#include "utility/streams.hpp"
+
+#include "../storage/error.hpp"
+
+#include "mappedtileindex.hpp"
+
+namespace vtslibs { namespace vts {
+
+namespace fs = boost::filesystem;
+namespace bin = utility::binaryio;
+
+namespace {
+
+const char MAGIC[4] = { 'T', 'I', 'M', 'M' };
+const std::uint16_t VERSION(1);
+
+struct Header {
+    char magic[4];
+    std::uint16_t version;
+    std::uint8_t minLod;
+    std::uint8_t lodCount;
+    std::uint32_t allSetFlags;
+    std::uint32_t reserved;
+    std::uint64_t fileSize;
+};
+
+struct LodEntry {
+    std::uint32_t order;
+    std::uint32_t reserved;
+    std::uint64_t nodeCount;
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+static_assert(sizeof(Header) == 24, "Unexpected mapped tileindex header size.");
+static_assert(sizeof(LodEntry) == 32
+              , "Unexpected mapped tileindex lod entry size.");
+
+typedef CompactQTreeView::Node Node;
+
+} // namespace
+
+MappedTileIndex::MappedTileIndex(const fs::path &path)
+    : path_(path), data_(nullptr), size_(), minLod_(), allSetFlags_()
+{
+    utility::Filedes fd(::open(path.string().c_str(), O_RDONLY), path);
+    if (!fd) {
+        LOGTHROW(err1, storage::NoSuchFile)
+            << "Unable to open mapped tileindex " << path << ": "
+            << std::system_category().message(errno) << ".";
+    }
+
+    struct ::stat st;
+    if (-1 == ::fstat(fd, &st)) {
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError
+             ("Unable to stat mapped tileindex %s.", path));
+        LOG(err2) << e.what();
+        throw e;
+    }
+    size_ = st.st_size;
+
+    if (size_ < sizeof(Header)) {
+        LOGTHROW(err1, storage::BadFileFormat)
+            << "File " << path << " is not a mapped tileindex (too short).";
+    }
+
+    auto data(::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0));
+    if (MAP_FAILED == data) {
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError
+             ("Unable to map tileindex file %s.", path));
+        LOG(err2) << e.what();
+        throw e;
+    }
+    data_ = static_cast<const char*>(data);
+
+    // tree nodes are accessed randomly
+    ::madvise(data, size_, MADV_RANDOM);
+
+    // mapping stays valid after closing the descriptor
+    fd.close();
+
+    try {
+        Header header;
+        std::memcpy(&header, data_, sizeof(header));
+
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC))) {
+            LOGTHROW(err1, storage::BadFileFormat)
+                << "File " << path << " is not a mapped tileindex.";
+        }
+        if (header.version != VERSION) {
+            LOGTHROW(err1, storage::BadFileFormat)
+                << "File " << path << " has unsupported mapped tileindex "
+                << "version <" << header.version << ">.";
+        }
+        if ((header.fileSize != size_)
+            || (size_ < (sizeof(Header)
+                         + header.lodCount * sizeof(LodEntry))))
+        {
+            LOGTHROW(err1, storage::BadFileFormat)
+                << "Mapped tileindex " << path << " is truncated.";
+        }
+
+        minLod_ = header.minLod;
+        allSetFlags_ = header.allSetFlags;
+
+        const auto *entries
+            (reinterpret_cast<const LodEntry*>(data_ + sizeof(Header)));
+        trees_.reserve(header.lodCount);
+        counts_.reserve(header.lodCount);
+        for (const auto *e(entries), *ee(entries + header.lodCount);
+             e != ee; ++e)
+        {
+            if ((e->order > 31) || !e->nodeCount
+                || (e->offset % sizeof(Node))
+                || (e->offset > size_)
+                || (e->nodeCount > ((size_ - e->offset) / sizeof(Node))))
+            {
+                LOGTHROW(err1, storage::BadFileFormat)
+                    << "Mapped tileindex " << path << " has invalid lod "
+                    << "entry at lod " << (minLod_ + (e - entries)) << ".";
+            }
+
+            trees_.emplace_back
+                (e->order, reinterpret_cast<const Node*>(data_ + e->offset)
+                 , e->nodeCount);
+            counts_.push_back(e->count);
+        }
+    } catch (...) {
+        ::munmap(const_cast<char*>(data_), size_);
+        throw;
+    }
+
+    LOG(info1) << "Mapped tileindex " << path << " (" << size_
+               << " bytes, lods " << lodRange() << ").";
+}
+
+MappedTileIndex::~MappedTileIndex()
+{
+    if (data_) { ::munmap(const_cast<char*>(data_), size_); }
+}
+
+LodRange MappedTileIndex::lodRange() const
+{
+    if (trees_.empty()) { return LodRange::emptyRange(); }
+    return LodRange(minLod(), maxLod());
+}
+
+std::size_t MappedTileIndex::count() const
+{
+    std::size_t count(0);
+    for (auto c : counts_) { count += c; }
+    return count;
+}
+
+bool MappedTileIndex::validSubtree(Lod lod, const TileId &tileId) const
+{
+    if (trees_.empty()) { return false; }
+
+    // check all tileindex layers from tileId's lod to the bottom
+    for (auto elod(maxLod()); lod <= elod; ++lod) {
+        if (const auto *m = tree(lod)) {
+            // existing layer -> check if there is something in the layer's tree
+            // trimmed to tileId's lod depth
+            if (m->get(tileId.lod, tileId.x, tileId.y)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool MappedTileIndex::validSubtree(const TileId &tileId) const
+{
+    return validSubtree(tileId.lod, tileId);
+}
+
+template <typename Match>
+MappedTileIndex::Stat MappedTileIndex::statMatching(const Match &match)
+    const
+{
+    Stat stat;
+
+    auto lod(minLod_);
+    for (const auto &tree : trees_) {
+        stat.tileRanges.emplace_back(math::InvalidExtents{});
+        auto &tileRange(stat.tileRanges.back());
+
+        tree.forEachNode([&](unsigned int x, unsigned int y, unsigned int size
+                             , QTree::value_type v)
+        {
+            if (!match(v)) { return; }
+
+            // remember lod
+            storage::update(stat.lodRange, lod);
+
+            // update tile range
+            math::update(tileRange, x, y);
+            math::update(tileRange, x + size - 1, y + size - 1);
+
+            stat.count += (std::size_t(size) * std::size_t(size));
+        });
+        ++lod;
+    }
+
+    if (stat.lodRange.empty()) {
+        // nothing, drop whole tileRanges
+        stat.tileRanges.clear();
+    } else {
+        // remove difference between minLod and stat.lodRange.min (if any)
+        stat.tileRanges.erase
+            (stat.tileRanges.begin()
+             , stat.tileRanges.begin() + (stat.lodRange.min - minLod_));
+    }
+
+    return stat;
+}
+
+MappedTileIndex::Stat MappedTileIndex::statMask(QTree::value_type mask)
+    const
+{
+    return statMatching([&](QTree::value_type v) { return (v & mask); });
+}
+
+MappedTileIndex::Stat MappedTileIndex::statMask(QTree::value_type mask
+                                                , QTree::value_type value)
+    const
+{
+    return statMatching([&](QTree::value_type v)
+    {
+        return (v & mask) == value;
+    });
+}
+
+void MappedTileIndex::write(const TileIndex &tileIndex, const fs::path &path)
+{
+    std::vector<CompactQTree> trees;
+    trees.reserve(tileIndex.trees().size());
+    for (const auto &tree : tileIndex.trees()) {
+        trees.emplace_back(tree);
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.minLod = tileIndex.minLod();
+    header.lodCount = trees.size();
+    header.allSetFlags = 0;
+    header.reserved = 0;
+
+    // lay out node arrays after lod table
+    std::vector<LodEntry> entries;
+    std::uint64_t offset(sizeof(Header) + trees.size() * sizeof(LodEntry));
+    for (const auto &tree : trees) {
+        LodEntry e;
+        e.order = tree.order();
+        e.reserved = 0;
+        e.nodeCount = tree.nodeCount();
+        e.offset = offset;
+        e.count = tree.count();
+        entries.push_back(e);
+
+        header.allSetFlags |= tree.allSetFlags();
+        offset += tree.nodeCount() * sizeof(Node);
+    }
+    header.fileSize = offset;
+
+    const auto tmpPath(utility::addExtension(path, ".tmp"));
+    utility::ofstreambuf f;
+    f.exceptions(std::ios::failbit | std::ios::badbit);
+    f.open(tmpPath.string(), std::ios_base::out | std::ios_base::trunc);
+
+    bin::write(f, header);
+    for (const auto &e : entries) { bin::write(f, e); }
+    for (const auto &tree : trees) {
+        f.write(reinterpret_cast<const char*>(tree.view().nodes())
+                , tree.nodeCount() * sizeof(Node));
+    }
+    f.close();
+
+    fs::rename(tmpPath, path);
+}
+
+bool MappedTileIndex::check(const fs::path &path)
+{
+    std::ifstream f(path.string(), std::ios_base::in | std::ios_base::binary);
+    if (!f) { return false; }
+
+    char magic[sizeof(MAGIC)];
+    f.read(magic, sizeof(magic));
+    if (!f) { return false; }
+    return !std::memcmp(magic, MAGIC, sizeof(MAGIC));
+}
+
+} } // namespace vtslibs::vts
@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/mappedtileindex.hpp
+ *
+ * Read-only tile index queried directly from memory-mapped file.
+ */
+
+#ifndef vtslibs_vts_mappedtileindex_hpp_included_
+#define vtslibs_vts_mappedtileindex_hpp_included_
+
+#include <memory>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include "tileindex.hpp"
+#include "compactqtree.hpp"
+
+namespace vtslibs { namespace vts {
+
+/** Tile index in memory-mappable format.
+ *
+ *  File holds one compact quad tree (see CompactQTreeView) per lod. Trees are
+ *  used in-place from read-only shared mapping, i.e. nothing is parsed on
+ *  open and all processes using the same file share one page-cached copy.
+ *
+ *  Format (native little-endian, all offsets from file start):
+ *
+ *      header:
+ *          char[4] magic "TIMM"
+ *          uint16 version
+ *          uint8 minLod
+ *          uint8 lodCount
+ *          uint32 allSetFlags
+ *          uint32 reserved
+ *          uint64 fileSize
+ *
+ *      lodCount times lod entry:
+ *          uint32 order
+ *          uint32 reserved
+ *          uint64 nodeCount
+ *          uint64 offset (8-byte aligned)
+ *          uint64 count (number of non-zero tiles)
+ *
+ *      node arrays (nodeCount times { uint32 value; uint32 children; })
+ */
+class MappedTileIndex : boost::noncopyable {
+public:
+    typedef std::shared_ptr<MappedTileIndex> pointer;
+    typedef TileIndex::Flag Flag;
+    typedef TileIndex::Stat Stat;
+
+    /** Maps given file. Throws storage::BadFileFormat on invalid file.
+     */
+    explicit MappedTileIndex(const boost::filesystem::path &path);
+
+    ~MappedTileIndex();
+
+    QTree::value_type get(const TileId &tileId) const;
+
+    bool exists(const TileId &tileId) const { return get(tileId); }
+
+    /** Returns true if there is any non-zero record in subtree rooted by
+     *  tileId.
+     */
+    bool validSubtree(const TileId &tileId) const;
+
+    /** Alternative version of validSubtree. Starts at given lod.
+     */
+    bool validSubtree(Lod lod, const TileId &tileId) const;
+
+    /** Get statistics for all tiles with given mask.
+     */
+    Stat statMask(QTree::value_type mask) const;
+
+    /** Get statistics for all tiles with given mask and value.
+     */
+    Stat statMask(QTree::value_type mask, QTree::value_type value) const;
+
+    /** Runs op(tileId, value) for every tile based on filter.
+     */
+    template <typename Op>
+    void forEach(const Op &op, QTree::Filter filter = QTree::Filter::white)
+        const;
+
+    const CompactQTreeView* tree(Lod lod) const;
+
+    bool empty() const { return trees_.empty(); }
+
+    Lod minLod() const { return minLod_; }
+
+    Lod maxLod() const { return minLod_ + int(trees_.size()) - 1; }
+
+    LodRange lodRange() const;
+
+    /** Returns count of tiles in the index.
+     */
+    std::size_t count() const;
+
+    QTree::value_type allSetFlags() const { return allSetFlags_; }
+
+    const boost::filesystem::path& path() const { return path_; }
+
+    /** Writes given tile index in memory-mappable format. File is written
+     *  under temporary name and renamed to final one.
+     */
+    static void write(const TileIndex &tileIndex
+                      , const boost::filesystem::path &path);
+
+    /** Checks whether given file is memory-mappable tile index.
+     */
+    static bool check(const boost::filesystem::path &path);
+
+private:
+    template <typename Match>
+    Stat statMatching(const Match &match) const;
+
+    boost::filesystem::path path_;
+    const char *data_;
+    std::size_t size_;
+
+    Lod minLod_;
+    QTree::value_type allSetFlags_;
+    std::vector<CompactQTreeView> trees_;
+    std::vector<std::size_t> counts_;
+};
+
+// inlines
+
+inline const CompactQTreeView* MappedTileIndex::tree(Lod lod) const
+{
+    auto idx(lod - minLod_);
+    if ((idx < 0) || (idx >= int(trees_.size()))) {
+        return nullptr;
+    }
+    return &trees_[idx];
+}
+
+inline QTree::value_type MappedTileIndex::get(const TileId &tileId) const
+{
+    const auto *m(tree(tileId.lod));
+    if (!m) { return 0; }
+    return m->get(tileId.x, tileId.y);
+}
+
+template <typename Op>
+void MappedTileIndex::forEach(const Op &op, QTree::Filter filter) const
+{
+    auto lod(minLod_);
+    for (const auto &tree : trees_) {
+        tree.forEach([&](unsigned int x, unsigned int y
+                         , QTree::value_type value)
+        {
+            op(TileId(lod, x, y), value);
+        }, filter);
+        ++lod;
+    }
+}
+
+} } // namespace vtslibs::vts
+
+#endif // vtslibs_vts_mappedtileindex_hpp_included_
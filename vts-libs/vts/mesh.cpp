@@ -23,9 +23,13 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <array>
+#include <algorithm>
+
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/restrict.hpp>
+#include <boost/iostreams/device/array.hpp>
 
 #include "dbglog/dbglog.hpp"
 
@@ -41,6 +45,7 @@
 #include "../storage/error.hpp"
 
 #include "mesh.hpp"
+#include "compactmesh.hpp"
 #include "meshio.hpp"
 #include "multifile.hpp"
 #include "math.hpp"
@@ -117,9 +122,18 @@ GeomExtents geomExtents(const ConstSubMeshRange &smRange)
 
 GeomExtents geomExtents(const CsConvertor &conv, const SubMesh &submesh)
 {
+    // convert in small batches through fixed buffer, no per-submesh copy
+    constexpr std::size_t BatchSize(256);
+    std::array<math::Point3, BatchSize> batch;
+
     GeomExtents ge;
-    for (const auto &v : submesh.vertices) {
-        update(ge, conv(v)(2));
+    const auto &vertices(submesh.vertices);
+    for (std::size_t i(0), e(vertices.size()); i < e; i += BatchSize) {
+        const auto count(std::min(BatchSize, e - i));
+        std::copy(vertices.begin() + i, vertices.begin() + i + count
+                  , batch.begin());
+        conv.convert(batch.data(), count);
+        for (std::size_t j(0); j < count; ++j) { update(ge, batch[j](2)); }
     }
     return ge;
 }
@@ -408,7 +422,8 @@ std::uint8_t MF_PROPERTY_ZINDEX = 1;
 
 /** Compose properties flags.
  */
-std::uint8_t propertiesFlags(const Mesh &mesh)
+template <typename MeshType>
+std::uint8_t propertiesFlags(const MeshType &mesh)
 {
     std::uint8_t flags(0);
     for (const auto &sm : mesh.submeshes) {
@@ -418,8 +433,9 @@ std::uint8_t propertiesFlags(const Mesh &mesh)
     return flags;
 }
 
+template <typename MeshType>
 void saveMeshProperties(std::uint16_t version, std::ostream &out
-                        , const Mesh &mesh, std::uint8_t flags)
+                        , const MeshType &mesh, std::uint8_t flags)
 {
     if (flags) { bin::write<std::uint8_t>(out, flags); }
 
@@ -434,7 +450,8 @@ void saveMeshProperties(std::uint16_t version, std::ostream &out
     (void) version;
 }
 
-void saveSurfaceMapping(std::ostream &out, const Mesh &mesh)
+template <typename MeshType>
+void saveSurfaceMapping(std::ostream &out, const MeshType &mesh)
 {
     if ((mesh.submeshes.size() == 1)
         && (mesh.submeshes.front().surfaceReference == 1))
@@ -486,6 +503,44 @@ void saveMesh(const fs::path &path, const Mesh &mesh, const Atlas *atlas)
     f.close();
 }
 
+void saveCompactMesh(std::ostream &out, const CompactMesh &mesh)
+{
+    const auto flags(propertiesFlags(mesh));
+    const auto version(flags ? MF_VERSION_PROPERTY_FLAGS : MF_VERSION_OLD);
+
+    multifile::Table table(version, MF_MAGIC);
+
+    auto p(out.tellp());
+
+    {
+        // save gzipped, same as saveMeshProper
+        bio::filtering_ostream gzipped;
+        gzipped.push(bio::gzip_compressor(bio::gzip_params(9), 1 << 16));
+        gzipped.push(out);
+        detail::saveMeshProper(gzipped, mesh.submeshes);
+        gzipped.flush();
+    }
+
+    p = table.add(p, out.tellp() - p);
+
+    // save mask + surface references (used by 2d interface)
+    mesh.coverageMask.save(out);
+    saveSurfaceMapping(out, mesh);
+    p = table.add(p, out.tellp() - p);
+
+    saveMeshProperties(table.version, out, mesh, flags);
+    table.entries.emplace_back(p, out.tellp() - p);
+
+    multifile::writeTable(table, out);
+}
+
+void saveCompactMesh(const fs::path &path, const CompactMesh &mesh)
+{
+    utility::ofstreambuf f(path.string());
+    saveCompactMesh(f, mesh);
+    f.close();
+}
+
 void saveMeshProper(std::ostream &out, const ConstSubMeshRange &submeshes
                     , const Atlas *atlas, bool compress)
 {
@@ -505,7 +560,9 @@ void saveMeshProper(std::ostream &out, const ConstSubMeshRange &submeshes
 
 namespace {
 
-void loadMeshProperties(std::uint16_t version, std::istream &in, Mesh &mesh)
+template <typename MeshType>
+void loadMeshProperties(std::uint16_t version, std::istream &in
+                        , MeshType &mesh)
 {
     std::uint8_t flags(0);
     if (version >= MF_VERSION_PROPERTY_FLAGS) {
@@ -547,33 +604,119 @@ multifile::Table readMeshTable(std::istream &is
         .checkEntryCount(3, path);
 }
 
+namespace {
+
+/** Decompresses whole gzipped source into memory buffer.
+ */
+template <typename Source>
+void gunzip(const Source &source, std::vector<char> &out)
+{
+    bio::filtering_istream gzipped;
+    gzipped.push
+        (bio::gzip_decompressor(bio::gzip_params().window_bits, 1 << 16));
+    gzipped.push(source);
+    gzipped.exceptions(std::ios::badbit);
+
+    char chunk[1 << 16];
+    while (gzipped) {
+        gzipped.read(chunk, sizeof(chunk));
+        out.insert(out.end(), chunk, chunk + gzipped.gcount());
+    }
+}
+
+/** Loads mesh proper from given table entry. Data are loaded to memory
+ *  (decompressed if needed) and decoded from there. Stream's memory (if
+ *  available) is used directly.
+ *
+ *  Target is anything accepted by detail::loadMeshProper(data, size, ...).
+ */
+template <typename Target>
+void loadMeshProper(std::istream &in, const multifile::Table::Entry &entry
+                    , const fs::path &path, Target &mesh
+                    , const boost::optional<storage::ReadOnlyMemory> &memory
+                    = boost::none)
+{
+    std::vector<char> buffer;
+
+    if (memory) {
+        if ((entry.start > memory->size)
+            || (entry.size > (memory->size - entry.start)))
+        {
+            LOGTHROW(err1, storage::BadFileFormat)
+                << "Mesh " << path << " is truncated.";
+        }
+
+        const char *data(memory->data + entry.start);
+        if (entry.size && (data[0] == 0x1f)) {
+            // gzipped
+            gunzip(bio::array_source(data, entry.size), buffer);
+        } else {
+            // raw data, decode in place
+            detail::loadMeshProper(data, entry.size, path, mesh);
+            return;
+        }
+    } else {
+        in.seekg(entry.start);
+        if (storage::gzipped(in)) {
+            // add input restricted to mesh data
+            gunzip(bio::restrict(in, entry.start, entry.size), buffer);
+        } else {
+            // raw file
+            buffer.resize(entry.size);
+            in.read(buffer.data(), buffer.size());
+        }
+    }
+
+    detail::loadMeshProper(buffer.data(), buffer.size(), path, mesh);
+}
+
+} // namespace
+
 Mesh loadMesh(std::istream &in, const fs::path &path)
+{
+    return loadMesh(in, path, boost::none);
+}
+
+Mesh loadMesh(std::istream &in, const fs::path &path
+              , const boost::optional<storage::ReadOnlyMemory> &memory)
 {
     const auto table(readMeshTable(in, path));
 
     Mesh mesh;
 
-    in.seekg(table.entries[0].start);
-    if (storage::gzipped(in)) {
-        // looks like a gzip
-        bio::filtering_istream gzipped;
+    loadMeshProper(in, table.entries[0], path, mesh, memory);
+
+    in.seekg(table.entries[1].start);
+    mesh.coverageMask.load(in, path);
+
+    in.seekg(table.entries[2].start);
+    loadMeshProperties(table.version, in, mesh);
+
+    return mesh;
+}
+
+Mesh loadMesh(const storage::IStream::pointer &in)
+{
+    return loadMesh(*in, in->name(), in->memory());
+}
 
-        // create and add decompressor
-        gzipped.push
-            (bio::gzip_decompressor(bio::gzip_params().window_bits, 1 << 16));
+Mesh loadMesh(const fs::path &path)
+{
+    utility::ifstreambuf f(path.string());
+    auto mesh(loadMesh(f, path));
+    f.close();
+    return mesh;
+}
 
-        // add input restricted to mesh data
-        auto rin(bio::restrict(in, table.entries[0].start,
-                                   table.entries[0].size));
-        gzipped.push(rin);
+CompactMesh loadCompactMesh(std::istream &in, const fs::path &path
+                            , const boost::optional<storage::ReadOnlyMemory>
+                            &memory)
+{
+    const auto table(readMeshTable(in, path));
 
-        gzipped.exceptions(in.exceptions());
+    CompactMesh mesh;
 
-        detail::loadMeshProper(gzipped, path, mesh);
-    } else {
-        // raw file
-        detail::loadMeshProper(in, path, mesh);
-    }
+    loadMeshProper(in, table.entries[0], path, mesh.submeshes, memory);
 
     in.seekg(table.entries[1].start);
     mesh.coverageMask.load(in, path);
@@ -584,10 +727,15 @@ Mesh loadMesh(std::istream &in, const fs::path &path)
     return mesh;
 }
 
-Mesh loadMesh(const fs::path &path)
+CompactMesh loadCompactMesh(const storage::IStream::pointer &in)
+{
+    return loadCompactMesh(*in, in->name(), in->memory());
+}
+
+CompactMesh loadCompactMesh(const fs::path &path)
 {
     utility::ifstreambuf f(path.string());
-    auto mesh(loadMesh(f, path));
+    auto mesh(loadCompactMesh(f, path));
     f.close();
     return mesh;
 }
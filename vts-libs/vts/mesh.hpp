@@ -486,6 +486,13 @@ void saveMesh(const boost::filesystem::path &path, const Mesh &mesh
 
 Mesh loadMesh(std::istream &in, const boost::filesystem::path &path
               = "unknown");
+
+/** Loads mesh from stream; mesh proper is decoded directly from provided
+ *  memory (i.e. memory of whole stream) if set. Data past the end of the
+ *  memory block are rejected.
+ */
+Mesh loadMesh(std::istream &in, const boost::filesystem::path &path
+              , const boost::optional<storage::ReadOnlyMemory> &memory);
 Mesh loadMesh(const boost::filesystem::path &path);
 
 void saveMesh(const storage::OStream::pointer &out, const Mesh &mesh
@@ -577,10 +584,6 @@ inline void saveMesh(const storage::OStream::pointer &out, const Mesh &mesh
     return saveMesh(*out, mesh, atlas);
 }
 
-inline Mesh loadMesh(const storage::IStream::pointer &in)
-{
-    return loadMesh(*in, in->name());
-}
 
 inline MeshMask loadMeshMask(const storage::IStream::pointer &in)
 {
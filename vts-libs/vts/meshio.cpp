@@ -26,6 +26,8 @@
 
 #include <vector>
 #include <numeric>
+#include <limits>
+#include <cstring>
 
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
@@ -44,6 +46,7 @@
 #include "../registry/referenceframe.hpp"
 
 #include "mesh.hpp"
+#include "meshio.hpp"
 #include "atlas.hpp"
 
 namespace fs = boost::filesystem;
@@ -498,6 +501,105 @@ void saveMeshVersion2(std::ostream &out, const ConstSubMeshRange &submeshes)
     }
 }
 
+void saveMeshVersion2(std::ostream &out
+                      , const CompactSubMesh::list &submeshes)
+{
+    auto checkCount([&](std::size_t count, const char *what)
+    {
+        if (count > std::numeric_limits<std::uint16_t>::max()) {
+            LOGTHROW(err2, std::runtime_error)
+                << "Too many " << what << " (" << count
+                << ") in compact submesh, cannot save.";
+        }
+    });
+
+    // write header
+    bin::write(out, MAGIC);
+    bin::write(out, std::uint16_t(2));
+
+    // no mean undulation
+    bin::write(out, double(0.0));
+
+    bin::write(out, std::uint16_t(submeshes.size()));
+
+    // write submeshes, quantized data are written as-is
+    for (const auto &sm : submeshes) {
+        checkCount(sm.vertexCount(), "vertices");
+        checkCount(sm.tcCount(), "texture coordinates");
+        checkCount(sm.faces.size(), "faces");
+        if (!sm.faces.narrow() || !sm.facesTc.narrow()) {
+            LOGTHROW(err2, std::runtime_error)
+                << "Face index out of 16-bit range in compact submesh, "
+                "cannot save.";
+        }
+
+        // build and write flags
+        std::uint8_t flags(0);
+        if (!sm.tc.empty()) {
+            flags |= SubMeshFlag::internalTexture;
+        }
+        if (!sm.etc.empty()) {
+            flags |= SubMeshFlag::externalTexture;
+        }
+        if (sm.textureMode == SubMesh::TextureMode::external) {
+            flags |= SubMeshFlag::textureMode;
+        }
+        bin::write(out, flags);
+
+        // surface reference (defaults to 1)
+        bin::write(out, std::uint8_t(sm.surfaceReference));
+
+        // write (external) texture layer information
+        bin::write(out, std::uint16_t(sm.textureLayer ? *sm.textureLayer : 0));
+
+        // write extents
+        bin::write(out, sm.bbox.ll(0));
+        bin::write(out, sm.bbox.ll(1));
+        bin::write(out, sm.bbox.ll(2));
+        bin::write(out, sm.bbox.ur(0));
+        bin::write(out, sm.bbox.ur(1));
+        bin::write(out, sm.bbox.ur(2));
+
+        // write sub-mesh data
+        const auto vertexCount(sm.vertexCount());
+        bin::write(out, std::uint16_t(vertexCount));
+
+        auto iv(sm.vertices.cbegin());
+        auto ietc(sm.etc.cbegin());
+        for (std::size_t i(0); i < vertexCount; ++i) {
+            bin::write(out, *iv++);
+            bin::write(out, *iv++);
+            bin::write(out, *iv++);
+
+            if (flags & SubMeshFlag::externalTexture) {
+                bin::write(out, *ietc++);
+                bin::write(out, *ietc++);
+            }
+        }
+
+        // save (internal) texture coordinates
+        if (flags & SubMeshFlag::internalTexture) {
+            bin::write(out, std::uint16_t(sm.tcCount()));
+            for (const auto value : sm.tc) { bin::write(out, value); }
+        }
+
+        // save faces
+        bin::write(out, std::uint16_t(sm.faces.size()));
+        for (std::size_t i(0), e(sm.faces.size()); i < e; ++i) {
+            bin::write(out, std::uint16_t(sm.faces.index(i, 0)));
+            bin::write(out, std::uint16_t(sm.faces.index(i, 1)));
+            bin::write(out, std::uint16_t(sm.faces.index(i, 2)));
+
+            // save (optional) texture coordinate indices
+            if (flags & SubMeshFlag::internalTexture) {
+                bin::write(out, std::uint16_t(sm.facesTc.index(i, 0)));
+                bin::write(out, std::uint16_t(sm.facesTc.index(i, 1)));
+                bin::write(out, std::uint16_t(sm.facesTc.index(i, 2)));
+            }
+        }
+    }
+}
+
 } // namespace
 
 void saveMeshProper(std::ostream &out, const ConstSubMeshRange &submeshes
@@ -512,6 +614,21 @@ void saveMeshProper(std::ostream &out, const ConstSubMeshRange &submeshes
     }
 }
 
+void saveMeshProper(std::ostream &out, const ConstSubMeshRange &submeshes
+                    , const Atlas *atlas, std::uint16_t version)
+{
+    if (version >= 3) {
+        saveMeshVersion3(out, submeshes, atlas);
+    } else {
+        saveMeshVersion2(out, submeshes);
+    }
+}
+
+void saveMeshProper(std::ostream &out, const CompactSubMesh::list &submeshes)
+{
+    saveMeshVersion2(out, submeshes);
+}
+
 #endif // VTSLIBS_BROWSER_ONLY
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -843,6 +960,531 @@ void loadMeshProperImpl(std::istream &in, const fs::path &path
     }
 }
 
+/** Mesh proper reader over contiguous memory buffer.
+ */
+class BufferReader {
+public:
+    BufferReader(const char *data, std::size_t size, const fs::path &path)
+        : p_(reinterpret_cast<const std::uint8_t*>(data))
+        , end_(p_ + size), path_(path)
+    {}
+
+    template <typename T> void read(T &value) {
+        need(sizeof(T));
+        std::memcpy(&value, p_, sizeof(T));
+        p_ += sizeof(T);
+    }
+
+    template <typename T> T read() {
+        T value;
+        read(value);
+        return value;
+    }
+
+    /** Decodes count zigzag/delta coded N-tuples (each component has its own
+     *  delta chain).
+     */
+    template <int N> void deltas(std::int32_t *out, std::size_t count) {
+        int last[N] = {};
+        int c(0);
+        words(count * N, [&](unsigned word)
+        {
+            *out++ = (last[c] += int((word >> 1) ^ (-(word & 1))));
+            if (++c == N) { c = 0; }
+        });
+    }
+
+    /** Decodes count delta coded indices.
+     */
+    void indices(std::uint16_t *out, std::size_t count) {
+        int high(0);
+        words(count, [&](unsigned delta)
+        {
+            *out++ = std::uint16_t(high - int(delta));
+            high += !delta;
+        });
+    }
+
+    const fs::path& path() const { return path_; }
+
+private:
+    void need(std::size_t size) const {
+        if (std::size_t(end_ - p_) < size) {
+            LOGTHROW(err1, storage::BadFileFormat)
+                << "Mesh " << path_ << " is truncated.";
+        }
+    }
+
+    /** Reads 1 or 2 byte word without branching on its size. At least 2
+     *  bytes must be available.
+     */
+    unsigned fastWord() {
+        const unsigned byte1(p_[0]), byte2(p_[1]);
+        const unsigned more(byte1 >> 7);
+        p_ += 1 + more;
+        return (byte1 & 0x7f) | ((byte2 << 7) & -more);
+    }
+
+    unsigned word() {
+        need(1);
+        if (!(*p_ & 0x80)) { return *p_++; }
+        need(2);
+        return fastWord();
+    }
+
+    /** Feeds count words to op. Since word has at most 2 bytes there is no
+     *  need to check every read when there is enough data.
+     */
+    template <typename Op> void words(std::size_t count, Op op) {
+        if (std::size_t(end_ - p_) >= 2 * count) {
+            while (count--) { op(fastWord()); }
+        } else {
+            while (count--) { op(word()); }
+        }
+    }
+
+    const std::uint8_t *p_;
+    const std::uint8_t *end_;
+    const fs::path &path_;
+};
+
+/** Submesh decoded from buffer, still quantized.
+ */
+struct QuantizedData {
+    std::uint16_t version;
+    std::uint8_t flags;
+    math::Extents3 bbox;
+
+    SubMesh::TextureMode textureMode;
+    boost::optional<std::uint16_t> textureLayer;
+    SubMesh::SurfaceReference surfaceReference;
+
+    std::uint16_t vertexQuant;
+    std::uint16_t etcQuant;
+    std::uint16_t tcQuant[2];
+
+    std::vector<std::int32_t> vertices;
+    std::vector<std::int32_t> etc;
+    std::vector<std::int32_t> tc;
+    std::vector<std::uint16_t> faces;
+    std::vector<std::uint16_t> facesTc;
+
+    QuantizedData()
+        : version(), flags(), textureMode(SubMesh::TextureMode::internal)
+        , surfaceReference(1), vertexQuant(), etcQuant(), tcQuant()
+    {}
+
+    /** Vertex dequantization: v = q * multiplier * scale + offset
+     *  Texture coordinates: t = q * multiplier
+     */
+    double vertexMultiplier() const;
+    double vertexScale(int i) const;
+    double vertexOffset(int i) const;
+    double etcMultiplier() const;
+    double tcMultiplier(int i) const;
+};
+
+const std::uint16_t Version2Quant(std::numeric_limits<std::uint16_t>::max());
+
+inline double QuantizedData::vertexMultiplier() const
+{
+    return ((version >= 3) ? 1.0 / vertexQuant : 1.0 / Version2Quant);
+}
+
+inline double QuantizedData::vertexScale(int i) const
+{
+    const math::Point3d bbsize(bbox.ur - bbox.ll);
+    if (version < 3) { return bbsize(i); }
+    return std::max(bbsize(0), std::max(bbsize(1), bbsize(2)));
+}
+
+inline double QuantizedData::vertexOffset(int i) const
+{
+    if (version < 3) { return bbox.ll(i); }
+    return 0.5 * (bbox.ll(i) + bbox.ur(i));
+}
+
+inline double QuantizedData::etcMultiplier() const
+{
+    return ((version >= 3) ? 1.0 / etcQuant : 1.0 / Version2Quant);
+}
+
+inline double QuantizedData::tcMultiplier(int i) const
+{
+    return ((version >= 3) ? 1.0 / tcQuant[i] : 1.0 / Version2Quant);
+}
+
+void decodeSubmeshVersion3(BufferReader &r, QuantizedData &q)
+{
+    // vertices
+    const auto vertexCount(r.read<std::uint16_t>());
+    r.read(q.vertexQuant);
+    q.vertices.resize(3 * vertexCount);
+    r.deltas<3>(q.vertices.data(), vertexCount);
+
+    // external texture coordinates
+    if (q.flags & SubMeshFlag::externalTexture) {
+        r.read(q.etcQuant);
+        q.etc.resize(2 * vertexCount);
+        r.deltas<2>(q.etc.data(), vertexCount);
+    }
+
+    // internal texture coordinates
+    if (q.flags & SubMeshFlag::internalTexture) {
+        const auto tcCount(r.read<std::uint16_t>());
+        r.read(q.tcQuant[0]);
+        r.read(q.tcQuant[1]);
+        q.tc.resize(2 * tcCount);
+        r.deltas<2>(q.tc.data(), tcCount);
+    }
+
+    // faces
+    const auto faceCount(r.read<std::uint16_t>());
+    q.faces.resize(3 * faceCount);
+    r.indices(q.faces.data(), q.faces.size());
+
+    if (q.flags & SubMeshFlag::internalTexture) {
+        q.facesTc.resize(3 * faceCount);
+        r.indices(q.facesTc.data(), q.facesTc.size());
+    }
+}
+
+void decodeSubmeshVersion2(BufferReader &r, QuantizedData &q)
+{
+    const bool etc(q.flags & SubMeshFlag::externalTexture);
+    const bool tc(q.flags & SubMeshFlag::internalTexture);
+
+    // vertices interleaved with external texture coordinates
+    const auto vertexCount(r.read<std::uint16_t>());
+    q.vertices.resize(3 * vertexCount);
+    if (etc) { q.etc.resize(2 * vertexCount); }
+
+    auto iv(q.vertices.begin());
+    auto ietc(q.etc.begin());
+    for (std::uint16_t i(0); i < vertexCount; ++i) {
+        *iv++ = r.read<std::uint16_t>();
+        *iv++ = r.read<std::uint16_t>();
+        *iv++ = r.read<std::uint16_t>();
+        if (etc) {
+            *ietc++ = r.read<std::uint16_t>();
+            *ietc++ = r.read<std::uint16_t>();
+        }
+    }
+
+    // internal texture coordinates
+    if (tc) {
+        q.tc.resize(2 * r.read<std::uint16_t>());
+        for (auto &value : q.tc) { value = r.read<std::uint16_t>(); }
+    }
+
+    // faces interleaved with texture coordinate faces
+    const auto faceCount(r.read<std::uint16_t>());
+    q.faces.resize(3 * faceCount);
+    if (tc) { q.facesTc.resize(3 * faceCount); }
+
+    auto if_(q.faces.begin());
+    auto iftc(q.facesTc.begin());
+    for (std::uint16_t i(0); i < faceCount; ++i) {
+        *if_++ = r.read<std::uint16_t>();
+        *if_++ = r.read<std::uint16_t>();
+        *if_++ = r.read<std::uint16_t>();
+        if (tc) {
+            *iftc++ = r.read<std::uint16_t>();
+            *iftc++ = r.read<std::uint16_t>();
+            *iftc++ = r.read<std::uint16_t>();
+        }
+    }
+}
+
+/** Converts decoded data to regular submesh. Uses the same arithmetic as
+ *  stream loaders.
+ */
+void convert(QuantizedData &q, SubMesh &sm)
+{
+    sm.textureMode = q.textureMode;
+    sm.textureLayer = q.textureLayer;
+    sm.surfaceReference = q.surfaceReference;
+
+    sm.vertices.resize(q.vertices.size() / 3);
+    {
+        const double multiplier(q.vertexMultiplier());
+        double scale[3], offset[3];
+        for (int i(0); i < 3; ++i) {
+            scale[i] = q.vertexScale(i);
+            offset[i] = q.vertexOffset(i);
+        }
+
+        auto iq(q.vertices.cbegin());
+        if (q.version >= 3) {
+            for (auto &vertex : sm.vertices) {
+                for (int i(0); i < 3; ++i) {
+                    vertex(i) = (double(*iq++) * multiplier) * scale[i]
+                        + offset[i];
+                }
+            }
+        } else {
+            for (auto &vertex : sm.vertices) {
+                for (int i(0); i < 3; ++i) {
+                    vertex(i) = offset[i] + ((*iq++ * scale[i])
+                                             / Version2Quant);
+                }
+            }
+        }
+    }
+
+    auto texCoords([&](const std::vector<std::int32_t> &in
+                       , math::Points2d &out, const double multiplier[2])
+    {
+        out.resize(in.size() / 2);
+        auto iq(in.cbegin());
+        if (q.version >= 3) {
+            for (auto &tc : out) {
+                tc(0) = double(*iq++) * multiplier[0];
+                tc(1) = double(*iq++) * multiplier[1];
+            }
+        } else {
+            for (auto &tc : out) {
+                tc(0) = double(*iq++) / Version2Quant;
+                tc(1) = double(*iq++) / Version2Quant;
+            }
+        }
+    });
+
+    {
+        const double multiplier[2] = { q.etcMultiplier(), q.etcMultiplier() };
+        texCoords(q.etc, sm.etc, multiplier);
+    }
+    {
+        const double multiplier[2] = { q.tcMultiplier(0), q.tcMultiplier(1) };
+        texCoords(q.tc, sm.tc, multiplier);
+    }
+
+    auto faces([&](const std::vector<std::uint16_t> &in, Faces &out)
+    {
+        out.resize(in.size() / 3);
+        auto iq(in.cbegin());
+        for (auto &face : out) {
+            face(0) = *iq++;
+            face(1) = *iq++;
+            face(2) = *iq++;
+        }
+    });
+
+    faces(q.faces, sm.faces);
+    faces(q.facesTc, sm.facesTc);
+}
+
+/** Copies metadata and moves faces.
+ */
+template <typename T>
+void copyMetadata(QuantizedData &q, SubMeshBuffers<T> &sm)
+{
+    sm.textureMode = q.textureMode;
+    sm.textureLayer = q.textureLayer;
+    sm.surfaceReference = q.surfaceReference;
+    sm.bbox = q.bbox;
+    sm.faces = std::move(q.faces);
+    sm.facesTc = std::move(q.facesTc);
+}
+
+/** Converts decoded data to float buffers. Vertices are relative to origin.
+ */
+void convert(QuantizedData &q, SubMeshBuffers<float> &sm)
+{
+    copyMetadata(q, sm);
+
+    // dequantize, plain loops over flat buffers
+    const double multiplier(q.vertexMultiplier());
+    float scale[3];
+    for (int i(0); i < 3; ++i) {
+        sm.origin(i) = q.vertexOffset(i);
+        sm.scale(i) = 1.0;
+        scale[i] = multiplier * q.vertexScale(i);
+    }
+
+    sm.vertices.resize(q.vertices.size());
+    for (std::size_t i(0), e(q.vertices.size()); i < e; i += 3) {
+        sm.vertices[i] = q.vertices[i] * scale[0];
+        sm.vertices[i + 1] = q.vertices[i + 1] * scale[1];
+        sm.vertices[i + 2] = q.vertices[i + 2] * scale[2];
+    }
+
+    const float etcScale(q.etcMultiplier());
+    sm.etcScale = math::Point2d(1.0, 1.0);
+    sm.etc.resize(q.etc.size());
+    for (std::size_t i(0), e(q.etc.size()); i < e; ++i) {
+        sm.etc[i] = q.etc[i] * etcScale;
+    }
+
+    const float tcScale[2] = { float(q.tcMultiplier(0))
+                               , float(q.tcMultiplier(1)) };
+    sm.tcScale = math::Point2d(1.0, 1.0);
+    sm.tc.resize(q.tc.size());
+    for (std::size_t i(0), e(q.tc.size()); i < e; i += 2) {
+        sm.tc[i] = q.tc[i] * tcScale[0];
+        sm.tc[i + 1] = q.tc[i + 1] * tcScale[1];
+    }
+}
+
+/** Moves quantized data to output as-is.
+ */
+void convert(QuantizedData &q, SubMeshBuffers<std::int32_t> &sm)
+{
+    copyMetadata(q, sm);
+
+    const double multiplier(q.vertexMultiplier());
+    for (int i(0); i < 3; ++i) {
+        sm.origin(i) = q.vertexOffset(i);
+        sm.scale(i) = multiplier * q.vertexScale(i);
+    }
+    sm.etcScale = math::Point2d(q.etcMultiplier(), q.etcMultiplier());
+    sm.tcScale = math::Point2d(q.tcMultiplier(0), q.tcMultiplier(1));
+
+    sm.vertices = std::move(q.vertices);
+    sm.etc = std::move(q.etc);
+    sm.tc = std::move(q.tc);
+}
+
+/** Converts decoded data to compact submesh. Version 2 data are copied as-is,
+ *  version 3 data are requantized into submesh bounding box.
+ */
+void convert(QuantizedData &q, CompactSubMesh &sm)
+{
+    sm.textureMode = q.textureMode;
+    sm.textureLayer = q.textureLayer;
+    sm.surfaceReference = q.surfaceReference;
+    sm.bbox = q.bbox;
+
+    auto copy([](const std::vector<std::int32_t> &in
+                 , CompactSubMesh::Coordinates &out)
+    {
+        out.assign(in.begin(), in.end());
+    });
+
+    if (q.version >= 3) {
+        const double multiplier(q.vertexMultiplier());
+        double scale[3], offset[3], size[3];
+        for (int i(0); i < 3; ++i) {
+            scale[i] = q.vertexScale(i);
+            offset[i] = q.vertexOffset(i);
+            size[i] = q.bbox.ur(i) - q.bbox.ll(i);
+        }
+
+        sm.vertices.resize(q.vertices.size());
+        auto iq(q.vertices.cbegin());
+        for (auto iv(sm.vertices.begin()), ev(sm.vertices.end()); iv != ev; )
+        {
+            for (int i(0); i < 3; ++i) {
+                const double v((double(*iq++) * multiplier) * scale[i]
+                               + offset[i]);
+                *iv++ = (size[i]
+                         ? std::uint16_t
+                         (std::round(math::clamp
+                                     (((v - q.bbox.ll(i)) * Version2Quant)
+                                      / size[i], 0.0, double(Version2Quant))))
+                         : 0);
+            }
+        }
+
+        auto texCoords([&](const std::vector<std::int32_t> &in
+                           , CompactSubMesh::Coordinates &out
+                           , const double multiplier[2])
+        {
+            out.resize(in.size());
+            for (std::size_t i(0), e(in.size()); i < e; ++i) {
+                out[i] = std::uint16_t
+                    (std::round(math::clamp(in[i] * multiplier[i & 1]
+                                            , 0.0, 1.0)
+                                * Version2Quant));
+            }
+        });
+
+        {
+            const double multiplier[2] = { q.etcMultiplier()
+                                           , q.etcMultiplier() };
+            texCoords(q.etc, sm.etc, multiplier);
+        }
+        {
+            const double multiplier[2] = { q.tcMultiplier(0)
+                                           , q.tcMultiplier(1) };
+            texCoords(q.tc, sm.tc, multiplier);
+        }
+    } else {
+        // same quantization, just narrow
+        copy(q.vertices, sm.vertices);
+        copy(q.etc, sm.etc);
+        copy(q.tc, sm.tc);
+    }
+
+    sm.faces = CompactFaces(std::move(q.faces));
+    sm.facesTc = CompactFaces(std::move(q.facesTc));
+}
+
+template <typename SubMeshType>
+void loadMeshProperImpl(BufferReader &r, std::vector<SubMeshType> &mesh)
+{
+    char magic[sizeof(MAGIC)];
+    r.read(magic);
+    const auto version(r.read<std::uint16_t>());
+
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC))) {
+        LOGTHROW(err1, storage::BadFileFormat)
+            << "File " << r.path() << " is not a VTS mesh file.";
+    }
+    if (version > VERSION) {
+        LOGTHROW(err1, storage::VersionError)
+            << "File " << r.path()
+            << " has unsupported version (" << version << ").";
+    }
+
+    // ignore mean undulation
+    r.read<double>();
+
+    mesh.resize(r.read<std::uint16_t>());
+
+    QuantizedData q;
+    for (auto &sm : mesh) {
+        q.version = version;
+        r.read(q.flags);
+
+        // submesh surface reference was added in version=2
+        q.surfaceReference = ((version >= 2)
+                              ? r.read<std::uint8_t>() : 1);
+
+        // (external) texture layer information
+        const auto u16(r.read<std::uint16_t>());
+        q.textureMode = SubMesh::TextureMode::internal;
+        q.textureLayer = boost::none;
+        if (q.flags & SubMeshFlag::textureMode) {
+            q.textureMode = SubMesh::TextureMode::external;
+            // leave textureLayer undefined if zero
+            if (u16) { q.textureLayer = u16; }
+        }
+
+        // sub-mesh bounding box
+        r.read(q.bbox.ll(0));
+        r.read(q.bbox.ll(1));
+        r.read(q.bbox.ll(2));
+        r.read(q.bbox.ur(0));
+        r.read(q.bbox.ur(1));
+        r.read(q.bbox.ur(2));
+
+        q.vertices.clear();
+        q.etc.clear();
+        q.tc.clear();
+        q.faces.clear();
+        q.facesTc.clear();
+
+        if (version >= 3) {
+            decodeSubmeshVersion3(r, q);
+        } else {
+            decodeSubmeshVersion2(r, q);
+        }
+
+        convert(q, sm);
+    }
+}
+
 } // namespace
 
 void loadMeshProper(std::istream &in, const boost::filesystem::path &path
@@ -851,6 +1493,37 @@ void loadMeshProper(std::istream &in, const boost::filesystem::path &path
     loadMeshProperImpl(in, path, mesh.submeshes);
 }
 
+void loadMeshProper(const char *data, std::size_t size
+                    , const boost::filesystem::path &path, Mesh &mesh)
+{
+    BufferReader r(data, size, path);
+    loadMeshProperImpl(r, mesh.submeshes);
+}
+
+void loadMeshProper(const char *data, std::size_t size
+                    , const boost::filesystem::path &path
+                    , SubMeshBuffers<float>::list &mesh)
+{
+    BufferReader r(data, size, path);
+    loadMeshProperImpl(r, mesh);
+}
+
+void loadMeshProper(const char *data, std::size_t size
+                    , const boost::filesystem::path &path
+                    , SubMeshBuffers<std::int32_t>::list &mesh)
+{
+    BufferReader r(data, size, path);
+    loadMeshProperImpl(r, mesh);
+}
+
+void loadMeshProper(const char *data, std::size_t size
+                    , const boost::filesystem::path &path
+                    , CompactSubMesh::list &mesh)
+{
+    BufferReader r(data, size, path);
+    loadMeshProperImpl(r, mesh);
+}
+
 } // namespace detail
 
 NormalizedSubMesh::list
@@ -27,6 +27,7 @@
 #define vtslibs_vts_meshio_hpp
 
 #include "mesh.hpp"
+#include "compactmesh.hpp"
 
 namespace vtslibs { namespace vts { namespace detail {
 
@@ -39,6 +40,82 @@ void saveMeshProper(std::ostream &out, const Mesh &mesh, const Atlas *atlas);
 void loadMeshProper(std::istream &in, const boost::filesystem::path &path
                     , Mesh &mesh);
 
+/** Submesh decoded into flat buffers.
+ *
+ *  T is either float (dequantized values) or std::int32_t (quantized values as
+ *  stored in the file). In both cases:
+ *
+ *      vertex(i) = origin(i) + scale(i) * vertices[3 * index + i]
+ *      tc(i) = tcScale(i) * tc[2 * index + i]
+ *      etc(i) = etcScale(i) * etc[2 * index + i]
+ *
+ *  Float buffers have all scales set to 1; vertices are kept relative to
+ *  origin to preserve precision.
+ *
+ *  Faces are stored as index triplets, mesh format limits index to 16 bits.
+ */
+template <typename T>
+struct SubMeshBuffers {
+    typedef std::vector<SubMeshBuffers> list;
+
+    math::Extents3 bbox;
+    math::Point3d origin;
+    math::Point3d scale;
+    math::Point2d tcScale;
+    math::Point2d etcScale;
+
+    std::vector<T> vertices;
+    std::vector<T> tc;
+    std::vector<T> etc;
+    std::vector<std::uint16_t> faces;
+    std::vector<std::uint16_t> facesTc;
+
+    SubMesh::TextureMode textureMode;
+    boost::optional<std::uint16_t> textureLayer;
+    SubMesh::SurfaceReference surfaceReference;
+
+    SubMeshBuffers()
+        : textureMode(SubMesh::TextureMode::internal), surfaceReference(1)
+    {}
+};
+
+/** Loads mesh proper from contiguous memory buffer (uncompressed data).
+ *
+ *  Much faster than stream based loader; result is the same.
+ */
+void loadMeshProper(const char *data, std::size_t size
+                    , const boost::filesystem::path &path, Mesh &mesh);
+
+/** Loads mesh proper from contiguous memory buffer (uncompressed data) into
+ *  flat float buffers.
+ */
+void loadMeshProper(const char *data, std::size_t size
+                    , const boost::filesystem::path &path
+                    , SubMeshBuffers<float>::list &mesh);
+
+/** Loads mesh proper from contiguous memory buffer (uncompressed data) into
+ *  flat quantized buffers.
+ */
+void loadMeshProper(const char *data, std::size_t size
+                    , const boost::filesystem::path &path
+                    , SubMeshBuffers<std::int32_t>::list &mesh);
+
+/** Loads mesh proper from contiguous memory buffer (uncompressed data) into
+ *  compact submeshes. Doesn't go through double precision submeshes.
+ */
+void loadMeshProper(const char *data, std::size_t size
+                    , const boost::filesystem::path &path
+                    , CompactSubMesh::list &mesh);
+
+/** Saves mesh proper in given format version (2 or 3).
+ */
+void saveMeshProper(std::ostream &out, const ConstSubMeshRange &submeshes
+                    , const Atlas *atlas, std::uint16_t version);
+
+/** Saves compact submeshes as mesh proper (always version 2).
+ */
+void saveMeshProper(std::ostream &out, const CompactSubMesh::list &submeshes);
+
 
 // inlines
 
@@ -62,7 +62,7 @@ bool MeshOpInput::loadNode() const
         node_ = owner_->findMetaNode(tileId_);
         nodeLoaded_ = true;
     }
-    return node_;
+    return bool(node_);
 }
 
 void MeshOpInput::prepare(bool lazy)
@@ -130,7 +130,7 @@ const opencv::NavTile& MeshOpInput::navtile() const
 {
     // navtile must have valid node to work properly
     if (!navtile_ && loadNode()) {
-        navtile_ = owner_->getNavTile(tileId_, node_);
+        navtile_ = owner_->getNavTile(tileId_, node_.get());
     }
 
     return *navtile_;
@@ -169,7 +169,7 @@ private:
         return detail_.tileIndex.get(tileId);
     }
 
-    virtual const MetaNode* findMetaNode_impl(const TileId &tileId)
+    virtual MetaNode::pointer findMetaNode_impl(const TileId &tileId)
         const
     {
         return detail_.findMetaNode(tileId);
@@ -140,7 +140,7 @@ private:
     NodeInfo nodeInfo_;
 
     mutable bool nodeLoaded_;
-    mutable const MetaNode *node_;
+    mutable MetaNode::pointer node_;
     mutable Mesh::pointer mesh_;
     mutable opencv::HybridAtlas::pointer atlas_;
     mutable opencv::NavTile::pointer navtile_;
@@ -167,9 +167,10 @@ public:
      */
     TileIndex::Flag::value_type flags(const TileId &tileId) const;
 
-    /** Find metanode for given tile.
+    /** Find metanode for given tile. Returned pointer must keep the node
+     *  valid for its whole lifetime (i.e. pin its metatile or own a copy).
      */
-    const MetaNode* findMetaNode(const TileId &tileId) const;
+    MetaNode::pointer findMetaNode(const TileId &tileId) const;
 
     /** Get tile's mesh.
      */
@@ -195,7 +196,7 @@ private:
     virtual TileIndex::Flag::value_type flags_impl(const TileId &tileId)
         const = 0;
 
-    virtual const MetaNode* findMetaNode_impl(const TileId &tileId)
+    virtual MetaNode::pointer findMetaNode_impl(const TileId &tileId)
         const = 0;
 
     virtual Mesh::pointer getMesh_impl(const TileId &tileId
@@ -231,7 +232,7 @@ MeshOpInput::DataSource::flags(const TileId &tileId) const
     return flags_impl(tileId);
 }
 
-inline const MetaNode*
+inline MetaNode::pointer
 MeshOpInput::DataSource::findMetaNode(const TileId &tileId) const
 {
     return findMetaNode_impl(tileId);
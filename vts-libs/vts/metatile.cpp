@@ -24,6 +24,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <map>
+#include <algorithm>
+#include <bitset>
 
 #include "dbglog/dbglog.hpp"
 
@@ -548,117 +550,455 @@ inline void MetaNode::load(std::istream &in, const StoreParams &sp
     sourceReference = readVariable<SourceReference>(in, sp.sourceReference);
 }
 
-void MetaTile::load(std::istream &in, const fs::path &path)
+namespace {
+
+/** Metatile file header.
+ */
+struct MetaTileHeader {
+    std::uint16_t version;
+    TileId origin;
+    MetaTile::extents_type valid;
+    MetaTile::size2_type validSize;
+    MetaTileFlag::value_type flags;
+    std::uint8_t creditCount;
+};
+
+MetaTileHeader loadHeader(std::istream &in, const fs::path &path)
 {
-    const auto version(loadVersionImpl(in, path));
+    MetaTileHeader header;
+    header.version = loadVersionImpl(in, path);
 
     // tile id information
-    origin_.lod = bin::read<std::uint8_t>(in);
-    origin_.x = bin::read<std::uint32_t>(in);
-    origin_.y = bin::read<std::uint32_t>(in);
+    header.origin.lod = bin::read<std::uint8_t>(in);
+    header.origin.x = bin::read<std::uint32_t>(in);
+    header.origin.y = bin::read<std::uint32_t>(in);
 
     // offset and dimensions of saved grid
-    valid_.ll(0) = bin::read<std::uint16_t>(in);
-    valid_.ll(1) = bin::read<std::uint16_t>(in);
+    auto &valid(header.valid);
+    valid.ll(0) = bin::read<std::uint16_t>(in);
+    valid.ll(1) = bin::read<std::uint16_t>(in);
 
-    size2_type validSize;
+    auto &validSize(header.validSize);
     validSize.width = bin::read<std::uint16_t>(in);
     validSize.height = bin::read<std::uint16_t>(in);
     if (!math::empty(validSize)) {
         // non-empty -> just remove one
-        valid_.ur(0) = valid_.ll(0) + validSize.width - 1;
-        valid_.ur(1) = valid_.ll(1) + validSize.height - 1;
+        valid.ur(0) = valid.ll(0) + validSize.width - 1;
+        valid.ur(1) = valid.ll(1) + validSize.height - 1;
     } else {
         // empty -> invalid
-        valid_ = extents_type(math::InvalidExtents{});
+        valid = MetaTile::extents_type(math::InvalidExtents{});
     }
 
-    std::uint8_t flags(0);
-    if (version < 2) {
+    header.flags = 0;
+    if (header.version < 2) {
         // node size (unused)
         bin::read<std::uint8_t>(in);
     } else {
         // flags
-        bin::read(in, flags);
+        bin::read(in, header.flags);
     }
 
     // credit count
-    auto creditCount(bin::read<std::uint8_t>(in));
+    header.creditCount = bin::read<std::uint8_t>(in);
 
-    if (version < 2) {
+    if (header.version < 2) {
         // read credit block size (unused)
         bin::read<std::uint16_t>(in);
     }
 
-    // load flags
-    if (flags & MetaTileFlag::flagPlanes) {
-        for (const auto &mapping : MetaTileFlag::flagMapping) {
-            if (!(mapping.first & flags)) { continue; }
+    return header;
+}
 
-            imgproc::bitfield::RasterMask
-                bitmap(validSize.width, validSize.height);
+/** Loads flag planes (if any) and calls op(i, j, flag) for every node with
+ *  flag set. Indices are relative to valid extents.
+ */
+template <typename Op>
+void loadFlagPlanes(std::istream &in, const MetaTileHeader &header, Op op)
+{
+    if (!(header.flags & MetaTileFlag::flagPlanes)) { return; }
 
-            // read in bitmap
-            bitmap.readData(in);
+    const auto &validSize(header.validSize);
+    for (const auto &mapping : MetaTileFlag::flagMapping) {
+        if (!(mapping.first & header.flags)) { continue; }
 
-            // process whole bitmap and update credits of all nodes
-            for (unsigned int j(valid_.ll(1)), jj(0); j <= valid_.ur(1);
-                 ++j, ++jj)
-            {
-                for (unsigned int i(valid_.ll(0)), ii(0); i <= valid_.ur(0);
-                     ++i, ++ii)
-                {
-                    auto &node(grid_[j * size_ + i]);
+        imgproc::bitfield::RasterMask
+            bitmap(validSize.width, validSize.height);
 
-                    // set flag
-                    if (bitmap.get(ii, jj)) {
-                        node.update(mapping.second);
-                    }
-                }
+        // read in bitmap
+        bitmap.readData(in);
+
+        // process whole bitmap and update flags of all nodes
+        for (unsigned int jj(0); jj < validSize.height; ++jj) {
+            for (unsigned int ii(0); ii < validSize.width; ++ii) {
+                if (bitmap.get(ii, jj)) { op(ii, jj, mapping.second); }
             }
         }
     }
+}
 
-    if (creditCount) {
-        imgproc::bitfield::RasterMask
-            bitmap(validSize.width, validSize.height);
+/** Loads credit planes (if any) and calls op(i, j, creditId) for every node
+ *  with given credit. Indices are relative to valid extents.
+ */
+template <typename Op>
+void loadCreditPlanes(std::istream &in, const MetaTileHeader &header, Op op)
+{
+    if (!header.creditCount) { return; }
 
-        while (creditCount--) {
-            // read credit ID
-            auto creditId(bin::read<std::uint16_t>(in));
+    const auto &validSize(header.validSize);
+    imgproc::bitfield::RasterMask bitmap(validSize.width, validSize.height);
 
-            // read in bitmap
-            bitmap.readData(in);
+    for (auto creditCount(header.creditCount); creditCount--; ) {
+        // read credit ID
+        auto creditId(bin::read<std::uint16_t>(in));
 
-            // process whole bitmap and update credits of all nodes
-            for (unsigned int j(valid_.ll(1)), jj(0); j <= valid_.ur(1);
-                 ++j, ++jj)
-            {
-                for (unsigned int i(valid_.ll(0)), ii(0); i <= valid_.ur(0);
-                     ++i, ++ii)
-                {
-                    auto &node(grid_[j * size_ + i]);
+        // read in bitmap
+        bitmap.readData(in);
 
-                    if (bitmap.get(ii, jj)) {
-                        node.addCredit(creditId);
-                    }
-                }
+        // process whole bitmap and update credits of all nodes
+        for (unsigned int jj(0); jj < validSize.height; ++jj) {
+            for (unsigned int ii(0); ii < validSize.width; ++ii) {
+                if (bitmap.get(ii, jj)) { op(ii, jj, creditId); }
             }
         }
     }
+}
+
+} // namespace
+
+void MetaTile::load(std::istream &in, const fs::path &path)
+{
+    const auto header(loadHeader(in, path));
+    origin_ = header.origin;
+    valid_ = header.valid;
+
+    auto node([&](unsigned int i, unsigned int j) -> MetaNode&
+    {
+        return grid_[(valid_.ll(1) + j) * size_ + valid_.ll(0) + i];
+    });
+
+    // load flags
+    loadFlagPlanes(in, header, [&](unsigned int i, unsigned int j
+                                   , MetaNode::Flag::value_type flag)
+    {
+        node(i, j).update(flag);
+    });
+
+    // load credits
+    loadCreditPlanes(in, header, [&](unsigned int i, unsigned int j
+                                     , storage::CreditId creditId)
+    {
+        node(i, j).addCredit(creditId);
+    });
 
     // read rest of nodes if any
     if (!valid(valid_)) { return; }
 
     const MetaNode::StoreParams sp
-        (origin_.lod, MetaTileFlag::sourceReferenceSize(flags));
+        (origin_.lod, MetaTileFlag::sourceReferenceSize(header.flags));
+
+    for (auto j(valid_.ll(1)); j <= valid_.ur(1); ++j) {
+        for (auto i(valid_.ll(0)); i <= valid_.ur(0); ++i) {
+            grid_[j * size_ + i].load(in, sp, header.version);
+        }
+    }
+}
+
+PackedMetaTile::CreditPool::CreditPool()
+{
+    // index 0 is always the empty set
+    sets_.emplace_back();
+    index_.insert(std::make_pair(std::vector<storage::CreditId>(), 0));
+}
+
+PackedMetaTile::CreditPool::index_type
+PackedMetaTile::CreditPool::intern(const storage::CreditIds &credits)
+{
+    if (credits.empty()) { return 0; }
+
+    std::vector<storage::CreditId> key(credits.begin(), credits.end());
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto findex(index_.find(key));
+    if (findex != index_.end()) { return findex->second; }
+
+    const index_type index(sets_.size());
+    sets_.push_back(credits);
+    index_.insert(std::make_pair(std::move(key), index));
+    return index;
+}
+
+const storage::CreditIds&
+PackedMetaTile::CreditPool::get(index_type index) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sets_[index];
+}
+
+std::size_t PackedMetaTile::CreditPool::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sets_.size();
+}
+
+PackedMetaTile::PackedMetaTile(std::uint8_t binaryOrder
+                               , const CreditPool::pointer &pool)
+    : binaryOrder_(binaryOrder), size_(1 << binaryOrder)
+    , valid_(math::InvalidExtents{}), pool_(pool)
+{
+    reset();
+}
+
+PackedMetaTile::PackedMetaTile(const MetaTile &metatile
+                               , const CreditPool::pointer &pool)
+    : origin_(metatile.origin()), binaryOrder_(0), size_(metatile.size())
+    , valid_(metatile.validExtents()), pool_(pool)
+{
+    while ((size_type(1) << binaryOrder_) < size_) { ++binaryOrder_; }
+    reset();
+
+    metatile.for_each([&](const TileId &tileId, const MetaNode &node)
+    {
+        if (!node.flags()) { return; }
+        push((tileId.y - origin_.y) * size_ + (tileId.x - origin_.x)
+             , node, pool_->intern(node.credits()));
+    });
+    finish();
+}
+
+void PackedMetaTile::reset()
+{
+    present_.assign(((size_ * size_) + 63) / 64, 0);
+    rank_.clear();
+    flags_.clear();
+    extents_.clear();
+    geomExtents_.clear();
+    texelSize_.clear();
+    displaySize_.clear();
+    heightRange_.clear();
+    sourceReference_.clear();
+    internalTextureCount_.clear();
+    credits_.clear();
+}
+
+void PackedMetaTile::push(size_type index, const MetaNode &node
+                          , CreditPool::index_type credits)
+{
+    present_[index >> 6] |= (std::uint64_t(1) << (index & 63));
+
+    flags_.push_back(node.flags());
+    extents_.push_back(node.extents);
+    geomExtents_.push_back(node.geomExtents);
+    texelSize_.push_back(node.texelSize);
+    displaySize_.push_back(node.displaySize);
+    heightRange_.push_back(node.heightRange);
+    sourceReference_.push_back(node.sourceReference);
+    internalTextureCount_.push_back(node.internalTextureCount());
+    credits_.push_back(credits);
+}
+
+void PackedMetaTile::finish()
+{
+    rank_.resize(present_.size());
+    size_type count(0);
+    for (std::size_t i(0), e(present_.size()); i != e; ++i) {
+        rank_[i] = count;
+        count += std::bitset<64>(present_[i]).count();
+    }
+
+    // release slack
+    flags_.shrink_to_fit();
+    extents_.shrink_to_fit();
+    geomExtents_.shrink_to_fit();
+    texelSize_.shrink_to_fit();
+    displaySize_.shrink_to_fit();
+    heightRange_.shrink_to_fit();
+    sourceReference_.shrink_to_fit();
+    internalTextureCount_.shrink_to_fit();
+    credits_.shrink_to_fit();
+}
+
+void PackedMetaTile::load(std::istream &in, const fs::path &path)
+{
+    reset();
+
+    const auto header(loadHeader(in, path));
+    origin_ = header.origin;
+    valid_ = header.valid;
+
+    const auto &validSize(header.validSize);
+    const auto cells(std::size_t(validSize.width) * validSize.height);
+
+    // flags and credits are stored in planes before nodes, keep them for
+    // the valid area only
+    std::vector<MetaNode::Flag::value_type> flags;
+    loadFlagPlanes(in, header, [&](unsigned int i, unsigned int j
+                                   , MetaNode::Flag::value_type flag)
+    {
+        if (flags.empty()) { flags.resize(cells); }
+        flags[j * validSize.width + i] |= flag;
+    });
+
+    std::vector<storage::CreditIds> credits;
+    loadCreditPlanes(in, header, [&](unsigned int i, unsigned int j
+                                     , storage::CreditId creditId)
+    {
+        if (credits.empty()) { credits.resize(cells); }
+        credits[j * validSize.width + i].insert(creditId);
+    });
+
+    // read nodes if any
+    if (!valid(valid_)) {
+        finish();
+        return;
+    }
+
+    const MetaNode::StoreParams sp
+        (origin_.lod, MetaTileFlag::sourceReferenceSize(header.flags));
+
+    // neighbouring nodes usually share credits, remember last interned set
+    const storage::CreditIds *lastCredits(nullptr);
+    CreditPool::index_type lastCreditsIndex(0);
+
+    std::size_t cell(0);
+    for (auto j(valid_.ll(1)); j <= valid_.ur(1); ++j) {
+        for (auto i(valid_.ll(0)); i <= valid_.ur(0); ++i, ++cell) {
+            MetaNode node;
+            if (!flags.empty()) { node.flags(flags[cell]); }
+            node.load(in, sp, header.version);
+            if (!node.flags()) { continue; }
+
+            CreditPool::index_type creditsIndex(0);
+            if (!credits.empty() && !credits[cell].empty()) {
+                const auto &nodeCredits(credits[cell]);
+                if (!lastCredits
+                    || (lastCredits->size() != nodeCredits.size())
+                    || !std::equal(nodeCredits.begin(), nodeCredits.end()
+                                   , lastCredits->begin()))
+                {
+                    lastCreditsIndex = pool_->intern(nodeCredits);
+                    lastCredits = &nodeCredits;
+                }
+                creditsIndex = lastCreditsIndex;
+            }
+
+            push(j * size_ + i, node, creditsIndex);
+        }
+    }
+
+    finish();
+}
+
+boost::optional<PackedMetaTile::size_type>
+PackedMetaTile::index(const TileId &tileId, std::nothrow_t) const
+{
+    if ((origin_.lod != tileId.lod)
+        || (origin_.x > tileId.x)
+        || (origin_.y > tileId.y))
+    {
+        return boost::none;
+    }
+
+    const point_type p(tileId.x - origin_.x, tileId.y - origin_.y);
+    if ((p(0) >= size_) || (p(1) >= size_) || !math::inside(valid_, p)) {
+        return boost::none;
+    }
+
+    return p(1) * size_ + p(0);
+}
+
+boost::optional<PackedMetaTile::size_type>
+PackedMetaTile::slot(size_type index) const
+{
+    const auto word(present_[index >> 6]);
+    const auto bit(std::uint64_t(1) << (index & 63));
+    if (!(word & bit)) { return boost::none; }
+
+    return rank_[index >> 6] + std::bitset<64>(word & (bit - 1)).count();
+}
+
+MetaNode PackedMetaTile::node(size_type slot) const
+{
+    MetaNode node;
+    node.flags(flags_[slot]);
+    node.extents = extents_[slot];
+    node.geomExtents = geomExtents_[slot];
+    node.texelSize = texelSize_[slot];
+    node.displaySize = displaySize_[slot];
+    node.heightRange = heightRange_[slot];
+    node.sourceReference = sourceReference_[slot];
+    node.internalTextureCount(internalTextureCount_[slot]);
+    if (credits_[slot]) { node.setCredits(pool_->get(credits_[slot])); }
+    return node;
+}
+
+boost::optional<MetaNode> PackedMetaTile::get(const TileId &tileId
+                                              , std::nothrow_t) const
+{
+    const auto i(index(tileId, std::nothrow));
+    if (!i) { return boost::none; }
+
+    if (const auto s = slot(*i)) { return node(*s); }
+    return MetaNode();
+}
+
+MetaNode PackedMetaTile::get(const TileId &tileId) const
+{
+    if (auto node = get(tileId, std::nothrow)) { return *node; }
+
+    LOGTHROW(warn1, storage::NoSuchTile)
+        << "Node " << tileId << " not inside metatile " << origin_
+        << ".";
+    throw;
+}
+
+MetaNode::Flag::value_type PackedMetaTile::flags(const TileId &tileId) const
+{
+    if (const auto i = index(tileId, std::nothrow)) {
+        if (const auto s = slot(*i)) { return flags_[*s]; }
+    }
+    return MetaNode::Flag::none;
+}
+
+MetaTile PackedMetaTile::unpack() const
+{
+    MetaTile metatile(origin_, binaryOrder_);
+    if (empty()) { return metatile; }
 
     for (auto j(valid_.ll(1)); j <= valid_.ur(1); ++j) {
         for (auto i(valid_.ll(0)); i <= valid_.ur(0); ++i) {
-            grid_[j * size_ + i].load(in, sp, version);
+            const TileId tileId(origin_.lod, origin_.x + i, origin_.y + j);
+            if (const auto s = slot(j * size_ + i)) {
+                metatile.set(tileId, node(*s));
+            } else {
+                metatile.set(tileId, MetaNode());
+            }
         }
     }
 
+    return metatile;
+}
+
+std::size_t PackedMetaTile::memory() const
+{
+    return (sizeof(*this)
+            + present_.capacity() * sizeof(decltype(present_)::value_type)
+            + rank_.capacity() * sizeof(decltype(rank_)::value_type)
+            + flags_.capacity() * sizeof(decltype(flags_)::value_type)
+            + extents_.capacity() * sizeof(decltype(extents_)::value_type)
+            + geomExtents_.capacity()
+            * sizeof(decltype(geomExtents_)::value_type)
+            + texelSize_.capacity()
+            * sizeof(decltype(texelSize_)::value_type)
+            + displaySize_.capacity()
+            * sizeof(decltype(displaySize_)::value_type)
+            + heightRange_.capacity()
+            * sizeof(decltype(heightRange_)::value_type)
+            + sourceReference_.capacity()
+            * sizeof(decltype(sourceReference_)::value_type)
+            + internalTextureCount_.capacity()
+            * sizeof(decltype(internalTextureCount_)::value_type)
+            + credits_.capacity() * sizeof(decltype(credits_)::value_type));
 }
 
 int MetaTile::loadVersion(std::istream &in
@@ -791,6 +1131,15 @@ MetaNode& MetaNode::mergeExtents(const GeomExtents &other)
     return *this;
 }
 
+std::size_t MetaTile::memory() const
+{
+    std::size_t memory(sizeof(*this) + grid_.capacity() * sizeof(MetaNode));
+    for (const auto &node : grid_) {
+        memory += node.credits().size() * sizeof(storage::CreditId);
+    }
+    return memory;
+}
+
 MetaTile::extents_type MetaTile::validExtents() const
 {
     return extents_type(origin_.x + valid_.ll(0)
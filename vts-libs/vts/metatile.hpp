@@ -32,8 +32,12 @@
 #include <vector>
 #include <new>
 #include <limits>
+#include <map>
+#include <deque>
+#include <mutex>
 
 #include <boost/optional.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include "math/geometry_core.hpp"
@@ -140,6 +144,11 @@ struct MetaNode {
 
     SourceReference sourceReference;
 
+    /** Shared pointer to cached metanode. Keeps owning metatile alive so the
+     *  node stays valid even when the metatile is evicted from the cache.
+     */
+    typedef std::shared_ptr<const MetaNode> pointer;
+
     MetaNode()
         : texelSize(), displaySize(), heightRange(), sourceReference()
         , flags_(), internalTextureCount_()
@@ -323,6 +332,10 @@ public:
 
     bool empty() const { return !math::valid(valid_); }
 
+    /** Approximate memory occupied by this metatile (in bytes).
+     */
+    std::size_t memory() const;
+
     /** Current metatile version.
      */
     static int currentVersion();
@@ -363,6 +376,147 @@ protected:
     extents_type valid_;
 };
 
+/** Compact read-only metatile.
+ *
+ *  Only nodes with any flag set are stored. Node data are kept in
+ *  structure-of-arrays layout, node presence is kept in a bitmap and node's
+ *  position in the arrays is computed by popcount over the bitmap. Credit
+ *  sets are interned in a pool shared between metatiles.
+ *
+ *  Nodes without any flag inside valid extents are reported as default
+ *  constructed nodes.
+ *
+ *  Read-only metatile cache keeps evicted metatiles in this form.
+ */
+class PackedMetaTile {
+public:
+    typedef std::shared_ptr<PackedMetaTile> pointer;
+
+    typedef MetaTile::size_type size_type;
+    typedef MetaTile::point_type point_type;
+    typedef MetaTile::extents_type extents_type;
+
+    /** Pool of credit sets shared between packed metatiles.
+     */
+    class CreditPool : boost::noncopyable {
+    public:
+        typedef std::shared_ptr<CreditPool> pointer;
+        typedef std::uint32_t index_type;
+
+        CreditPool();
+
+        /** Returns index of given credit set. Set is added to the pool if not
+         *  found.
+         */
+        index_type intern(const storage::CreditIds &credits);
+
+        /** Returns credit set at given index. Reference is valid during
+         *  whole pool lifetime.
+         */
+        const storage::CreditIds& get(index_type index) const;
+
+        std::size_t size() const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::deque<storage::CreditIds> sets_;
+        std::map<std::vector<storage::CreditId>, index_type> index_;
+    };
+
+    PackedMetaTile(std::uint8_t binaryOrder, const CreditPool::pointer &pool);
+
+    /** Packs existing metatile.
+     */
+    PackedMetaTile(const MetaTile &metatile, const CreditPool::pointer &pool);
+
+    /** Loads metatile directly from its serialized form.
+     */
+    void load(std::istream &in
+              , const boost::filesystem::path &path = "unknown");
+
+    /** Returns node at given tile. Returns boost::none if tile is outside
+     *  metatile's valid extents.
+     */
+    boost::optional<MetaNode> get(const TileId &tileId, std::nothrow_t) const;
+
+    /** Returns node at given tile. Throws storage::NoSuchTile if tile is
+     *  outside metatile's valid extents.
+     */
+    MetaNode get(const TileId &tileId) const;
+
+    /** Returns node flags at given tile without unpacking whole node. Returns
+     *  zero if there is no such node.
+     */
+    MetaNode::Flag::value_type flags(const TileId &tileId) const;
+
+    /** Unpacks whole metatile.
+     */
+    MetaTile unpack() const;
+
+    const TileId& origin() const { return origin_; }
+
+    const size_type& size() const { return size_; }
+
+    extents_type validExtents() const { return valid_; }
+
+    bool empty() const { return !math::valid(valid_); }
+
+    /** Number of stored nodes.
+     */
+    std::size_t nodeCount() const { return flags_.size(); }
+
+    /** Memory occupied by this metatile (credit pool not included).
+     */
+    std::size_t memory() const;
+
+private:
+    void reset();
+
+    /** Adds new node. Nodes must be pushed in increasing index order.
+     */
+    void push(size_type index, const MetaNode &node
+              , CreditPool::index_type credits);
+
+    /** Builds rank table after last push.
+     */
+    void finish();
+
+    boost::optional<size_type> index(const TileId &tileId, std::nothrow_t)
+        const;
+
+    /** Returns position of node in node arrays.
+     */
+    boost::optional<size_type> slot(size_type index) const;
+
+    MetaNode node(size_type slot) const;
+
+    TileId origin_;
+    std::uint8_t binaryOrder_;
+    size_type size_;
+    extents_type valid_;
+
+    CreditPool::pointer pool_;
+
+    /** Node presence bitmap, size_ * size_ bits, row-major.
+     */
+    std::vector<std::uint64_t> present_;
+
+    /** Number of present nodes in all preceding bitmap words.
+     */
+    std::vector<size_type> rank_;
+
+    // node data, one entry per present node
+    std::vector<MetaNode::Flag::value_type> flags_;
+    std::vector<math::Extents3> extents_;
+    std::vector<GeomExtents> geomExtents_;
+    std::vector<float> texelSize_;
+    std::vector<std::uint16_t> displaySize_;
+    std::vector<Range<std::int16_t> > heightRange_;
+    std::vector<MetaNode::SourceReference> sourceReference_;
+    std::vector<std::uint8_t> internalTextureCount_;
+    std::vector<CreditPool::index_type> credits_;
+};
+
 void saveMetaTile(const boost::filesystem::path &path
                   , const MetaTile &meta);
 
@@ -23,6 +23,7 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <map>
 #include <algorithm>
 
 #include "dbglog/dbglog.hpp"
@@ -97,6 +98,16 @@ const RFNode& findSubtreeRoot(const registry::ReferenceFrame &referenceFrame
     return *node;
 }
 
+/** Validity of a subtree root without extra constraints. Indeterminate if
+ *  there are any extra constraints.
+ */
+inline boost::tribool rootValidity(const RFNode &root)
+{
+    // extra constraints -> needs sampling
+    if (root.constraints) { return boost::indeterminate; }
+    return root.valid();
+}
+
 } // namespace
 
 inline NodeInfo::NodeInfo(const registry::ReferenceFrame &referenceFrame
@@ -116,6 +127,47 @@ NodeInfo::NodeInfo(const registry::ReferenceFrame &referenceFrame
     , partial_(checkPartial(subtree_, node_, invalidateWhenMasked))
 {}
 
+boost::tribool
+NodeInfo::checkValidity(const registry::ReferenceFrame &referenceFrame
+                        , const TileId &tileId, ChildFlags &children)
+{
+    const auto *root(referenceFrame.findSubtreeRoot(tileId, std::nothrow));
+    if (!root) { return false; }
+
+    const auto valid(rootValidity(*root));
+    if (indeterminate(valid)) { return boost::indeterminate; }
+    if (!valid) { return false; }
+
+    children = 0;
+
+    if (!root->structure.children) {
+        // node's extents are divided into children; partiality is inherited
+        // from parent: non-partial parent -> valid children, partial parent
+        // (non-real) -> valid partial children
+        children = 0x0f;
+        return true;
+    }
+
+    if (root->id != tileId) {
+        // node is derived from manual/barren node, let NodeInfo decide
+        return boost::indeterminate;
+    }
+
+    // manual or barren node: check existing children
+    for (const auto &child : vts::children(tileId)) {
+        if (!(root->structure.children & (1 << child.index))) { continue; }
+
+        const auto *node(referenceFrame.find(child, std::nothrow));
+        if (!node) { return boost::indeterminate; }
+
+        const auto childValid(rootValidity(*node));
+        if (indeterminate(childValid)) { return boost::indeterminate; }
+        if (childValid) { children |= (1 << child.index); }
+    }
+
+    return true;
+}
+
 NodeInfo::list NodeInfo::nodes(const registry::ReferenceFrame &referenceFrame
                                , const registry::Registry &reg)
 {
@@ -262,13 +314,25 @@ NodeInfo NodeInfo::child(const TileId &childId) const
     return child;
 }
 
+/** Subtree sampler. Holds its own convertor (i.e. proj state) built once at
+ *  construction. Samplers are cached per thread (see get()), so proj state
+ *  is not shared between threads unless NodeInfo itself is.
+ */
 class RFTreeSubtree::Sampler : boost::noncopyable {
 public:
     Sampler(const RFNode &root, const registry::Registry &reg)
-        : conv_(root.srs, root.constraints->extentsSrs, reg)
+        : srs_(root.srs), extentsSrs_(root.constraints->extentsSrs)
         , extents_(root.constraints->extents)
+        , conv_(srs_, extentsSrs_, reg)
     {}
 
+    /** Returns sampler for given subtree root from per-thread cache.
+     */
+    static std::shared_ptr<Sampler> get(const RFNode &root
+                                        , const registry::Registry &reg);
+
+    const CsConvertor& conv() const { return conv_; }
+
     math::Point2 sample(const math::Point2 &p) const {
         return conv_(p);
     }
@@ -277,17 +341,78 @@ public:
         return math::inside(extents_, sample(p));
     }
 
+    bool inside(const CsConvertor &conv, const math::Point2 &p) const {
+        return math::inside(extents_, conv(p));
+    }
+
+    /** Batch version of inside(): points are converted in place.
+     */
+    std::vector<std::uint8_t> inside(math::Points2 &points) const {
+        conv_.convert(points);
+        std::vector<std::uint8_t> result(points.size());
+        std::transform(points.begin(), points.end(), result.begin()
+                       , [&](const math::Point2 &p) -> std::uint8_t
+                       {
+                           return math::inside(extents_, p);
+                       });
+        return result;
+    }
+
+    /** Sampler built from different content (e.g. subtree root at reused
+     *  address) must not be used.
+     */
+    bool matches(const RFNode &root) const {
+        return ((srs_ == root.srs)
+                && (extentsSrs_ == root.constraints->extentsSrs)
+                && (extents_.ll == root.constraints->extents.ll)
+                && (extents_.ur == root.constraints->extents.ur));
+    }
+
 private:
-    CsConvertor conv_;
+    std::string srs_;
+    std::string extentsSrs_;
     math::Extents2 extents_;
+    CsConvertor conv_;
 };
 
+namespace {
+
+/** Maximum number of samplers cached by one thread. Cache is flushed when
+ *  full; keys may outlive their registry or reference frame so it must not
+ *  grow forever.
+ */
+const std::size_t MaxCachedSamplers(64);
+
+} // namespace
+
+std::shared_ptr<RFTreeSubtree::Sampler>
+RFTreeSubtree::Sampler::get(const RFNode &root, const registry::Registry &reg)
+{
+    typedef std::pair<const registry::Registry*, const RFNode*> Key;
+    typedef std::map<Key, std::shared_ptr<Sampler>> Cache;
+
+    // per-thread cache, no locking needed
+    thread_local Cache cache;
+
+    const Key key(&reg, &root);
+    auto fcache(cache.find(key));
+    if ((fcache != cache.end()) && fcache->second->matches(root)) {
+        return fcache->second;
+    }
+
+    if ((fcache == cache.end()) && (cache.size() >= MaxCachedSamplers)) {
+        cache.clear();
+    }
+
+    auto sampler(std::make_shared<Sampler>(root, reg));
+    cache[key] = sampler;
+    return sampler;
+}
+
 bool RFTreeSubtree::initSampler() const
 {
     if (!root_->constraints) { return false; }
-    if (!sampler_) {
-        sampler_ = std::make_shared<Sampler>(*root_, *registry_);
-    }
+    if (!sampler_) { sampler_ = Sampler::get(*root_, *registry_); }
     return true;
 }
 
@@ -313,11 +438,12 @@ boost::tribool RFTreeSubtree::valid(const RFNode &node) const
     class Checker {
     public:
         Checker(const Sampler &sampler)
-            : sampler_(sampler), inside_(false), outside_(false)
+            : sampler_(sampler), conv_(sampler.conv())
+            , inside_(false), outside_(false)
         {}
 
         bool operator()(const math::Point2 &p) {
-            if (sampler_.inside(p)) {
+            if (sampler_.inside(conv_, p)) {
                 inside_ = true;
             } else {
                 outside_ = true;
@@ -338,6 +464,7 @@ boost::tribool RFTreeSubtree::valid(const RFNode &node) const
 
     private:
         const Sampler &sampler_;
+        const CsConvertor &conv_;
         bool inside_;
         bool outside_;
     };
@@ -437,13 +564,24 @@ RFTreeSubtree::coverageMask(CoverageType type, const math::Size2 &size
         return v;
     });
 
-    // sample tile in grid
-    const auto &sampler(*sampler_);
+    // sample tile in grid: convert all samples in one batch
+    const auto inside([&]() -> std::vector<std::uint8_t>
+    {
+        math::Points2 samples;
+        samples.reserve((size.width + 2 * dilation)
+                        * (size.height + 2 * dilation));
+        for (int j(-dilation), je(size.height + dilation); j < je; ++j) {
+            double y(ref(1) - j * ps.height);
+            for (int i(-dilation), ie(size.width + dilation); i < ie; ++i) {
+                samples.emplace_back(ref(0) + i * ps.width, y);
+            }
+        }
+        return sampler_->inside(samples);
+    }());
+
     for (int j(-dilation), je(size.height + dilation), gp(0); j < je; ++j) {
-        double y(ref(1) - j * ps.height);
         for (int i(-dilation), ie(size.width + dilation); i < ie; ++i, ++gp) {
-            double x(ref(0) + i * ps.width);
-            if (sampler.inside(math::Point2(x, y))) {
+            if (inside[gp]) {
                 if (!dilation) {
                     pane[gp] = true;
                 }
@@ -87,6 +87,11 @@ private:
 
     const RFNode *root_;
     const registry::Registry *registry_;
+
+    /** Lazily obtained sampler, shared by all subtrees with the same root
+     *  created in the same thread (and by NodeInfo children, which copy it
+     *  from their parent).
+     */
     mutable std::shared_ptr<Sampler> sampler_;
 };
 
@@ -200,6 +205,35 @@ public:
     registry::Srs navsds() const;
 #endif // GEO_HAS_GDAL
 
+    /** Child validity flags: bit N is set when child with index N (see
+     *  children() from tileop) is valid.
+     */
+    typedef std::uint8_t ChildFlags;
+
+    /** Lightweight node validity oracle.
+     *
+     *  Tells whether given node and its children are valid as if computed by
+     *  NodeInfo(referenceFrame, tileId).valid() and
+     *  NodeInfo::child(child).valid(). Uses only the reference frame division
+     *  tree: no SRS math and no heap allocation is involved.
+     *
+     *  Nodes in subtrees with extra constraints (i.e. partial nodes) cannot be
+     *  evaluated this way, indeterminate value is returned and full NodeInfo
+     *  must be used instead: validity of such node is sampled in its own
+     *  extents and thus cannot be derived from any precomputed per-subtree
+     *  information without SRS math.
+     *
+     * \param referenceFrame reference frame
+     * \param tileId ID of node/tile
+     * \param children valid children flags (filled in only for valid node)
+     * \return true for valid node, false for invalid node, indeterminate when
+     *         validity of node or any of its children cannot be determined
+     */
+    static boost::tribool checkValidity(const registry::ReferenceFrame
+                                        &referenceFrame
+                                        , const TileId &tileId
+                                        , ChildFlags &children);
+
     /** Generate list of nodeinfos from valid referenceframes' nodes.
      */
     static NodeInfo::list nodes(const registry::ReferenceFrame &referenceFrame
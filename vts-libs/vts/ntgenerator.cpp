@@ -106,6 +106,23 @@ NtGenerator::NtGenerator(const registry::ReferenceFrame *referenceFrame
     if (path) { load(*path); }
 }
 
+void NtGenerator::tiled(const TiledHeightMap::Config &config)
+{
+    tiled_ = config;
+    limitAccumulators();
+}
+
+void NtGenerator::limitAccumulators()
+{
+    if (!tiled_ || accumulators_.empty()) { return; }
+
+    // accumulators share half of the budget
+    const auto limit(tiled_->memoryBudget / 2 / accumulators_.size());
+    for (auto &item : accumulators_) {
+        item.second->hma.memoryLimit(limit, tiled_->tmpDir);
+    }
+}
+
 void NtGenerator::addAccumulator(const std::string &sds
                                  , const LodRange &lodRange
                                  , double pixelSize)
@@ -118,11 +135,11 @@ void NtGenerator::addAccumulator(const std::string &sds
 
     auto *node(fsds2rfnode->second);
 
-    accumulators_.insert
-        (Accumulator::map::value_type
-         (node, std::make_shared<Accumulator>
-          (*referenceFrame_, *node
-           , NavtileInfo(lodRange, pixelSize))));
+    auto acc(std::make_shared<Accumulator>
+             (*referenceFrame_, *node, NavtileInfo(lodRange, pixelSize)));
+
+    accumulators_.insert(Accumulator::map::value_type(node, acc));
+    limitAccumulators();
 }
 
 void NtGenerator::load(const fs::path &path)
@@ -229,23 +246,43 @@ void NtGenerator::addTile(const TileId &tileId, const NodeInfo &nodeInfo
     auto &acc(*faccumulators->second);
     if (tileId.lod != acc.ntInfo.lodRange.max) { return; }
 
-    auto &hm([&]() -> cv::Mat&
-    {
-        cv::Mat *hm(nullptr);
-        UTILITY_OMP(critical(getnavtile))
-            hm = &acc.hma.tile(tileId);
-        return *hm;
-    }());
+    const auto &tileSize(acc.hma.tileSize());
 
-    // invalid heightmap value (i.e. initial value) is +oo and we take minimum
+    // invalid heightmap value (i.e. initial value) is -oo and we take maximum
     // of all rasterized heights in given place
-    rasterizeMesh(mesh, acc.toNavSrs(srs)
-                  , mesh2grid(nodeInfo.extents(), acc.hma.tileSize())
-                  , acc.hma.tileSize(), [&](int x, int y, float z)
+    auto rasterize([&](cv::Mat &hm)
     {
-        auto &value(hm.at<float>(y, x));
-        if (z > value) { value = z; }
+        rasterizeMesh(mesh, acc.toNavSrs(srs)
+                      , mesh2grid(nodeInfo.extents(), tileSize)
+                      , tileSize, [&](int x, int y, float z)
+        {
+            auto &value(hm.at<float>(y, x));
+            if (z > value) { value = z; }
+        });
     });
+
+    if (!tiled_) {
+        // all tiles stay in memory, rasterize in place
+        auto &hm([&]() -> cv::Mat&
+        {
+            cv::Mat *hm(nullptr);
+            UTILITY_OMP(critical(getnavtile))
+                hm = &acc.hma.tile(tileId);
+            return *hm;
+        }());
+        rasterize(hm);
+        return;
+    }
+
+    // rasterize into local tile first; accumulated tiles can be spilled to
+    // disk by other threads
+    cv::Mat hm(tileSize.height, tileSize.width
+               , vts::opencv::NavTile::CvDataType
+               , cv::Scalar(HeightMap::InvalidHeight));
+    rasterize(hm);
+
+    UTILITY_OMP(critical(getnavtile))
+        acc.hma.merge(tileId, hm);
 }
 
     void addTile(const TileId &tileId, const NodeInfo &nodeInfo
@@ -254,8 +291,9 @@ void NtGenerator::addTile(const TileId &tileId, const NodeInfo &nodeInfo
 
 namespace {
 
+template <typename HeightMapType>
 void fillSurrogate(vts::TileSet &ts, const vts::TileIndex &ti
-                   , const vts::HeightMap &hm
+                   , const HeightMapType &hm
                    , const vts::NodeInfo &root, vts::Lod lod
                    , const vts::TileRange &tileRange
                    , NtGenerator::Reporter &reporter)
@@ -292,124 +330,147 @@ void NtGenerator::generate(TileSet &ts, double dtmExtractionRadius) const
     generate(ts, dtmExtractionRadius, dummy);
 }
 
-void NtGenerator::generate(vts::TileSet &ts, double dtmExtractionRadius
+template <typename HeightMapType>
+void NtGenerator::generate(vts::TileSet &ts, const RFNode &rfnode
+                           , Accumulator &acc, HeightMapType &hm
+                           , boost::optional<HeightMap::BestPosition>
+                           &bestPosition
                            , Reporter &reporter)
     const
 {
-    if (accumulators_.empty()) {
-        // we need to report empty set
-        reporter.expect(0);
-        return;
-    }
-
-    boost::optional<vts::HeightMap::BestPosition> bestPosition;
     const auto &navigationSrs(referenceFrame_->model.navigationSrs);
 
     const auto &ti(ts.tileIndex());
     const auto lodRange(ti.lodRange());
 
-    reporter.expect(ti.count());
-
-    for (auto &item : accumulators_) {
-        const auto &rfnode(*item.first);
-        const vts::NodeInfo ni(*referenceFrame_, rfnode.id);
-        auto &acc(*item.second);
-
-        vts::HeightMap hm
-            (std::move(acc.hma), *referenceFrame_
-             , dtmExtractionRadius / acc.ntInfo.pixelSize);
+    const vts::NodeInfo ni(*referenceFrame_, rfnode.id);
 
-        // use best position if better than previous
+    // use best position if better than previous
+    {
+        auto bp(hm.bestPosition());
+        if (!bestPosition
+            || (bp.verticalExtent > bestPosition->verticalExtent))
         {
-            auto bp(hm.bestPosition());
-            if (!bestPosition
-                || (bp.verticalExtent > bestPosition->verticalExtent))
-            {
-                bp.location
-                    = vts::CsConvertor(rfnode.srs, navigationSrs)
-                    (bp.location);
-                bestPosition = bp;
-            }
+            bp.location
+                = vts::CsConvertor(rfnode.srs, navigationSrs)
+                (bp.location);
+            bestPosition = bp;
         }
+    }
 
-        const auto &lr(acc.ntInfo.lodRange);
+    const auto &lr(acc.ntInfo.lodRange);
 
-        // limit of navtile's influence
-        const vts::Lod nt2Tilelimit(lr.max + vts::NavTile::binOrder);
-        // prefill by defaults
-        vts::Lod tileLod(lodRange.max);
-        auto tileRange(vts::childRange(rfnode.id, tileLod));
+    // limit of navtile's influence
+    const vts::Lod nt2Tilelimit(lr.max + vts::NavTile::binOrder);
+    // prefill by defaults
+    vts::Lod tileLod(lodRange.max);
+    auto tileRange(vts::childRange(rfnode.id, tileLod));
 
-        if (tileLod > nt2Tilelimit) {
-            // there are some tiles deeper under then navtile influence; let's
-            // generate their surrogates from bottom navtiles
+    if (tileLod > nt2Tilelimit) {
+        // there are some tiles deeper under then navtile influence; let's
+        // generate their surrogates from bottom navtiles
 
-            for (; tileLod > nt2Tilelimit;
-                 --tileLod, tileRange = vts::parentRange(tileRange))
-            {
-                fillSurrogate(ts, ti, hm, ni, tileLod, tileRange, reporter);
-            }
-        } else {
-            // data under navtile's influence, peg to bottom navtile lod
-            tileLod = nt2Tilelimit;
-            tileRange = vts::childRange(rfnode.id, tileLod);
+        for (; tileLod > nt2Tilelimit;
+             --tileLod, tileRange = vts::parentRange(tileRange))
+        {
+            fillSurrogate(ts, ti, hm, ni, tileLod, tileRange, reporter);
         }
+    } else {
+        // data under navtile's influence, peg to bottom navtile lod
+        tileLod = nt2Tilelimit;
+        tileRange = vts::childRange(rfnode.id, tileLod);
+    }
+
+    LOG(info3) << "Extracting navtiles.";
 
-        LOG(info3) << "Extracting navtiles.";
+    // iterate in nt lod range backwards: iterate from start and invert
+    // forward lod into backward lod
+    for (auto lod(lr.max); lod >= lr.min; --lod, --tileLod
+             , tileRange = vts::parentRange(tileRange))
+    {
+        LOG(info3) << "Setting navtiles at lod " << lod << ".";
 
-        // iterate in nt lod range backwards: iterate from start and invert
-        // forward lod into backward lod
-        for (auto lod(lr.max); lod >= lr.min; --lod, --tileLod
-                 , tileRange = vts::parentRange(tileRange))
+        // resize heightmap for given lod
+        hm.resize(lod);
+
+        // generate and store navtiles
+        // FIXME: traverse only part covered by current node
+        traverse(ti, lod
+                 , [&](const vts::TileId &tileId
+                       , vts::QTree::value_type flags)
         {
-            LOG(info3) << "Setting navtiles at lod " << lod << ".";
-
-            // resize heightmap for given lod
-            hm.resize(lod);
-
-            // generate and store navtiles
-            // FIXME: traverse only part covered by current node
-            traverse(ti, lod
-                     , [&](const vts::TileId &tileId
-                           , vts::QTree::value_type flags)
-            {
-                // process only tiles with mesh
-                if (!(flags & vts::TileIndex::Flag::mesh)) { return; }
-
-                if (auto nt = hm.navtile(tileId)) {
-                    ts.setNavTile(tileId, *nt);
-                }
-            });
-
-            if (storage::in(tileLod , lodRange)) {
-                // tile lod is valid, fill surrogates
-                fillSurrogate(ts, ti, hm, ni, tileLod, tileRange, reporter);
+            // process only tiles with mesh
+            if (!(flags & vts::TileIndex::Flag::mesh)) { return; }
+
+            if (auto nt = hm.navtile(tileId)) {
+                ts.setNavTile(tileId, *nt);
             }
+        });
+
+        if (storage::in(tileLod , lodRange)) {
+            // tile lod is valid, fill surrogates
+            fillSurrogate(ts, ti, hm, ni, tileLod, tileRange, reporter);
         }
+    }
 
-        LOG(info3) << "Navtiles extracted.";
+    LOG(info3) << "Navtiles extracted.";
 
-        // force halve that is not covered by resize in main loop
-        if (tileLod >= lodRange.min) {
-            hm.halve();
-        }
+    // force halve that is not covered by resize in main loop
+    if (tileLod >= lodRange.min) {
+        hm.halve();
+    }
 
-        // wind up to first valid lod if not there yet
-        while (tileLod > lodRange.max) {
-            // halve heightmap
-            hm.halve();
-            --tileLod;
-        }
+    // wind up to first valid lod if not there yet
+    while (tileLod > lodRange.max) {
+        // halve heightmap
+        hm.halve();
+        --tileLod;
+    }
 
-        // process tail
-        for (; in(tileLod, lodRange);
-             --tileLod, tileRange = vts::parentRange(tileRange))
-        {
-            // tile lod is valid, fill surrogates
-            fillSurrogate(ts, ti, hm, ni, tileLod, tileRange, reporter);
+    // process tail
+    for (; in(tileLod, lodRange);
+         --tileLod, tileRange = vts::parentRange(tileRange))
+    {
+        // tile lod is valid, fill surrogates
+        fillSurrogate(ts, ti, hm, ni, tileLod, tileRange, reporter);
 
-            // halve heightmap
-            hm.halve();
+        // halve heightmap
+        hm.halve();
+    }
+}
+
+void NtGenerator::generate(vts::TileSet &ts, double dtmExtractionRadius
+                           , Reporter &reporter)
+    const
+{
+    if (accumulators_.empty()) {
+        // we need to report empty set
+        reporter.expect(0);
+        return;
+    }
+
+    reporter.expect(ts.tileIndex().count());
+
+    boost::optional<vts::HeightMap::BestPosition> bestPosition;
+
+    if (tiled_) {
+        // keep only heightmap being processed in memory
+        for (auto &item : accumulators_) { item.second->hma.spill(); }
+
+        for (auto &item : accumulators_) {
+            auto &acc(*item.second);
+            vts::TiledHeightMap hm
+                (std::move(acc.hma), *referenceFrame_
+                 , dtmExtractionRadius / acc.ntInfo.pixelSize, *tiled_);
+            generate(ts, *item.first, acc, hm, bestPosition, reporter);
+        }
+    } else {
+        for (auto &item : accumulators_) {
+            auto &acc(*item.second);
+            vts::HeightMap hm
+                (std::move(acc.hma), *referenceFrame_
+                 , dtmExtractionRadius / acc.ntInfo.pixelSize);
+            generate(ts, *item.first, acc, hm, bestPosition, reporter);
         }
     }
 
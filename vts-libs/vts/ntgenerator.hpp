@@ -37,6 +37,7 @@
 #include "basetypes.hpp"
 #include "nodeinfo.hpp"
 #include "tileset.hpp"
+#include "heightmap.hpp"
 
 namespace vtslibs { namespace vts {
 
@@ -83,6 +84,12 @@ public:
         virtual ~Reporter() {}
     };
 
+    /** Switch to out-of-core navtile generation: accumulated tiles are
+     *  spilled to disk and heightmaps are processed by TiledHeightMap.
+     *  Peak memory is bounded by config.memoryBudget.
+     */
+    void tiled(const TiledHeightMap::Config &config);
+
     /** Generate navtiles and surrogates.
      */
     void generate(TileSet &ts, double dtmExtractionRadius) const;
@@ -95,10 +102,22 @@ public:
     struct Accumulator;
 
 private:
+    template <typename HeightMapType>
+    void generate(TileSet &ts, const RFNode &rfnode, Accumulator &acc
+                  , HeightMapType &hm
+                  , boost::optional<HeightMap::BestPosition> &bestPosition
+                  , Reporter &reporter) const;
+
+    /** Splits half of the tiled memory budget among all accumulators.
+     */
+    void limitAccumulators();
+
     const registry::ReferenceFrame *referenceFrame_;
     const std::map<std::string, const RFNode*> sds2rfnode_;
 
     std::map<const RFNode*, std::shared_ptr<Accumulator>> accumulators_;
+
+    boost::optional<TiledHeightMap::Config> tiled_;
 };
 
 } } // namespace vtslibs::vts
@@ -99,6 +99,27 @@ inline void configure(const boost::program_options::variables_map &vars
     (void) vars;
 }
 
+inline void configuration(boost::program_options::options_description &od
+                          , GlueCreationOptions &go)
+{
+    namespace po = boost::program_options;
+
+    configuration(od, static_cast<MergeOptions&>(go));
+
+    od.add_options()
+        ("glue.threads", po::value(&go.threadCount)
+         ->default_value(go.threadCount)
+         , "Number of glue generation threads. 0 means number of "
+         "available CPUs.")
+        ;
+}
+
+inline void configure(const boost::program_options::variables_map &vars
+                      , GlueCreationOptions &go)
+{
+    configure(vars, static_cast<MergeOptions&>(go));
+}
+
 } } // namespace vtslibs::vts
 
 #endif // vtslibs_vts_options_po_hpp_included_
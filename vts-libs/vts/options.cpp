@@ -47,6 +47,26 @@ void OpenOptions::configuration(po::options_description &od
          , po::value(&ioWait_)->default_value(ioWait_)
          , "Timeout for I/O operations [in ms] "
          "(-1 means infinity retries).")
+        ((prefix + "io.mmap").c_str()
+         , po::value(&mappedArchives_)->default_value(mappedArchives_)
+         , "Map read-only tile archives into memory instead of reading "
+         "them via file descriptors.")
+        ((prefix + "io.remoteCache").c_str()
+         , po::value(&remoteCache_)
+         , "Root directory of persistent on-disk cache of remote tilesets. "
+         "Cache is disabled if not set.")
+        ((prefix + "io.remoteCacheSize").c_str()
+         , po::value(&remoteCacheSize_)->default_value(remoteCacheSize_)
+         , "Size limit (in bytes) of on-disk cache of single remote "
+         "tileset. Zero disables the cache.")
+        ((prefix + "metaCacheLimit").c_str()
+         , po::value(&metaCacheLimit_)->default_value(metaCacheLimit_)
+         , "Memory limit (in bytes) of metatile cache. Zero means no "
+         "limit.")
+        ((prefix + "delivery.pngCompression").c_str()
+         , po::value(&pngCompression_)->default_value(pngCompression_)
+         , "Zlib compression level (0-9) of generated 2D tiles (masks and "
+         "2D metatiles). Low levels encode faster but produce bigger files.")
         ((prefix + "cname").c_str()
          , po::value<std::vector<std::string>>()
          , "CName mimicking for hostnames in remote tileset URLs. "
@@ -72,6 +92,12 @@ void OpenOptions::configure(const po::variables_map &vars
             cnames_[def.substr(0, colon)] = def.substr(colon + 1);
         }
     }
+
+    if ((pngCompression_ < 0) || (pngCompression_ > 9)) {
+        throw po::validation_error
+            (po::validation_error::invalid_option_value
+             , prefix + "delivery.pngCompression");
+    }
 }
 
 std::ostream& OpenOptions::dump(std::ostream &os, const std::string &prefix)
@@ -79,7 +105,13 @@ std::ostream& OpenOptions::dump(std::ostream &os, const std::string &prefix)
 {
     os << prefix << "io.retries = " << ioRetries_ << '\n'
        << prefix << "io.retryDelay = " << ioRetryDelay_ << '\n'
-       << prefix << "io.wait = " << ioWait_ << '\n';
+       << prefix << "io.wait = " << ioWait_ << '\n'
+       << prefix << "io.mmap = " << std::boolalpha << mappedArchives_
+       << std::noboolalpha << '\n'
+       << prefix << "io.remoteCache = " << remoteCache_ << '\n'
+       << prefix << "io.remoteCacheSize = " << remoteCacheSize_ << '\n'
+       << prefix << "metaCacheLimit = " << metaCacheLimit_ << '\n'
+       << prefix << "delivery.pngCompression = " << pngCompression_ << '\n';
 
     for (const auto &item : cnames_) {
         os << prefix << "cname = " << item.first
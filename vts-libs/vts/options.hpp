@@ -38,6 +38,7 @@
 
 #include <boost/optional.hpp>
 #include <boost/program_options.hpp>
+#include <boost/filesystem/path.hpp>
 
 #include "basetypes.hpp"
 #include "tileindex.hpp"
@@ -52,6 +53,10 @@ namespace vtslibs { namespace vts {
  *
  *  Available options:
  *      relocate: temporary dataset reloaction; really useful only for URLs
+ *      remoteCache: directory of persistent cache of remote tilesets
+ *      remoteCacheSize: size limit of persistent cache of remote tileset
+ *      metaCacheLimit: memory limit of metatile cache
+ *      pngCompression: zlib level of PNG images generated on the fly
  */
 class OpenOptions {
 public:
@@ -60,6 +65,10 @@ public:
         , ioRetryDelay_(1000) // 1000 ms
         , ioWait_(-1) // infinity
         , scarceMemory_(false)
+        , mappedArchives_(false)
+        , remoteCacheSize_(1ul << 30) // 1 GiB
+        , metaCacheLimit_(1ul << 31) // 2 GiB
+        , pngCompression_(9)
     {}
 
     typedef std::map<std::string, std::string> CNames;
@@ -92,6 +101,33 @@ public:
         scarceMemory_ = scarceMemory; return *this;
     }
 
+    bool mappedArchives() const { return mappedArchives_; }
+    OpenOptions& mappedArchives(bool mappedArchives) {
+        mappedArchives_ = mappedArchives; return *this;
+    }
+
+    const boost::filesystem::path& remoteCache() const {
+        return remoteCache_;
+    }
+    OpenOptions& remoteCache(const boost::filesystem::path &remoteCache) {
+        remoteCache_ = remoteCache; return *this;
+    }
+
+    std::size_t remoteCacheSize() const { return remoteCacheSize_; }
+    OpenOptions& remoteCacheSize(std::size_t remoteCacheSize) {
+        remoteCacheSize_ = remoteCacheSize; return *this;
+    }
+
+    std::size_t metaCacheLimit() const { return metaCacheLimit_; }
+    OpenOptions& metaCacheLimit(std::size_t metaCacheLimit) {
+        metaCacheLimit_ = metaCacheLimit; return *this;
+    }
+
+    int pngCompression() const { return pngCompression_; }
+    OpenOptions& pngCompression(int pngCompression) {
+        pngCompression_ = pngCompression; return *this;
+    }
+
     const std::shared_ptr<utility::ResourceFetcher>& resourceFetcher() const {
         return resourceFetcher_;
     }
@@ -134,6 +170,31 @@ private:
     /** We are (or do not want to be) running out of memory.
      */
     bool scarceMemory_;
+
+    /** Map read-only tile archives into memory. Interpreted by plain driver.
+     */
+    bool mappedArchives_;
+
+    /** Root of persistent on-disk cache of remote tilesets. Interpreted by
+     *  remote driver. Empty path disables the cache.
+     */
+    boost::filesystem::path remoteCache_;
+
+    /** Size limit (in bytes) of on-disk cache of single remote tileset.
+     *  Zero disables the cache.
+     */
+    std::size_t remoteCacheSize_;
+
+    /** Memory limit (in bytes) of metatile cache. Cold metatiles of writable
+     *  tileset are spilled to temporary storage when limit is reached. Zero
+     *  means no limit.
+     */
+    std::size_t metaCacheLimit_;
+
+    /** Zlib compression level (0-9) of PNG images generated by delivery (2D
+     *  masks and metatiles). Low levels trade output size for encoding speed.
+     */
+    int pngCompression_;
 };
 
 /** Tilset clone options. Sometimes used for tileset creation.
@@ -386,8 +447,16 @@ struct GlueCreationOptions : MergeOptions {
     typedef std::function<void(vts::TileIndex&)> GenerateSetManipulator;
     GenerateSetManipulator generateSetManipulator;
 
+    /** Number of threads used to generate glue tiles. Subtrees are processed
+     *  in parallel but tiles are written in the same order as in the serial
+     *  run, i.e. output is identical.
+     *
+     *  0 means number of available CPUs.
+     */
+    std::size_t threadCount;
+
     GlueCreationOptions()
-        : textureQuality()
+        : textureQuality(), threadCount()
     {}
 };
 
@@ -209,6 +209,8 @@ public:
      *  openOptions: options for tileset open
      *  mode: glue generation mode
      *  overwrite: allow glue overwrite
+     *  glueWorkers: number of concurrently generated glues
+     *  glueWorkerMemory: memory budget of single glue worker
      */
     struct AddOptions : public GlueCreationOptions {
         bool bumpVersion;
@@ -232,10 +234,22 @@ public:
          */
         bool checkTileindexIdentity;
 
+        /** Number of glues generated concurrently. 0 means number of
+         *  available CPUs.
+         */
+        std::size_t glueWorkers;
+
+        /** Memory budget (in bytes) of single glue worker. Another glue is
+         *  not started while process memory footprint would exceed
+         *  glueWorkers * glueWorkerMemory. 0 means no limit.
+         */
+        std::size_t glueWorkerMemory;
+
         AddOptions()
             : bumpVersion(false), filter(), dryRun(false)
             , mode(Mode::legacy), collisionCheck(true)
             , checkTileindexIdentity(true)
+            , glueWorkers(1), glueWorkerMemory()
         {}
     };
 
@@ -40,6 +40,8 @@
 
 #include <chrono> // duration
 #include <thread> // this_thread::sleep
+#include <mutex>
+#include <condition_variable>
 
 #include <boost/optional.hpp>
 #include <boost/noncopyable.hpp>
@@ -91,12 +93,48 @@ void reportMemoryUsage(const std::string &what)
         << " GiB (of which " << (stat.swap / kb2gb) << " GiB is swapped).";
 }
 
+std::size_t memoryFootprint()
+{
+    return utility::getProcStat().occupies() * 1024;
+}
+
 #else
 
 void reportMemoryUsage(const std::string&) {}
 
+std::size_t memoryFootprint() { return 0; }
+
 #endif
 
+std::size_t glueWorkerCount(std::size_t count)
+{
+    if (count) { return count; }
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/** Serializes progress reporting from concurrently generated glues.
+ */
+class LockedMergeProgress : public MergeProgress {
+public:
+    LockedMergeProgress(const MergeProgress::pointer &progress)
+        : progress_(progress)
+    {}
+
+private:
+    virtual void expect_impl(std::size_t total) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        progress_->expect(total);
+    }
+
+    virtual void tile_impl() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        progress_->tile();
+    }
+
+    MergeProgress::pointer progress_;
+    std::mutex mutex_;
+};
+
 inline std::string glueId2path(const Glue::Id &id)
 {
     return boost::lexical_cast<std::string>(utility::join(id, "_"));
@@ -1091,35 +1129,109 @@ void generateGluesImpl(Tx &tx, const GlueDescriptor::list &gds
         return true;
     });
 
-    // run the thing
-    for (const auto &gd : gds) {
+    // NB: storage lock, properties and main transaction are shared by all
+    // glues; access is serialized by this mutex
+    std::mutex mutex;
+    typedef std::unique_lock<std::mutex> Lock;
+
+    // number of glues being generated right now
+    std::size_t running(0);
+
+    // number of glue locks being held; storage lock is released while there
+    // is any glue lock held, i.e. storage is locked iff glueLocks is zero
+    // whenever mutex is not held
+    std::size_t glueLocks(0);
+
+    // glue lock, created and released under mutex
+    struct GlueLock {
+        GlueLock(std::mutex &mutex, std::size_t &count
+                 , ScopedStorageLock &storageLock, const Glue &glue)
+            : mutex(mutex), count(count), storageLock(storageLock)
+        {
+            Lock l(mutex);
+            // storage may be unlocked by another glue lock, lock it again
+            storageLock.lock();
+            try {
+                // lock glue and unlock storage
+                lock.reset(new ScopedStorageLock
+                           (&storageLock, lockName(glue)));
+            } catch (...) {
+                // keep storage unlocked for other glue locks
+                if (count) { storageLock.unlock(); }
+                throw;
+            }
+            ++count;
+        }
+
+        ~GlueLock() {
+            if (!lock) { return; }
+            Lock l(mutex);
+            release();
+            if (count) { storageLock.unlock(); }
+        }
+
+        /** Locks storage and unlocks glue. Must be called under mutex.
+         */
+        void release() {
+            lock.reset();
+            --count;
+        }
+
+        std::mutex &mutex;
+        std::size_t &count;
+        ScopedStorageLock &storageLock;
+        std::unique_ptr<ScopedStorageLock> lock;
+    };
+
+    auto generate([&](const GlueDescriptor &gd
+                      , const Storage::AddOptions &addOptions)
+    {
         // create glue
 
         // skip if invalid
-        if (!validGlue(gd.glue.id)) { continue; }
+        {
+            Lock lock(mutex);
+            if (!validGlue(gd.glue.id)) { return; }
+        }
 
-        // create a sub-transaction
-        auto subTx(tx.subtx());
+        // create a sub-transaction, main transaction is shared
+        auto subTx([&]() { Lock lock(mutex); return tx.subtx(); }());
 
+        std::unique_ptr<GlueLock> glueLock;
         Glue glue;
         try {
             // create glue under glue lock with unlocked storage
-            ScopedStorageLock glueLock(&detail.storageLock, lockName(gd.glue));
+            glueLock.reset(new GlueLock(mutex, glueLocks, detail.storageLock
+                                        , gd.glue));
             glue = createGlue(subTx, gd, addOptions, gds.size());
         } catch (const StorageComponentLocked&) {
             LOG(warn3) << "Unable to lock glue <"
                        << utility::join(gd.glue.id, ",")
                        << ">; skipping.";
-            continue;
+            return;
         }
 
+        // lock storage and unlock glue; mutex is held until all changes are
+        // committed so no other glue lock can unlock storage meanwhile
+        Lock lock(mutex);
+        glueLock->release();
+
+        // unlock storage again if there are other glue locks held
+        struct Unlocker {
+            Unlocker(ScopedStorageLock &storageLock, const std::size_t &count)
+                : storageLock(storageLock), count(count) {}
+            ~Unlocker() { if (count) { storageLock.unlock(); } }
+            ScopedStorageLock &storageLock;
+            const std::size_t &count;
+        } unlocker(detail.storageLock, glueLocks);
+
         // legacy mode?
         if (addOptions.mode == Storage::AddOptions::Mode::legacy) {
             // legacy mode, update properties
             properties.glueGenerated(glue);
             // and join sub transaction into main transaction
             tx.join(subTx);
-            continue;
+            return;
         }
 
         // update stored properties
@@ -1129,7 +1241,7 @@ void generateGluesImpl(Tx &tx, const GlueDescriptor::list &gds
         properties = detail.readConfig();
 
         // skip if invalid
-        if (!validGlue(glue.id)) { continue; }
+        if (!validGlue(glue.id)) { return; }
 
         // update properties, save, commit
         properties.glueGenerated(glue);
@@ -1137,7 +1249,108 @@ void generateGluesImpl(Tx &tx, const GlueDescriptor::list &gds
 
         // main transaction is not commit changes to the sub transaction
         subTx.commit();
+    });
+
+    const auto workers(std::min(glueWorkerCount(addOptions.glueWorkers)
+                                , gds.size()));
+
+    if (workers <= 1) {
+        // run the thing
+        for (const auto &gd : gds) {
+            running = 1;
+            generate(gd, addOptions);
+        }
+        return;
+    }
+
+    LOG(info3) << "Generating glues in " << workers << " workers.";
+
+    // distribute CPUs between workers
+    auto workerOptions(addOptions);
+    if (!workerOptions.threadCount) {
+        workerOptions.threadCount
+            = std::max(std::thread::hardware_concurrency() / workers
+                       , std::size_t(1));
+    }
+
+    // progress is pinged from all workers
+    if (workerOptions.progress) {
+        workerOptions.progress = std::make_shared<LockedMergeProgress>
+            (workerOptions.progress);
+    }
+
+    const auto memoryLimit(workers * addOptions.glueWorkerMemory);
+
+    // next glue to generate
+    std::size_t next(0);
+    std::exception_ptr error;
+    std::condition_variable cond;
+
+    auto canStart([&]() -> bool
+    {
+        // nothing running or no limit -> can start
+        if (!running || !memoryLimit) { return true; }
+
+        const auto footprint(memoryFootprint());
+        if ((footprint + addOptions.glueWorkerMemory) <= memoryLimit) {
+            return true;
+        }
+
+        LOG(info2) << "Memory footprint (" << footprint
+                   << " B) too high to start another glue.";
+        return false;
+    });
+
+    const auto tid(dbglog::thread_id());
+
+    auto worker([&](std::size_t index)
+    {
+        dbglog::thread_id(str(boost::format("%s/glue:%u") % tid % index));
+
+        for (;;) {
+            const GlueDescriptor *gd;
+            {
+                Lock lock(mutex);
+                for (;;) {
+                    if (error || (next >= gds.size())) { return; }
+                    if (canStart()) { break; }
+                    // memory can drop by itself, check periodically
+                    cond.wait_for(lock, std::chrono::seconds(1));
+                }
+
+                gd = &gds[next++];
+                ++running;
+            }
+
+            try {
+                // use private tileset instances, tileset internals are not
+                // thread safe
+                GlueDescriptor own(*gd);
+                for (auto &ts : own.combination) {
+                    ts = openTileSet(ts.root(), addOptions.openOptions);
+                }
+
+                generate(own, workerOptions);
+            } catch (...) {
+                Lock lock(mutex);
+                if (!error) { error = std::current_exception(); }
+            }
+
+            {
+                Lock lock(mutex);
+                --running;
+            }
+            cond.notify_all();
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (std::size_t i(0); i < workers; ++i) {
+        threads.emplace_back(worker, i);
     }
+    for (auto &thread : threads) { thread.join(); }
+
+    if (error) { std::rethrow_exception(error); }
 }
 
 void Storage::Detail::add(const TileSet &tileset, const Location &where
@@ -30,8 +30,15 @@
  * Tile set storage access.
  */
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <set>
+#include <tuple>
+#include <mutex>
 #include <exception>
 #include <algorithm>
 #include <iterator>
@@ -46,6 +53,7 @@
 #include "utility/streams.hpp"
 #include "utility/guarded-call.hpp"
 #include "utility/path.hpp"
+#include "utility/openmp.hpp"
 
 #include "../../storage/error.hpp"
 #include "../storage.hpp"
@@ -510,6 +518,172 @@ inline const TilesetIdMap* optionalRename(const TilesetIdMap &map)
     return nullptr;
 }
 
+/** File version as seen by stat(2). Both in-place rewrite (modification and
+ *  change time with sub-second precision) and replacement by rename (inode)
+ *  show up as a change even when size stays the same.
+ */
+struct FileVersion {
+    bool exists;
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::uint64_t size;
+    std::int64_t mtime;
+    std::int64_t mtimeNsec;
+    std::int64_t ctime;
+    std::int64_t ctimeNsec;
+
+    FileVersion()
+        : exists(false), device(), inode(), size(), mtime(), mtimeNsec()
+        , ctime(), ctimeNsec()
+    {}
+
+    static FileVersion stat(const fs::path &path);
+
+    bool operator==(const FileVersion &o) const {
+        return (std::tie(exists, device, inode, size, mtime, mtimeNsec
+                         , ctime, ctimeNsec)
+                == std::tie(o.exists, o.device, o.inode, o.size, o.mtime
+                            , o.mtimeNsec, o.ctime, o.ctimeNsec));
+    }
+
+    typedef std::vector<FileVersion> list;
+};
+
+FileVersion FileVersion::stat(const fs::path &path)
+{
+    FileVersion v;
+#ifdef _WIN32
+    // no inode nor sub-second times available here
+    const auto s(FileStat::stat(path, std::nothrow));
+    v.exists = s.lastModified;
+    v.size = s.size;
+    v.mtime = s.lastModified;
+#else
+    struct ::stat st;
+    if (-1 == ::stat(path.string().c_str(), &st)) { return v; }
+    v.exists = true;
+    v.device = st.st_dev;
+    v.inode = st.st_ino;
+    v.size = st.st_size;
+    v.mtime = st.st_mtim.tv_sec;
+    v.mtimeNsec = st.st_mtim.tv_nsec;
+    v.ctime = st.st_ctim.tv_sec;
+    v.ctimeNsec = st.st_ctim.tv_nsec;
+#endif
+    return v;
+}
+
+FileVersion::list configVersion(const fs::path &path)
+{
+    FileVersion::list versions;
+    for (const auto &file : Driver::configFiles(path)) {
+        versions.push_back(FileVersion::stat(file));
+    }
+    return versions;
+}
+
+/** Process-wide cache of surface map configuration fragments (tileset, glue
+ *  or virtual surface mapConfig) keyed by surface path. Cached fragment is
+ *  reused as long as versions of surface's configuration files stay the
+ *  same. Entries of surfaces no longer present in their storage are dropped
+ *  by prune().
+ */
+class FragmentCache : boost::noncopyable {
+public:
+    typedef std::shared_ptr<const MapConfig> Fragment;
+
+    Fragment get(const fs::path &root, const fs::path &path);
+
+    /** Drops all entries belonging to storage at given root whose path is
+     *  not in the live set.
+     */
+    void prune(const fs::path &root, const std::set<fs::path> &live);
+
+    static FragmentCache& instance() {
+        static FragmentCache cache;
+        return cache;
+    }
+
+private:
+    struct Entry {
+        fs::path root;
+        FileVersion::list versions;
+        Fragment fragment;
+    };
+
+    std::mutex mutex_;
+    std::map<fs::path, Entry> entries_;
+};
+
+FragmentCache::Fragment FragmentCache::get(const fs::path &root
+                                           , const fs::path &path)
+{
+    // stat before loading: change during loading is caught next time
+    auto versions(configVersion(path));
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto fentries(entries_.find(path));
+        if ((fentries != entries_.end())
+            && (fentries->second.versions == versions))
+        {
+            return fentries->second.fragment;
+        }
+    }
+
+    LOG(info1) << "Loading mapConfig fragment from " << path << ".";
+    auto fragment(std::make_shared<const MapConfig>
+                  (TileSet::mapConfig(path, false)));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto &entry(entries_[path]);
+    entry.root = root;
+    entry.versions = std::move(versions);
+    entry.fragment = fragment;
+    return fragment;
+}
+
+void FragmentCache::prune(const fs::path &root
+                          , const std::set<fs::path> &live)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto ientries(entries_.begin()); ientries != entries_.end(); ) {
+        if ((ientries->second.root == root)
+            && !live.count(ientries->first))
+        {
+            ientries = entries_.erase(ientries);
+        } else {
+            ++ientries;
+        }
+    }
+}
+
+/** Loads all fragments in parallel. Output is in the same order as input.
+ */
+std::vector<FragmentCache::Fragment>
+loadFragments(const fs::path &root, const std::vector<fs::path> &paths)
+{
+    std::vector<FragmentCache::Fragment> fragments(paths.size());
+    auto &cache(FragmentCache::instance());
+
+    std::exception_ptr exc;
+    const int size(paths.size());
+
+    UTILITY_OMP(parallel for schedule(dynamic))
+    for (int i = 0; i < size; ++i) {
+        try {
+            fragments[i] = cache.get(root, paths[i]);
+        } catch (...) {
+            UTILITY_OMP(critical(vts_storage_loadFragments))
+            if (!exc) { exc = std::current_exception(); }
+        }
+    }
+
+    if (exc) { std::rethrow_exception(exc); }
+
+    return fragments;
+}
+
 } // namespace
 
 TilesetIdMap Storage::Properties::unique(const TilesetIdSet *subset) const
@@ -695,64 +869,95 @@ MapConfig Storage::Detail::mapConfig(const boost::filesystem::path &root
         });
     });
 
-    // tilesets
-    // bool surfacesAvailable(true);
+    // gather surfaces, glues and virtual surfaces to merge in; their
+    // mapConfig fragments are loaded in parallel and cached
+    std::vector<const StoredTileset*> surfaces;
+    std::vector<const Glue*> glues;
+    std::vector<const VirtualSurface*> virtualSurfaces;
+    std::vector<fs::path> fragmentPaths;
+
     for (const auto &tileset : properties.tilesets) {
         // check for tileset being both requested and fully available
-        bool surface(allowed(unique, tileset.tilesetId));
+        if (!allowed(unique, tileset.tilesetId)) { continue; }
+
+        glueable.insert(tileset.tilesetId);
+        surfaces.push_back(&tileset);
+        fragmentPaths.push_back
+            (storage_paths::tilesetPath(root, tileset.tilesetId));
+    }
 
-        // should we use it as a free layer?
-        bool fl(freeLayers && freeLayers->count(tileset.tilesetId));
+    for (const auto &item : properties.glues) {
+        // limit to tileset subset
+        if (!allowed(glueable, item.first)) { continue; }
+
+        glues.push_back(&item.second);
+        fragmentPaths.push_back(storage_paths::gluePath(root, item.second));
+    }
+
+    if (extra.virtualSurfacesEnabled) {
+        for (const auto &item : properties.virtualSurfaces) {
+            // limit to tileset subset
+            if (!allowed(unique, item.first)) { continue; }
+
+            virtualSurfaces.push_back(&item.second);
+            fragmentPaths.push_back
+                (storage_paths::virtualSurfacePath(root, item.second));
+        }
+    }
+
+    // forget fragments of surfaces removed from storage
+    {
+        std::set<fs::path> live;
+        for (const auto &tileset : properties.tilesets) {
+            live.insert(storage_paths::tilesetPath(root, tileset.tilesetId));
+        }
+        for (const auto &item : properties.glues) {
+            live.insert(storage_paths::gluePath(root, item.second));
+        }
+        for (const auto &item : properties.virtualSurfaces) {
+            live.insert(storage_paths::virtualSurfacePath(root, item.second));
+        }
+        FragmentCache::instance().prune(root, live);
+    }
+
+    const auto fragments(loadFragments(root, fragmentPaths));
+    auto ifragments(fragments.begin());
+
+    // free layers
+    if (freeLayers) {
+        for (const auto &tileset : properties.tilesets) {
+            // should we use it as a free layer?
+            if (!freeLayers->count(tileset.tilesetId)) { continue; }
 
-        // handle tileset as a free layers
-        if (fl) {
             // tileset path as a root
             mapConfig.addMeshTilesConfig
                 (TileSet::meshTilesConfig
                  (storage_paths::tilesetPath(root, tileset.tilesetId), false)
                  , tilesetUrl(tileset), tilesetRename);
         }
+    }
 
-        // handle tileset as a surface
-        if (surface) {
-            glueable.insert(tileset.tilesetId);
-            mapConfig.mergeTileSet
-                (TileSet::mapConfig
-                 (storage_paths::tilesetPath(root, tileset.tilesetId), false)
-                 , tilesetUrl(tileset), tilesetRename);
-        }
+    // tilesets
+    for (const auto *tileset : surfaces) {
+        mapConfig.mergeTileSet(**ifragments++, tilesetUrl(*tileset)
+                               , tilesetRename);
     }
 
     // glues
-    for (const auto &item : properties.glues) {
-        // limit to tileset subset
-        if (!allowed(glueable, item.first)) { continue; }
-
-        const auto &glue(item.second);
+    for (const auto *glue : glues) {
         mapConfig.mergeGlue
-            (TileSet::mapConfig
-             (storage_paths::gluePath(root, glue), false)
-             , glue, supportTilesetUrl
+            (**ifragments++, *glue, supportTilesetUrl
              (properties.gluesExternalUrl, storage_paths::glueRoot())
              , tilesetRename);
     }
 
     // virtualSurfaces
-    if (extra.virtualSurfacesEnabled) {
-        for (const auto &item : properties.virtualSurfaces) {
-            // limit to tileset subset
-            if (!allowed(unique, item.first)) { continue; }
-
-            const auto &virtualSurface(item.second);
-            mapConfig.mergeVirtualSurface
-                (TileSet::mapConfig
-                 (storage_paths::virtualSurfacePath
-                  (root, virtualSurface), false)
-                 , virtualSurface
-                 , supportTilesetUrl(properties.vsExternalUrl
-                                     , storage_paths::virtualSurfaceRoot())
-                 , tilesetRename);
-        }
+    for (const auto *virtualSurface : virtualSurfaces) {
+        mapConfig.mergeVirtualSurface
+            (**ifragments++, *virtualSurface
+             , supportTilesetUrl(properties.vsExternalUrl
+                                 , storage_paths::virtualSurfaceRoot())
+             , tilesetRename);
     }
 
     if (extra.position) {
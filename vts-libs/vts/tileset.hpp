@@ -67,6 +67,12 @@ namespace vtslibs { namespace vts {
 class Driver;
 
 /** TileSet interface.
+ *
+ *  Read-only tile set is safe for concurrent readers: getMesh, getMeshMask,
+ *  getAtlas, getNavTile, getMetaNode (value-returning variant), findMetaNode,
+ *  getMetaTile and exists can be called from multiple threads at once. Only
+ *  cache lookups are serialized, file reads and decoding run in parallel.
+ *  Writable tile set is not thread safe unless stated otherwise.
  */
 class TileSet {
 public:
@@ -146,6 +152,40 @@ public:
     void setTile(const TileId &tileId, const TileSource &tile
                  , const NodeInfo &nodeInfo);
 
+    /** Encodes tile content and computes its metanode without touching the
+     *  tile set. All CPU-heavy work of setTile is done here.
+     *
+     *  Thread safe: can be called in parallel with each other and with
+     *  commitTile.
+     *
+     *  setTile(tileId, tile) == commitTile(prepareTile(tileId, tile))
+     *
+     *  \param tileId tile identifier
+     *  \param tile tile content
+     *  \return encoded tile
+     */
+    PreparedTile prepareTile(const TileId &tileId, const Tile &tile) const;
+
+    /** Encodes tile content and computes its metanode without touching the
+     *  tile set.
+     *
+     * Supplied nodeInfo must be correct!
+     *
+     *  \param tileId tile identifier
+     *  \param tile tile content
+     *  \param nodeInfo information about node
+     *  \return encoded tile
+     */
+    PreparedTile prepareTile(const TileId &tileId, const Tile &tile
+                             , const NodeInfo &nodeInfo) const;
+
+    /** Stores tile encoded by prepareTile: writes its data and updates
+     *  metadata. Not thread safe (same as setTile) but cheap.
+     *
+     *  \param tile encoded tile
+     */
+    void commitTile(const PreparedTile &tile);
+
     /** Marks tile as influenced tile.
      *  Fails if tile is already a valid tile.
      */
@@ -168,8 +208,21 @@ public:
      */
     MetaNode getMetaNode(const TileId &tileId) const;
 
+    /** Returns tile's metanode or null pointer if there is no such node.
+     *
+     *  Returned pointer keeps metanode's metatile alive, i.e. it is safe to
+     *  use even when the metatile is evicted from the metatile cache by
+     *  concurrent readers.
+     */
+    MetaNode::pointer findMetaNode(const TileId &tileId) const;
+
     /** Returns tile's metanode.
+     *
+     *  \deprecated Returned pointer points into cached metatile and is
+     *  invalidated once the metatile is evicted from the metatile cache. Use
+     *  findMetaNode() instead.
      */
+    [[deprecated("use findMetaNode() instead")]]
     const MetaNode* getMetaNode(const TileId &tileId, const std::nothrow_t&)
         const;
 
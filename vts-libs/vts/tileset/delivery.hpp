@@ -37,11 +37,13 @@
 #include "properties.hpp"
 
 #include "driver/streams.hpp"
+#include "driver/blobcache.hpp"
 
 namespace vtslibs { namespace vts {
 
 class Driver;
 namespace tileset { class Index; }
+class Tile2dCache;
 
 class Delivery : boost::noncopyable {
 public:
@@ -107,6 +109,20 @@ public:
      */
     bool async() const { return async_; }
 
+    /** Statistics of process-wide cache of generated 2D tiles (masks and 2D
+     *  metatiles) shared by all deliveries.
+     */
+    static driver::BlobCacheStats tile2dCacheStats();
+
+    /** Sets memory limit (in bytes) of process-wide cache of generated 2D
+     *  tiles (64 MiB by default). Zero disables the cache.
+     */
+    static void tile2dCacheLimit(std::size_t limit);
+
+    /** Returns memory limit of process-wide cache of generated 2D tiles.
+     */
+    static std::size_t tile2dCacheLimit();
+
 private:
     struct AccessToken {};
 
@@ -115,6 +131,10 @@ private:
     std::shared_ptr<tileset::Index> index_;
     bool async_;
 
+    /** Encoded 2D tiles, shared with asynchronous operations.
+     */
+    std::shared_ptr<Tile2dCache> tile2dCache_;
+
 public:
     /** Opens storage.
      */
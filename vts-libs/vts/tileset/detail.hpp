@@ -97,6 +97,13 @@ struct TileNode {
     }
 
     operator bool() const { return metanode; }
+
+    /** Returns metanode pointer that keeps metatile alive.
+     */
+    MetaNode::pointer pin() const {
+        if (!metanode) { return {}; }
+        return MetaNode::pointer(metatile, metanode);
+    }
 };
 
 /** Driver that implements physical aspects of tile set.
@@ -147,7 +154,7 @@ public:
 
     MetaTile::pointer findMetaTile(const TileId &tileId, bool addNew = false) const;
     TileNode findNode(const TileId &tileId, bool addNew = false) const;
-    const MetaNode* findMetaNode(const TileId &tileId) const;
+    MetaNode::pointer findMetaNode(const TileId &tileId) const;
 
     int getMetaTileVersion(const TileId &tileId) const;
 
@@ -160,6 +167,15 @@ public:
     void setTile(const TileId &tileId, const TileSource &tile
                  , const NodeInfo *nodeInfo = nullptr);
 
+    PreparedTile prepareTile(const TileId &tileId, const Tile &tile
+                             , const NodeInfo *nodeInfo = nullptr) const;
+
+    void commitTile(const PreparedTile &tile);
+
+    /** Stores prepared tile, caller must check for writability.
+     */
+    void storeTile(const PreparedTile &tile);
+
     void setNavTile(const TileId &tileId, const NavTile &navtile);
 
     void setSurrogateValue(const TileId &tileId, float value);
@@ -245,7 +261,6 @@ private:
     void updateProperties(Lod lod, const MetaNode &metanode
                           , const MetaNode &oldMetanode);
     void updateProperties(const NodeInfo &nodeInfo);
-    void updateProperties(const Mesh &mesh);
 };
 
 inline void TileSet::Detail::checkValidity() const {
@@ -267,11 +282,11 @@ inline TileId TileSet::Detail::metaId(TileId tileId) const
     return tileId;
 }
 
-inline const MetaNode* TileSet::Detail::findMetaNode(const TileId &tileId)
+inline MetaNode::pointer TileSet::Detail::findMetaNode(const TileId &tileId)
     const
 {
-    // metanode is nullptr if non-existent
-    return findNode(tileId).metanode;
+    // metanode is null if non-existent; keeps metatile alive
+    return findNode(tileId).pin();
 }
 
 } } // namespace vtslibs::vts
@@ -42,6 +42,7 @@
 #include "../options.hpp"
 #include "driver/options.hpp"
 #include "driver/streams.hpp"
+#include "driver/singleflight.hpp"
 #include "tilesetindex.hpp"
 
 namespace vtslibs { namespace vts {
@@ -59,7 +60,12 @@ public:
          */
         bool async;
 
-        Capabilities() : flattener(false), async(false) {}
+        /** Concurrent identical asynchronous input requests are merged into
+         *  single fetch when set.
+         */
+        bool coalesce;
+
+        Capabilities() : flattener(false), async(false), coalesce(false) {}
     };
 
     typedef std::shared_ptr<Driver> pointer;
@@ -127,6 +133,14 @@ public:
      */
     static bool check(const boost::filesystem::path &root);
 
+    /** Paths to configuration files (config, extra config and registry) of
+     *  dataset at given root. Files need not exist.
+     *
+     *  Any change of configuration shows up as a change in these files.
+     */
+    static std::vector<boost::filesystem::path>
+    configFiles(const boost::filesystem::path &root);
+
     static bool check(const boost::filesystem::path &root
                       , const std::string &mime);
 
@@ -183,8 +197,15 @@ public:
      */
     FileStat stat(const std::string &name) const;
 
+    /** Resources held by driver, including metatiles of this driver held in
+     *  shared read-only metatile cache.
+     */
     Resources resources() const;
 
+    /** Statistics of asynchronous input request coalescing.
+     */
+    driver::SingleFlightStats coalescingStats() const;
+
     void flush();
 
     bool externallyChanged() const;
@@ -359,6 +380,10 @@ private:
 
     void notRunning() const;
 
+    void coalescedInput(const TileId &tileId, TileFile type
+                        , const InputCallback &cb
+                        , const IStream::pointer *notFound) const;
+
     /** Backing root.
      */
     const boost::filesystem::path root_;
@@ -416,6 +441,10 @@ private:
     /** Time of last modification (recorded at read-only open)
      */
     std::time_t lastModified_;
+
+    /** Asynchronous input request coalescing.
+     */
+    driver::SingleFlight::pointer singleFlight_;
 };
 
 inline void Driver::watch(utility::Runnable *runnable)
@@ -474,6 +503,9 @@ inline void Driver::input(const TileId &tileId, TileFile type
                           , const IStream::pointer *notFound) const
 {
     checkRunning();
+    if (capabilities_.coalesce) {
+        return coalescedInput(tileId, type, cb, notFound);
+    }
     return input_impl(tileId, type, cb, notFound);
 }
 
@@ -496,9 +528,9 @@ inline void Driver::stat(const TileId &tileId, TileFile type
     return stat_impl(tileId, type, cb);
 }
 
-inline storage::Resources Driver::resources() const
+inline driver::SingleFlightStats Driver::coalescingStats() const
 {
-    return resources_impl();
+    return singleFlight_->stats();
 }
 
 inline void Driver::drop()
@@ -43,6 +43,7 @@
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/range/adaptor/reversed.hpp>
+#include <boost/functional/hash.hpp>
 
 #include "dbglog/dbglog.hpp"
 
@@ -232,13 +233,16 @@ prepareDrivers(Storage &storage, const AggregatedOptions &options)
     return preparedDrivers;
 }
 
-IStream::pointer
-buildMeta(const AggregatedDriver::DriverEntry::list &drivers
-          , const fs::path &root
-          , const registry::ReferenceFrame &referenceFrame
-          , std::time_t lastModified, const TileId &tileId
-          , const TileIndex &tileIndex, bool keepSurfaceReferences
-          , bool noSuchFile = true)
+/** Builds serialized metatile. Returns null pointer if there is no metatile
+ *  and noSuchFile is false.
+ */
+SharedData
+buildMetaData(const AggregatedDriver::DriverEntry::list &drivers
+              , const fs::path &root
+              , const registry::ReferenceFrame &referenceFrame
+              , const TileId &tileId
+              , const TileIndex &tileIndex, bool keepSurfaceReferences
+              , bool noSuchFile = true)
 {
     const auto mbo(referenceFrame.metaBinaryOrder);
     // parent tile at meta-binary-order levels above us
@@ -301,10 +305,23 @@ buildMeta(const AggregatedDriver::DriverEntry::list &drivers
     // TODO: make use value computed by ometa.update above
     ometa.for_each([&](const TileId &nodeId, MetaNode &node)
     {
-        // create nodeinfo for this node
-        // TODO: optimize, still takes too long
-        NodeInfo ni(referenceFrame, nodeId);
-        if (!ni.valid()) { return; }
+        // check node and children validity, quick path first
+        NodeInfo::ChildFlags validChildren(0);
+        const auto valid(NodeInfo::checkValidity
+                         (referenceFrame, nodeId, validChildren));
+        if (!valid) { return; }
+
+        if (indeterminate(valid)) {
+            // cannot be decided quickly, create nodeinfo for this node
+            NodeInfo ni(referenceFrame, nodeId);
+            if (!ni.valid()) { return; }
+
+            for (const auto &child : vts::children(nodeId)) {
+                if (ni.child(child).valid()) {
+                    validChildren |= (1 << child.index);
+                }
+            }
+        }
 
         if (!keepSurfaceReferences) {
             // do not keep surface references -> reset
@@ -316,7 +333,7 @@ buildMeta(const AggregatedDriver::DriverEntry::list &drivers
 
         for (const auto &child : vts::children(nodeId)) {
             bool valid(tileIndex.validSubtree(child)
-                       && ni.child(child).valid());
+                       && (validChildren & (1 << child.index)));
             node.setChildFromId(child, valid);
         }
 
@@ -330,19 +347,91 @@ buildMeta(const AggregatedDriver::DriverEntry::list &drivers
         }
     });
 
-    // create stream and serialize metatile
+    // serialize metatile
+    std::ostringstream os;
+    ometa.save(os);
+    return std::make_shared<const std::string>(os.str());
+}
 
-    // create in-memory stream
-    auto fname(root / str(boost::format("%s.%s") % tileId % TileFile::meta));
-    auto s(std::make_shared<StringIStream>
-           (TileFile::meta, fname.string(), lastModified));
+/** Wraps serialized metatile in an in-memory stream.
+ */
+IStream::pointer metaStream(const fs::path &root, std::time_t lastModified
+                            , const TileId &tileId, const SharedData &data)
+{
+    if (!data) { return {}; }
 
-    // and serialize metatile
-    ometa.save(s->sink());
-    s->updateSize();
+    const auto fname
+        (root / str(boost::format("%s.%s") % tileId % TileFile::meta));
+    return vs::memIStream(TileFile::meta, data, lastModified, fname);
+}
 
-    // done
-    return s;
+IStream::pointer
+buildMeta(const AggregatedDriver::DriverEntry::list &drivers
+          , const fs::path &root
+          , const registry::ReferenceFrame &referenceFrame
+          , std::time_t lastModified, const TileId &tileId
+          , const TileIndex &tileIndex, bool keepSurfaceReferences
+          , bool noSuchFile = true)
+{
+    return metaStream(root, lastModified, tileId
+                      , buildMetaData(drivers, root, referenceFrame, tileId
+                                      , tileIndex, keepSurfaceReferences
+                                      , noSuchFile));
+}
+
+/** Default memory limit of built metatile cache.
+ */
+const std::size_t DefaultMetaCacheLimit(256 * (1 << 20));
+
+/** Built metatile cache key: aggregated tileset root + metatile ID.
+ */
+struct MetaKey {
+    std::string root;
+    TileId tileId;
+
+    MetaKey(const fs::path &root, const TileId &tileId)
+        : root(root.string()), tileId(tileId)
+    {}
+
+    bool operator==(const MetaKey &o) const {
+        return (tileId == o.tileId) && (root == o.root);
+    }
+};
+
+struct MetaKeyHash {
+    std::size_t operator()(const MetaKey &key) const {
+        std::size_t seed(0);
+        boost::hash_combine(seed, key.root);
+        boost::hash_combine(seed, key.tileId.lod);
+        boost::hash_combine(seed, key.tileId.x);
+        boost::hash_combine(seed, key.tileId.y);
+        return seed;
+    }
+};
+
+typedef BlobCache<MetaKey, MetaKeyHash> MetaBlobCache;
+
+/** Built metatiles cache shared by all aggregated drivers in this process.
+ */
+MetaBlobCache& metaBlobCache()
+{
+    static MetaBlobCache cache(DefaultMetaCacheLimit);
+    return cache;
+}
+
+/** Computes generation of built metatiles from aggregated tileset's config
+ *  and modification time of all aggregated tilesets/glues.
+ */
+std::size_t metaGeneration(std::time_t lastModified
+                           , const AggregatedDriver::DriverEntry::list
+                           &drivers)
+{
+    std::size_t seed(0);
+    boost::hash_combine(seed, lastModified);
+    for (const auto &de : drivers) {
+        boost::hash_combine(seed, de.driver->lastModified());
+    }
+    return seed;
 }
 
 inline std::unique_ptr<Cache>
@@ -385,6 +474,7 @@ AggregatedDriver::AggregatedDriver(const boost::filesystem::path &root
 {
     // we flatten the content
     capabilities().flattener = true;
+    capabilities().coalesce = true;
     capabilities().async = isAsync(drivers_);
 
     // build driver information
@@ -410,6 +500,7 @@ AggregatedDriver::AggregatedDriver(const AggregatedOptions &options
 {
     // we flatten the content
     capabilities().flattener = true;
+    capabilities().coalesce = true;
 
     // build driver information and cache it
     memProperties_ = build(options, cloneOptions);
@@ -670,9 +761,12 @@ AggregatedDriver::AggregatedDriver(const boost::filesystem::path &root
 {
     // we flatten the content
     capabilities().flattener = true;
+    capabilities().coalesce = true;
     capabilities().async = isAsync(drivers_);
 
     tileset::loadTileSetIndex(tsi_, *this);
+
+    metaGeneration_ = metaGeneration(configStat().lastModified, drivers_);
 }
 
 /** Clone existing tileset
@@ -691,6 +785,7 @@ AggregatedDriver::AggregatedDriver(PrivateTag
 {
     // we flatten the content
     capabilities().flattener = true;
+    capabilities().coalesce = true;
 
     // clone tile index
     copyFile(src.input(File::tileIndex), output(File::tileIndex));
@@ -822,10 +917,13 @@ IStream::pointer AggregatedDriver::input_impl(const TileId &tileId
             return cache_->input(tileId, type, NullWhenNotFound);
         }
 
-        return driver::buildMeta
-            (drivers_, root(), referenceFrame_
-             , configStat().lastModified, tileId
-             , tsi_.tileIndex, surfaceReferences_, noSuchFile);
+        if (auto is = cachedMeta(tileId)) { return is; }
+
+        const auto data(buildMetaData(drivers_, root(), referenceFrame_
+                                      , tileId, tsi_.tileIndex
+                                      , surfaceReferences_, noSuchFile));
+        cacheMeta(tileId, data);
+        return metaStream(root(), configStat().lastModified, tileId, data);
     }
 
     const auto flags(tsi_.checkAndGetFlags(tileId, type));
@@ -894,6 +992,10 @@ void AggregatedDriver::input_impl(const TileId &tileId, TileFile type
             }, cb);
         }
 
+        if (auto is = cachedMeta(tileId)) {
+            return runCallback([&]() -> IStream::pointer { return is; }, cb);
+        }
+
         return buildMeta(tileId, configStat().lastModified, cb, notFound);
     }
 
@@ -936,10 +1038,7 @@ FileStat AggregatedDriver::stat_impl(const TileId &tileId, TileFile type) const
             return cache_->input(tileId, type)->stat();
         }
 
-        return driver::buildMeta
-            (drivers_, root(), referenceFrame_
-             , configStat().lastModified, tileId
-             , tsi_.tileIndex, surfaceReferences_)->stat();
+        return input_impl(tileId, type, true)->stat();
     }
 
     const auto flags(tsi_.checkAndGetFlags(tileId, type));
@@ -1002,6 +1101,45 @@ std::string AggregatedDriver::info_impl() const
     return os.str();
 }
 
+IStream::pointer AggregatedDriver::cachedMeta(const TileId &tileId) const
+{
+    if (!metaGeneration_) { return {}; }
+
+    return metaStream(root(), configStat().lastModified, tileId
+                      , metaBlobCache().get(MetaKey(root(), tileId)
+                                            , *metaGeneration_));
+}
+
+void AggregatedDriver::cacheMeta(const TileId &tileId
+                                 , const SharedData &data) const
+{
+    if (!metaGeneration_ || !data) { return; }
+    metaBlobCache().put(MetaKey(root(), tileId), *metaGeneration_, data);
+}
+
+AggregatedDriver::MetaSink AggregatedDriver::metaSink(const TileId &tileId)
+    const
+{
+    if (!metaGeneration_) { return {}; }
+
+    const MetaKey key(root(), tileId);
+    const auto generation(*metaGeneration_);
+    return [key, generation](const SharedData &data)
+    {
+        metaBlobCache().put(key, generation, data);
+    };
+}
+
+BlobCacheStats AggregatedDriver::metaCacheStats()
+{
+    return metaBlobCache().stats();
+}
+
+void AggregatedDriver::metaCacheLimit(std::size_t limit)
+{
+    metaBlobCache().limit(limit);
+}
+
 boost::any AggregatedOptions::relocate(const RelocateOptions &options
                                        , const std::string &prefix) const
 {
@@ -1233,9 +1371,12 @@ AggregatedDriver::AggregatedDriver(PrivateTag
 {
     // we flatten the content
     capabilities().flattener = true;
+    capabilities().coalesce = true;
     capabilities().async = isAsync(drivers_);
 
     tileset::loadTileSetIndex(tsi_, *this);
+
+    metaGeneration_ = metaGeneration(configStat().lastModified, drivers_);
 }
 
 void AggregatedDriver::open(const boost::filesystem::path &root
@@ -34,6 +34,7 @@
 #include "../../storage.hpp"
 #include "../../tsmap.hpp"
 #include "cache.hpp"
+#include "blobcache.hpp"
 
 namespace vtslibs { namespace vts { namespace driver {
 
@@ -161,6 +162,20 @@ public:
                      , const AggregatedOptions &options
                      , const Dependencies &dependencies);
 
+    /** Returns statistics of in-memory cache of built metatiles. The cache is
+     *  shared by all aggregated drivers in this process.
+     */
+    static BlobCacheStats metaCacheStats();
+
+    /** Sets memory limit (in bytes) of in-memory cache of built
+     *  metatiles. Zero disables the cache.
+     */
+    static void metaCacheLimit(std::size_t limit);
+
+    /** Built metatile consumer.
+     */
+    typedef std::function<void(const SharedData&)> MetaSink;
+
 private:
 
     virtual OStream::pointer output_impl(const File type);
@@ -253,6 +268,19 @@ private:
                    , const InputCallback &cb, const IStream::pointer *notFound)
         const;
 
+    /** Returns built metatile from in-memory cache (if any).
+     */
+    IStream::pointer cachedMeta(const TileId &tileId) const;
+
+    /** Stores built metatile in in-memory cache.
+     */
+    void cacheMeta(const TileId &tileId, const SharedData &data) const;
+
+    /** Returns function that stores built metatile in in-memory cache. Valid
+     *  only when caching is enabled for this driver.
+     */
+    MetaSink metaSink(const TileId &tileId) const;
+
     Storage storage_;
 
     registry::ReferenceFrame referenceFrame_;
@@ -268,6 +296,11 @@ private:
     /** Metatile cache, valid only when there are any pre-generated tiles.
      */
     mutable std::unique_ptr<Cache> cache_;
+
+    /** Generation of built metatiles (derived from modification time of this
+     *  and all aggregated tilesets). Built metatiles are cached only when set.
+     */
+    boost::optional<std::size_t> metaGeneration_;
 };
 
 inline MetaNode::SourceReference
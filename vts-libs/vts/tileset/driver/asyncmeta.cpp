@@ -26,6 +26,9 @@
 
 #include <mutex>
 #include <atomic>
+#include <sstream>
+
+#include "../../../storage/sstreams.hpp"
 
 #include "aggregated.hpp"
 #include "runcallback.hpp"
@@ -67,10 +70,12 @@ public:
     MetaBuilder(const fs::path &root, const TileId &tileId, int mbo
                 , bool surfaceReferences, std::time_t lastModified
                 , const InputCallback &cb, const IStream::pointer *notFound
-                , const TileIndex &tileIndex)
+                , const TileIndex &tileIndex
+                , const AggregatedDriver::MetaSink &sink)
         : root_(root), tileId_(tileId), mbo_(mbo)
         , surfaceReferences_(surfaceReferences)
         , lastModified_(lastModified), cb_(cb), callersNotFound_(notFound)
+        , sink_(sink)
 
         , parentId_(parent(tileId_, mbo_))
         , shrinkedId_(tileId_.lod, parentId_.x, parentId_.y)
@@ -246,18 +251,18 @@ private:
     }
 
     IStream::pointer serialize() const {
-        // create in-memory stream
-        auto fname(root_ / str(boost::format("%s.%s")
-                                % tileId_ % TileFile::meta));
-        auto s(std::make_shared<StringIStream>
-               (TileFile::meta, fname.string(), lastModified_));
+        // serialize metatile
+        std::ostringstream os;
+        meta_.save(os);
+        const auto data(std::make_shared<const std::string>(os.str()));
 
-        // and serialize metatile
-        meta_.save(s->sink());
-        s->updateSize();
+        // remember in the cache
+        if (sink_) { sink_(data); }
 
-        // done
-        return s;
+        // and create in-memory stream
+        auto fname(root_ / str(boost::format("%s.%s")
+                                % tileId_ % TileFile::meta));
+        return vs::memIStream(TileFile::meta, data, lastModified_, fname);
     }
 
     const fs::path root_;
@@ -267,6 +272,7 @@ private:
     const std::time_t lastModified_;
     const InputCallback cb_;
     const IStream::pointer *callersNotFound_;
+    const AggregatedDriver::MetaSink sink_;
 
     const TileId parentId_;
     const TileId shrinkedId_;
@@ -299,7 +305,7 @@ void AggregatedDriver::buildMeta(const TileId &tileId, std::time_t lastModified
         auto mb(std::make_shared<MetaBuilder>
                 (root(), tileId, referenceFrame_.metaBinaryOrder
                  , surfaceReferences_, lastModified, cb, notFound
-                 , tsi_.tileIndex));
+                 , tsi_.tileIndex, metaSink(tileId)));
 
         mb->run(drivers_);
     } catch (...) {
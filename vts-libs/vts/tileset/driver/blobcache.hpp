@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/tileset/driver/blobcache.hpp
+ *
+ * Bounded in-memory cache of serialized files.
+ */
+
+#ifndef vtslibs_vts_tileset_driver_blobcache_hpp_included_
+#define vtslibs_vts_tileset_driver_blobcache_hpp_included_
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/noncopyable.hpp>
+
+#include "../../../storage/sstreams.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+using storage::SharedData;
+
+/** Blob cache statistics.
+ */
+struct BlobCacheStats {
+    /** Number of successful lookups.
+     */
+    std::size_t hits;
+
+    /** Number of failed lookups (including stale entries).
+     */
+    std::size_t misses;
+
+    /** Number of entries dropped due to memory limit.
+     */
+    std::size_t evictions;
+
+    /** Number of entries dropped due to generation mismatch.
+     */
+    std::size_t invalidations;
+
+    /** Number of cached entries.
+     */
+    std::size_t count;
+
+    /** Memory occupied by cached data (in bytes).
+     */
+    std::size_t size;
+
+    /** Memory limit (in bytes).
+     */
+    std::size_t limit;
+
+    BlobCacheStats()
+        : hits(), misses(), evictions(), invalidations()
+        , count(), size(), limit()
+    {}
+};
+
+/** Bounded cache of serialized files (blobs) with LRU eviction.
+ *
+ *  Each entry is tagged by a generation stamp. Lookup with different
+ *  generation than the one stored in the entry drops the entry (i.e. data
+ *  are invalidated once source changes).
+ *
+ *  Zero limit disables the cache. Thread safe.
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class BlobCache : boost::noncopyable {
+public:
+    typedef std::size_t Generation;
+
+    BlobCache(std::size_t limit) : limit_(limit), size_() {}
+
+    /** Returns cached blob or null pointer if not found.
+     */
+    SharedData get(const Key &key, Generation generation);
+
+    /** Stores blob in the cache. Least recently used entries are evicted
+     *  to keep the cache within its limit.
+     */
+    void put(const Key &key, Generation generation, const SharedData &data);
+
+    /** Sets new limit. Evicts entries if needed.
+     */
+    void limit(std::size_t limit);
+
+    std::size_t limit() const;
+
+    BlobCacheStats stats() const;
+
+    void clear();
+
+private:
+    struct Entry {
+        Key key;
+        Generation generation;
+        SharedData data;
+
+        Entry(const Key &key, Generation generation, const SharedData &data)
+            : key(key), generation(generation), data(data)
+        {}
+    };
+
+    typedef std::list<Entry> Lru;
+    typedef std::unordered_map<Key, typename Lru::iterator, Hash> Index;
+
+    /** Approximate memory occupied by an entry.
+     */
+    static std::size_t cost(const SharedData &data) {
+        return data->size() + sizeof(Entry) + sizeof(Key) + 32;
+    }
+
+    void drop(typename Index::iterator iindex);
+
+    void shrink();
+
+    mutable std::mutex mutex_;
+    std::size_t limit_;
+    std::size_t size_;
+    Lru lru_;
+    Index index_;
+    BlobCacheStats stats_;
+};
+
+// inlines
+
+template <typename Key, typename Hash>
+SharedData BlobCache<Key, Hash>::get(const Key &key, Generation generation)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto findex(index_.find(key));
+    if (findex == index_.end()) {
+        ++stats_.misses;
+        return {};
+    }
+
+    if (findex->second->generation != generation) {
+        // stale entry
+        drop(findex);
+        ++stats_.invalidations;
+        ++stats_.misses;
+        return {};
+    }
+
+    // move to the front
+    lru_.splice(lru_.begin(), lru_, findex->second);
+    ++stats_.hits;
+    return findex->second->data;
+}
+
+template <typename Key, typename Hash>
+void BlobCache<Key, Hash>::put(const Key &key, Generation generation
+                               , const SharedData &data)
+{
+    if (!data) { return; }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // too big or disabled cache
+    if (cost(data) > limit_) { return; }
+
+    auto findex(index_.find(key));
+    if (findex != index_.end()) { drop(findex); }
+
+    lru_.emplace_front(key, generation, data);
+    index_.emplace(key, lru_.begin());
+    size_ += cost(data);
+
+    shrink();
+}
+
+template <typename Key, typename Hash>
+void BlobCache<Key, Hash>::drop(typename Index::iterator iindex)
+{
+    size_ -= cost(iindex->second->data);
+    lru_.erase(iindex->second);
+    index_.erase(iindex);
+}
+
+template <typename Key, typename Hash>
+void BlobCache<Key, Hash>::shrink()
+{
+    while ((size_ > limit_) && !lru_.empty()) {
+        drop(index_.find(lru_.back().key));
+        ++stats_.evictions;
+    }
+}
+
+template <typename Key, typename Hash>
+void BlobCache<Key, Hash>::limit(std::size_t limit)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    limit_ = limit;
+    shrink();
+}
+
+template <typename Key, typename Hash>
+std::size_t BlobCache<Key, Hash>::limit() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_;
+}
+
+template <typename Key, typename Hash>
+BlobCacheStats BlobCache<Key, Hash>::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto stats(stats_);
+    stats.count = index_.size();
+    stats.size = size_;
+    stats.limit = limit_;
+    return stats;
+}
+
+template <typename Key, typename Hash>
+void BlobCache<Key, Hash>::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    index_.clear();
+    lru_.clear();
+    size_ = 0;
+}
+
+} } } // namespace vtslibs::vts::driver
+
+#endif // vtslibs_vts_tileset_driver_blobcache_hpp_included_
@@ -24,21 +24,18 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <mutex>
+#include <list>
+#include <array>
+#include <atomic>
+#include <unordered_map>
 
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 #include <boost/crc.hpp>
-
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/mem_fun.hpp>
+#include <boost/functional/hash.hpp>
 
 #include "dbglog/dbglog.hpp"
 
-#include "utility/time.hpp"
-
 #include "../../../storage/openfiles.hpp"
 #include "../../io.hpp"
 #include "cache.hpp"
@@ -78,40 +75,79 @@ int fileType(TileFile type) {
     throw;
 }
 
-typedef decltype(utility::usecFromEpoch()) Time;
-const Time MaxTime(std::numeric_limits<Time>::max());
+/** Hashes tile ID.
+ */
+struct TileIdHash {
+    std::size_t operator()(const TileId &tileId) const {
+        std::size_t seed(0);
+        boost::hash_combine(seed, tileId.lod);
+        boost::hash_combine(seed, tileId.x);
+        boost::hash_combine(seed, tileId.y);
+        return seed;
+    }
+};
+
+/** Number of archive table shards. Must be a power of 2.
+ */
+const std::size_t ShardCount(16);
+
+/** Maximum number of files dropped in one housekeeping run.
+ */
+const int MaxDropCount(5);
 
 } // namespace
 
+/** Open archives table.
+ *
+ *  Archives are spread over independently locked shards. Eviction uses CLOCK
+ *  (second chance) algorithm: hit only sets record's reference bit, clock
+ *  hand clears reference bits and drops first unreferenced record.
+ */
 struct Cache::Archives
 {
     struct Record {
+        typedef std::list<Record> list;
+
         Record(TileId index, Tilar &&tilar)
-            : index(index), lastHit(utility::usecFromEpoch())
-            , tilar_(std::move(tilar))
+            : index(index), referenced(true), detached(false)
+            , tilar(std::move(tilar))
         {}
 
-        Tilar& tilar() const { return tilar_; }
+        void hit() { referenced = true; detached = false; }
+
+        TileId index;
+
+        /** Reference bit, cleared by passing clock hand.
+         */
+        bool referenced;
 
-        void hit() { lastHit = utility::usecFromEpoch(); }
+        /** File was asked to detach. Skipped by clock hand until next hit.
+         */
+        bool detached;
 
-        void infinity() { lastHit = MaxTime; }
+        Tilar tilar;
+    };
 
-        bool isInInfinity() const { return lastHit == MaxTime; }
+    struct Shard {
+        Shard() : hand(ring.end()) {}
 
-        TileId index;
-        Time lastHit;
+        Record::list ring;
+        Record::list::iterator hand;
+        std::unordered_map<TileId, Record::list::iterator, TileIdHash> map;
 
-    private:
-        mutable Tilar tilar_;
+        mutable std::mutex mutex;
     };
 
     Archives(const fs::path &root, const std::string &extension
-             , bool readOnly, int filesPerTile
+             , bool readOnly, bool mapped, int filesPerTile
              , const PlainOptions &options
              , const Tilar::ContentTypes &contentTypes);
 
-    Tilar open(const TileId &archive, bool noSuchFile = true);
+    /** Opens archive. Writable archive is created only when create is set,
+     *  read access to non-existent archive is handled per noSuchFile.
+     */
+    Tilar open(const TileId &archive, bool noSuchFile = true
+               , bool create = false);
 
     fs::path filePath(const TileId &index) const;
 
@@ -120,66 +156,59 @@ struct Cache::Archives
     }
 
     std::size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex_);
-        return map_.size();
+        std::size_t size(0);
+        for (const auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            size += shard.map.size();
+        }
+        return size;
     }
 
 private:
     void houseKeeping(const TileId *keep = nullptr);
 
-    template <typename Idx, typename Iterator>
-    inline void hit(Idx &idx, Iterator iterator) {
-        idx.modify(iterator, [](Record &r) { r.hit(); });
-    }
+    /** Runs clock hand in given shard until toDrop files are dropped or two
+     *  full rounds are made.
+     */
+    bool sweep(Shard &shard, const TileId *keep, int &toDrop);
 
-    template <typename Idx, typename Iterator>
-    inline void infinity(Idx &idx, Iterator iterator) {
-        idx.modify(iterator, [](Record &r) { r.infinity(); });
+    Shard& shard(const TileId &archive) {
+        return shards_[TileIdHash()(archive) & (ShardCount - 1)];
     }
 
     template <typename Op>
     void finish(Op op) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        for (auto iidx(map_.begin()); iidx != map_.end(); ) {
-            op(iidx->tilar());
-            iidx = map_.erase(iidx);
+        for (auto &shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto &record : shard.ring) { op(record.tilar); }
+            shard.map.clear();
+            shard.ring.clear();
+            shard.hand = shard.ring.end();
         }
     }
 
-    struct IndexIdx {};
-    struct LastHitIdx {};
-
-    typedef boost::multi_index_container<
-        Record
-        , boost::multi_index::indexed_by<
-              boost::multi_index::ordered_unique
-              <boost::multi_index::tag<IndexIdx>
-               , BOOST_MULTI_INDEX_MEMBER
-               (Record, decltype(Record::index), index)>
-              , boost::multi_index::ordered_non_unique
-              <boost::multi_index::tag<LastHitIdx>
-               , BOOST_MULTI_INDEX_MEMBER
-               (Record, decltype(Record::lastHit), lastHit)>
-              >
-        > Map;
-
     const fs::path root_;
     const std::string extension_;
     const Tilar::Options options_;
     const bool readOnly_;
-    Map map_;
+    const bool mapped_;
     const Tilar::ContentTypes &contentTypes_;
 
-    mutable std::mutex mutex_;
+    std::array<Shard, ShardCount> shards_;
+
+    /** Shard where next housekeeping starts.
+     */
+    std::atomic<std::size_t> clock_;
 };
 
 Cache::Archives::Archives(const fs::path &root, const std::string &extension
-                          , bool readOnly, int filesPerTile
+                          , bool readOnly, bool mapped, int filesPerTile
                           , const PlainOptions &options
                           , const Tilar::ContentTypes &contentTypes)
     : root_(root), extension_(extension)
     , options_(options.tilar(filesPerTile))
-    , readOnly_(readOnly), contentTypes_(contentTypes)
+    , readOnly_(readOnly), mapped_(readOnly && mapped)
+    , contentTypes_(contentTypes), clock_(0)
 {}
 
 fs::path Cache::Archives::filePath(const TileId &index) const
@@ -196,30 +225,29 @@ fs::path Cache::Archives::filePath(const TileId &index) const
 }
 
 Cache::Cache(const fs::path &root, const PlainOptions &options
-             , bool readOnly)
+             , bool readOnly, bool mapped)
     : root_(root), options_(options), readOnly_(readOnly)
-    , tiles_(new Archives(root, "tiles", readOnly, 2, options
+    , tiles_(new Archives(root, "tiles", readOnly, mapped, 2, options
                           , tileContentTypes))
-    , metatiles_(new Archives(root, "metatiles", readOnly, 1, options
-                              , metatileContentTypes))
-    , navtiles_(new Archives(root, "navtiles", readOnly, 1, options
-                             , navtileContentTypes))
+    , metatiles_(new Archives(root, "metatiles", readOnly, mapped, 1
+                              , options, metatileContentTypes))
+    , navtiles_(new Archives(root, "navtiles", readOnly, mapped, 1
+                             , options, navtileContentTypes))
 {}
 
 namespace {
 
 Tilar tilar(const fs::path &path, const Tilar::Options &options
-            , bool readOnly, bool noSuchFile = true)
+            , bool readOnly, bool mapped, bool noSuchFile = true)
 {
     if (readOnly) {
         // read-only
+        const auto openMode(mapped ? Tilar::OpenMode::readOnlyMapped
+                            : Tilar::OpenMode::readOnly);
         if (noSuchFile) {
-            return Tilar::open(path, options
-                               , Tilar::OpenMode::readOnly);
+            return Tilar::open(path, options, openMode);
         } else {
-            return Tilar::open(path, options
-                               , NullWhenNotFound
-                               , Tilar::OpenMode::readOnly);
+            return Tilar::open(path, options, NullWhenNotFound, openMode);
         }
     }
     return Tilar::create(path, options
@@ -234,101 +262,173 @@ void Cache::Archives::houseKeeping(const TileId *keep)
 {
     if (!storage::OpenFiles::critical()) { return; }
 
-    auto &idx(map_.get<LastHitIdx>());
-
     LOG(info1)
         << "Critical number of open files reached (current count is "
         << storage::OpenFiles::count() << ") trying to drop some of "
-        << idx.size() << " files owned by this driver.";
+        << size() << " files owned by this driver.";
+
+    int toDrop(MaxDropCount);
+    const auto start(clock_++);
+    for (std::size_t i(0); toDrop && (i < ShardCount); ++i) {
+        if (!sweep(shards_[(start + i) & (ShardCount - 1)], keep, toDrop)) {
+            return;
+        }
+    }
+}
+
+bool Cache::Archives::sweep(Shard &shard, const TileId *keep, int &toDrop)
+{
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto &ring(shard.ring);
+    auto &hand(shard.hand);
+
+    for (auto steps(2 * ring.size()); toDrop && steps && !ring.empty();
+         --steps)
+    {
+        if (hand == ring.end()) { hand = ring.begin(); }
+        auto &record(*hand);
 
-    int toDrop(5);
-    for (auto iidx(idx.begin()); toDrop && (iidx != idx.end()); ) {
         // skip keep file
-        if (keep && (iidx->index == *keep)) {
-            LOG(debug) << "File " << iidx->tilar().path()
+        if (keep && (record.index == *keep)) {
+            LOG(debug) << "File " << record.tilar.path()
                        << " must be kept in the cache.";
-            ++iidx;
+            ++hand;
             continue;
         }
 
-        // files in infinity -> this and all its friends are detached
-        if (iidx->isInInfinity()) { return; }
+        // files asked to detach are skipped until hit again
+        if (record.detached) { ++hand; continue; }
 
-        auto &file(iidx->tilar());
+        // second chance
+        if (record.referenced) {
+            record.referenced = false;
+            ++hand;
+            continue;
+        }
+
+        auto &file(record.tilar);
 
         switch (file.state()) {
         case Tilar::State::detached:
             // NB: this should be never seen
             LOG(debug)
-                << "File " << file.path() << '/' << iidx->lastHit
+                << "File " << file.path()
                 << " is already detached. In fact, this log line "
                 << "should not be seen in the log at all.";
-            return;
+            return false;
 
         case Tilar::State::detaching:
             // NB: this should be never seen
             LOG(debug)
-                << "File " << file.path() << '/' << iidx->lastHit
+                << "File " << file.path()
                 << " is being detached. In fact, this log line "
                 << "should not be seen in the log at all.";
-            return;
+            return false;
 
         case Tilar::State::pristine:
             // no changes -> we are free to remove the file
             LOG(debug) << "Removing pristine tilar file "
-                       << file.path() << '/' << iidx->lastHit
-                       << " from the cache.";
+                       << file.path() << " from the cache.";
 
-            iidx = idx.erase(iidx);
+            shard.map.erase(record.index);
+            hand = ring.erase(hand);
             --toDrop;
             break;
 
         case Tilar::State::changed:
             // file is changed -> ask to detach
             LOG(debug)
-                << "Asking to detach changed file "
-                << file.path() << '/' << iidx->lastHit << ".";
+                << "Asking to detach changed file " << file.path() << ".";
 
-            // ask for file detachment
+            // ask for file detachment; clock hand will skip this file until
+            // it is hit again
             file.detach();
-
-            // hit -> move to the future, next time this is function is called
-            // we will not encounter this detached file again
-            {
-                auto old(iidx);
-                ++iidx;
-                infinity(idx, old);
-            }
+            record.detached = true;
+            ++hand;
 
             // mark one more dropped file
             --toDrop;
             break;
         }
     }
+
+    return true;
 }
 
-Tilar Cache::Archives::open(const TileId &archive, bool noSuchFile)
+Tilar Cache::Archives::open(const TileId &archive, bool noSuchFile
+                            , bool create)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    auto fmap(map_.find(archive));
-    if (fmap != map_.end()) {
-        hit(map_, fmap);
-        // housekeeping, we want to keep found file
-        houseKeeping(&fmap->index);
-        return fmap->tilar();
+    auto &shard(this->shard(archive));
+
+    {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        auto fmap(shard.map.find(archive));
+        if (fmap != shard.map.end()) {
+            auto &record(*fmap->second);
+            record.hit();
+            auto file(record.tilar);
+            lock.unlock();
+
+            // housekeeping, we want to keep found file
+            houseKeeping(&archive);
+            return file;
+        }
     }
 
     // housekeeping before open
     houseKeeping();
 
     const auto path(filePath(archive));
-    auto file(tilar(path, options_, readOnly_, noSuchFile));
+
+    // must be called under shard lock
+    auto insert([&](Tilar &&file) -> Tilar
+    {
+        // someone could be faster
+        auto fmap(shard.map.find(archive));
+        if (fmap != shard.map.end()) {
+            fmap->second->hit();
+            return fmap->second->tilar;
+        }
+
+        // insert just before clock hand -> visited last
+        auto irecord(shard.ring.emplace
+                     (shard.hand, Record(archive, std::move(file))));
+        shard.map.emplace(archive, irecord);
+        return irecord->tilar;
+    });
+
+    if (!readOnly_) {
+        // writable files must be opened only once -> open under lock
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto fmap(shard.map.find(archive));
+        if (fmap != shard.map.end()) {
+            fmap->second->hit();
+            return fmap->second->tilar;
+        }
+
+        if (!create && !fs::exists(path)) {
+            // do not create empty archive just to find nothing inside
+            if (noSuchFile) {
+                LOGTHROW(err1, storage::NoSuchFile)
+                    << "Tilar file " << path << " not found.";
+            }
+            return {};
+        }
+
+        auto file(tilar(path, options_, readOnly_, mapped_, noSuchFile));
+        if (!file) { return file; }
+        file.setContentTypes(contentTypes_);
+        return insert(std::move(file));
+    }
+
+    // read-only files are opened outside of lock
+    auto file(tilar(path, options_, readOnly_, mapped_, noSuchFile));
     if (!file) { return file; }
     file.setContentTypes(contentTypes_);
 
-    return map_.insert
-        (Record(archive, std::move(file))).first->tilar();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return insert(std::move(file));
 }
 
 IStream::pointer Cache::input(const TileId tileId, TileFile type)
@@ -349,7 +449,8 @@ IStream::pointer Cache::input(const TileId tileId, TileFile type
 OStream::pointer Cache::output(const TileId tileId, TileFile type)
 {
     const auto index(options_.index(tileId, type, fileType(type)));
-    return getArchives(type).open(index.archive).output(index.file);
+    return getArchives(type).open(index.archive, true, true)
+        .output(index.file);
 }
 
 std::size_t Cache::size(const TileId tileId, TileFile type)
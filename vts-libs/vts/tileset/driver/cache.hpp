@@ -60,8 +60,15 @@ namespace fs = boost::filesystem;
 
 class Cache : boost::noncopyable {
 public:
+    /** Creates archive cache.
+     *
+     *  \param root tileset root
+     *  \param options plain driver options
+     *  \param readOnly open archives in read-only mode
+     *  \param mapped map read-only archives into memory
+     */
     Cache(const fs::path &root, const PlainOptions &options
-          , bool readOnly);
+          , bool readOnly, bool mapped = false);
 
     ~Cache();
 
@@ -26,9 +26,12 @@
 #include <set>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <atomic>
 
 #include <boost/noncopyable.hpp>
 #include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
 
 #include "utility/runnable.hpp"
 
@@ -57,6 +60,122 @@ namespace vs = vtslibs::storage;
 
 namespace {
 
+/** Default memory budget of process-wide 2D tile cache: 64 MiB
+ */
+const std::size_t DefaultTile2dCacheLimit(1ul << 26);
+
+} // namespace
+
+/** Cache of encoded 2D tiles (masks and 2D metatiles) generated by delivery.
+ *
+ *  Every delivery has its own handle but all handles share one process-wide
+ *  store and its memory budget. Entries are keyed by owning handle, tile ID,
+ *  file type and flavor and tagged by modification time of their source;
+ *  tiles with unknown modification time are never cached. Entries of closed
+ *  deliveries are left to LRU eviction.
+ */
+class Tile2dCache {
+public:
+    typedef std::shared_ptr<Tile2dCache> pointer;
+
+    Tile2dCache(const OpenOptions &openOptions)
+        : compression_(openOptions.pngCompression())
+        , owner_(++lastOwner())
+        , cache_(store())
+    {}
+
+    /** Returns encoded PNG image. On cache miss the image is generated by
+     *  given generator, encoded and stored in the cache.
+     */
+    template <typename Generator>
+    vs::SharedData png(const TileId &tileId, TileFile type, FileFlavor flavor
+                       , std::time_t lastModified
+                       , const Generator &generator);
+
+    /** Process-wide store limit.
+     */
+    static void limit(std::size_t limit) { store().limit(limit); }
+    static std::size_t limit() { return store().limit(); }
+
+    /** Process-wide store statistics.
+     */
+    static driver::BlobCacheStats stats() { return store().stats(); }
+
+private:
+    struct Key {
+        std::uint64_t owner;
+        TileId tileId;
+        TileFile type;
+        FileFlavor flavor;
+
+        Key(std::uint64_t owner, const TileId &tileId, TileFile type
+            , FileFlavor flavor)
+            : owner(owner), tileId(tileId), type(type), flavor(flavor)
+        {}
+
+        bool operator==(const Key &o) const {
+            return ((owner == o.owner) && (tileId == o.tileId)
+                    && (type == o.type) && (flavor == o.flavor));
+        }
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const {
+            std::size_t seed(0);
+            boost::hash_combine(seed, key.owner);
+            boost::hash_combine(seed, key.tileId.lod);
+            boost::hash_combine(seed, key.tileId.x);
+            boost::hash_combine(seed, key.tileId.y);
+            boost::hash_combine(seed, int(key.type));
+            boost::hash_combine(seed, int(key.flavor));
+            return seed;
+        }
+    };
+
+    typedef driver::BlobCache<Key, KeyHash> Store;
+
+    static Store& store() {
+        static Store store(DefaultTile2dCacheLimit);
+        return store;
+    }
+
+    static std::atomic<std::uint64_t>& lastOwner() {
+        static std::atomic<std::uint64_t> owner(0);
+        return owner;
+    }
+
+    /** PNG compression level.
+     */
+    const int compression_;
+
+    /** Owner ID, unique inside the process.
+     */
+    const std::uint64_t owner_;
+
+    Store &cache_;
+};
+
+template <typename Generator>
+vs::SharedData Tile2dCache::png(const TileId &tileId, TileFile type
+                                , FileFlavor flavor, std::time_t lastModified
+                                , const Generator &generator)
+{
+    const Key key(owner_, tileId, type, flavor);
+    const bool cacheable(lastModified > 0);
+
+    if (cacheable) {
+        if (auto data = cache_.get(key, lastModified)) { return data; }
+    }
+
+    const auto png(imgproc::png::serialize(generator(), compression_));
+    auto data(std::make_shared<const std::string>(png.begin(), png.end()));
+
+    if (cacheable) { cache_.put(key, lastModified, data); }
+    return data;
+}
+
+namespace {
+
 std::shared_ptr<tileset::Index>
 indexFromDriver(const FullTileSetProperties &properties
                 , const Driver::pointer &driver)
@@ -80,7 +199,7 @@ std::string filename(const fs::path &root, const TileId &tileId, TileFile type)
     return (root / str(boost::format("%s.%s") % tileId % type)).string();
 }
 
-IStream::pointer meta2d(const Driver &driver
+IStream::pointer meta2d(const Driver &driver, Tile2dCache &cache
                         , const tileset::Index &index
                         , const TileId &tileId
                         , bool noSuchFile)
@@ -93,20 +212,27 @@ IStream::pointer meta2d(const Driver &driver
         return {};
     }
 
-    // generate mask image from tileindex, serialize it as a png and wrap in
-    // input stream
-    return vs::memIStream(TileFile::mask
-                          , imgproc::png::serialize
-                          (meta2d(index.tileIndex, tileId), 9)
-                          , driver.lastModified()
+    // generate mask image from tileindex, serialize it as a png (unless
+    // cached) and wrap in input stream
+    const auto lastModified(driver.lastModified());
+    const auto png(cache.png(tileId, TileFile::meta2d, FileFlavor::regular
+                             , lastModified, [&]()
+    {
+        return meta2d(index.tileIndex, tileId);
+    }));
+
+    return vs::memIStream(TileFile::mask, png, lastModified
                           , filename(driver.root(), tileId, TileFile::meta2d));
 }
 
-void meta2d(const Driver &driver, const tileset::Index &index
+void meta2d(const Driver &driver, Tile2dCache &cache
+            , const tileset::Index &index
             , const TileId &tileId, const InputCallback &cb)
 {
     // no driver access, can be called immediately
-    runCallback([&]() { return meta2d(driver, index, tileId, true); }, cb);
+    runCallback([&]() {
+        return meta2d(driver, cache, index, tileId, true);
+    }, cb);
 }
 
 namespace constants {
@@ -117,6 +243,7 @@ const auto EmptyMask = imgproc::png::serialize(emptyDebugMask(), 9);
 
 IStream::pointer maskStream(const IStream::pointer &is
                             , const Driver::pointer &pdriver
+                            , Tile2dCache &cache
                             , const TileId &tileId, bool debug)
 {
     const auto &driver(*pdriver);
@@ -134,32 +261,36 @@ IStream::pointer maskStream(const IStream::pointer &is
     }
 
     // generate mask image from mask, serialize it as a png and wrap in input
-    // stream
-
-    const auto meshMask(loadMeshMask(is));
-    const auto png(debug
-                   ? imgproc::png::serialize
-                   (debugMask(meshMask, driver.capabilities().flattener), 9)
-                   : imgproc::png::serialize
-                   (mask2d(meshMask, driver.capabilities().flattener), 9));
-    return vs::memIStream(TileFile::mask
-                          , png, is->stat().lastModified
+    // stream; mesh is loaded only when there is no cached mask generated from
+    // the same mesh
+    const auto lastModified(is->stat().lastModified);
+    const auto flattener(driver.capabilities().flattener);
+
+    const auto png
+        (debug
+         ? cache.png(tileId, TileFile::mask, FileFlavor::debug, lastModified
+                     , [&]() { return debugMask(loadMeshMask(is), flattener); })
+         : cache.png(tileId, TileFile::mask, FileFlavor::regular, lastModified
+                     , [&]() { return mask2d(loadMeshMask(is), flattener); }));
+
+    return vs::memIStream(TileFile::mask, png, lastModified
                           , filename(driver.root(), tileId, TileFile::mask));
 }
 
-IStream::pointer mask(const Driver::pointer &driver, const TileId &tileId
-                      , FileFlavor flavor, bool noSuchFile)
+IStream::pointer mask(const Driver::pointer &driver, Tile2dCache &cache
+                      , const TileId &tileId, FileFlavor flavor
+                      , bool noSuchFile)
 {
     const auto debug(flavor == FileFlavor::debug);
 
     return maskStream((noSuchFile && !debug)
                       ? driver->input(tileId, TileFile::mesh)
                       : driver->input(tileId, TileFile::mesh, NullWhenNotFound)
-                      , driver, tileId, debug);
+                      , driver, cache, tileId, debug);
 }
 
-void mask(const Driver::pointer &driver, const TileId &tileId
-          , FileFlavor flavor, const InputCallback &cb)
+void mask(const Driver::pointer &driver, const Tile2dCache::pointer &cache
+          , const TileId &tileId, FileFlavor flavor, const InputCallback &cb)
 {
     const auto debug(flavor == FileFlavor::debug);
 
@@ -168,7 +299,7 @@ void mask(const Driver::pointer &driver, const TileId &tileId
     {
         if (const auto &is = eis.get(cb, utility::ExpectedAsSink{})) {
             runCallback([&]() {
-                return maskStream(is, driver, tileId, debug);
+                return maskStream(is, driver, *cache, tileId, debug);
             }, cb);
         }
     });
@@ -215,18 +346,10 @@ void meta(const Driver &driver, const tileset::Index &index
                       , filename(driver.root(), tileId, TileFile::meta)));
 }
 
-/** TODO: make asynchronous version that launches metatile fetch for all
- *  metatiles needed and collects info in callback.
- *
- *  Since 2D interface was never used... do we need it?
+/** Collects IDs of all existing metatiles covered by given credit tile.
  */
-bool creditsFromMetatiles(const Driver &driver
-                          , const tileset::Index &index
-                          , const TileId &creditsId
-                          , bool noSuchFile
-                          , registry::IdSet &credits
-                          , std::size_t maxCount
-                          , std::time_t &lastModified)
+std::vector<TileId> creditsMetaIds(const tileset::Index &index
+                                   , const TileId &creditsId)
 {
     auto metaOrder(index.metaBinaryOrder());
     if (CreditTile::binaryOrder < metaOrder) {
@@ -235,6 +358,8 @@ bool creditsFromMetatiles(const Driver &driver
             "3D metatiles";
     }
 
+    std::vector<TileId> metaIds;
+
     int depthDiff(CreditTile::binaryOrder - metaOrder);
     int count(1 << depthDiff);
     int skip(1 << metaOrder);
@@ -242,25 +367,66 @@ bool creditsFromMetatiles(const Driver &driver
         int row(creditsId.y + j * skip);
         for (int i(0); i < count; ++i) {
             TileId metaId(creditsId.lod, creditsId.x + i * skip, row);
-            if (!index.meta(metaId)) { continue; }
+            if (index.meta(metaId)) { metaIds.push_back(metaId); }
+        }
+    }
 
-            auto is(noSuchFile
-                    ? driver.input(metaId, TileFile::meta)
-                    : driver.input(metaId, TileFile::meta, NullWhenNotFound));
-            if (!is) { return false; }
-            loadCreditsFromMetaTile(is->get(), credits, is->name());
+    return metaIds;
+}
 
-            // update last modified
-            auto lm(is->stat().lastModified);
-            if (lm > lastModified) { lastModified = lm; }
-            is->close();
+bool creditsFromMetatiles(const Driver &driver
+                          , const tileset::Index &index
+                          , const TileId &creditsId
+                          , bool noSuchFile
+                          , registry::IdSet &credits
+                          , std::size_t maxCount
+                          , std::time_t &lastModified)
+{
+    for (const auto &metaId : creditsMetaIds(index, creditsId)) {
+        auto is(noSuchFile
+                ? driver.input(metaId, TileFile::meta)
+                : driver.input(metaId, TileFile::meta, NullWhenNotFound));
+        if (!is) { return false; }
+        loadCreditsFromMetaTile(is->get(), credits, is->name());
+
+        // update last modified
+        auto lm(is->stat().lastModified);
+        if (lm > lastModified) { lastModified = lm; }
+        is->close();
+
+        // all credits seen
+        if (credits.size() >= maxCount) { return true; }
+    }
 
-            // all credits seen
-            if (credits.size() >= maxCount) { return true; }
+    return true;
+}
+
+/** Builds and serializes credit tile from collected credits.
+ */
+IStream::pointer creditTile(const Driver &driver, const TileId &tileId
+                            , const registry::IdSet &credits
+                            , std::time_t lastModified)
+{
+    CreditTile tile;
+    for (const auto &cid : credits) {
+        if (const auto *credit = registry::system.credits
+            (cid, std::nothrow))
+        {
+            tile.credits.set(credit->id, boost::none);
         }
     }
 
-    return true;
+    auto s(std::make_shared<StringIStream>
+           (TileFile::credits
+            , filename(driver.root(), tileId, TileFile::credits)
+            , lastModified));
+
+    // serialize credit tile
+    saveCreditTile(s->sink(), tile, false);
+    s->updateSize();
+
+    // done
+    return s;
 }
 
 IStream::pointer credits(const Driver &driver
@@ -277,50 +443,179 @@ IStream::pointer credits(const Driver &driver
         return {};
     }
 
-    CreditTile tile;
+    if (properties.credits.size() <= 1) {
+        return creditTile(driver, tileId, properties.credits, -1);
+    }
 
+    registry::IdSet credits;
     std::time_t lastModified(-1);
-
-    auto extract([&](const registry::IdSet &credits)
+    if (!creditsFromMetatiles(driver, index, CreditTile::creditsId(tileId)
+                              , noSuchFile, credits
+                              , properties.credits.size()
+                              , lastModified))
     {
-        for (const auto &cid : credits) {
-            if (const auto *credit = registry::system.credits
-                (cid, std::nothrow))
+        return {};
+    }
+
+    if (lastModified <= 0) {
+        lastModified = driver.lastModified();
+    }
+
+    return creditTile(driver, tileId, credits, lastModified);
+}
+
+/** Asynchronous credit tile builder.
+ *
+ *  Fetches all metatiles under credit tile in parallel and builds the credit
+ *  tile once the last one arrives or all credits have been seen, whatever
+ *  comes first. Remaining fetches are ignored.
+ */
+struct CreditsBuilder : std::enable_shared_from_this<CreditsBuilder> {
+public:
+    typedef std::shared_ptr<CreditsBuilder> pointer;
+
+    CreditsBuilder(const Driver::pointer &driver, const TileId &tileId
+                   , std::size_t maxCount, const InputCallback &cb)
+        : driver_(driver), tileId_(tileId), maxCount_(maxCount), cb_(cb)
+        , expect_(), lastModified_(-1), errorSink_(*this)
+    {}
+
+    void run(const std::vector<TileId> &metaIds) {
+        if (metaIds.empty()) { return finish(); }
+
+        const auto self(shared_from_this());
+
+        expect_ = metaIds.size();
+        for (const auto &metaId : metaIds) {
             {
-                tile.credits.set(credit->id, boost::none);
+                // synchronous driver may have finished everything already
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!expect_) { return; }
+            }
+
+            try {
+                driver_->input(metaId, TileFile::meta
+                               , [self, this](const EIStream &eis)
+                {
+                    if (const auto &is = eis.get(errorSink_)) {
+                        metaFetched(is);
+                    }
+                });
+            } catch (...) {
+                return error(std::current_exception());
             }
         }
-    });
+    }
 
-    if (properties.credits.size() <= 1) {
-        extract(properties.credits);
-    } else {
+private:
+    void metaFetched(const IStream::pointer &is) {
+        // parse outside of lock
         registry::IdSet credits;
-        if (!creditsFromMetatiles(driver, index, CreditTile::creditsId(tileId)
-                                  , noSuchFile, credits
-                                  , properties.credits.size()
-                                  , lastModified))
+        std::time_t lm(-1);
+        try {
+            loadCreditsFromMetaTile(is->get(), credits, is->name());
+            lm = is->stat().lastModified;
+            is->close();
+        } catch (...) {
+            return error(std::current_exception());
+        }
+
         {
-            return {};
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // already done or canceled?
+            if (!expect_) { return; }
+
+            credits_.insert(credits.begin(), credits.end());
+            if (lm > lastModified_) { lastModified_ = lm; }
+
+            // all credits seen -> no need to wait for the rest
+            if (credits_.size() >= maxCount_) {
+                expect_ = 0;
+            } else if (--expect_) {
+                return;
+            }
         }
 
-        extract(credits);
-        if (lastModified <= 0) {
-            lastModified = driver.lastModified();
+        finish();
+    }
+
+    void error(const std::exception_ptr &exc) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // already done or canceled?
+            if (!expect_) { return; }
+
+            // cancel all
+            expect_ = 0;
         }
+
+        // forward error
+        runCallback(exc, cb_);
     }
 
-    auto s(std::make_shared<StringIStream>
-           (TileFile::credits
-            , filename(driver.root(), tileId, TileFile::credits)
-            , lastModified));
+    void finish() {
+        if (lastModified_ <= 0) {
+            lastModified_ = driver_->lastModified();
+        }
 
-    // serialize credit tile
-    saveCreditTile(s->sink(), tile, false);
-    s->updateSize();
+        runCallback([this]() {
+            return creditTile(*driver_, tileId_, credits_, lastModified_);
+        }, cb_);
+    }
 
-    // done
-    return s;
+    const Driver::pointer driver_;
+    const TileId tileId_;
+    const std::size_t maxCount_;
+    const InputCallback cb_;
+
+    std::mutex mutex_;
+    std::size_t expect_;
+    registry::IdSet credits_;
+    std::time_t lastModified_;
+
+    struct ErrorSink {
+        CreditsBuilder &self;
+        ErrorSink(CreditsBuilder &self) : self(self) {}
+
+        void operator()(const std::error_code &ec) {
+            self.error(utility::makeErrorCodeException(ec));
+        }
+
+        void operator()(const std::exception_ptr &exc) {
+            self.error(exc);
+        }
+    } errorSink_;
+};
+
+void credits(const Driver::pointer &driver
+             , const tileset::Index &index
+             , const FullTileSetProperties &properties
+             , const TileId &tileId
+             , const InputCallback &cb)
+{
+    try {
+        if (!CreditTile::isCreditId(tileId)) {
+            LOGTHROW(err1, storage::NoSuchFile)
+                << "Tile ID " << tileId << " is not valid for 2d credit tile.";
+        }
+
+        if (properties.credits.size() <= 1) {
+            // no driver access, can be called immediately
+            return runCallback([&]() {
+                return creditTile(*driver, tileId, properties.credits, -1);
+            }, cb);
+        }
+
+        const auto metaIds(creditsMetaIds
+                           (index, CreditTile::creditsId(tileId)));
+        std::make_shared<CreditsBuilder>
+            (driver, tileId, properties.credits.size(), cb)->run(metaIds);
+    } catch (...) {
+        // forward exception
+        runCallback(cb);
+    }
 }
 
 IStream::pointer filterConfig(const IStream::pointer &raw)
@@ -342,6 +637,7 @@ Delivery::Delivery(AccessToken, const boost::filesystem::path &root
     , properties_(tileset::loadConfig(*driver_))
     , index_(indexFromDriver(properties_, driver_))
     , async_(driver_->ccapabilities().async)
+    , tile2dCache_(std::make_shared<Tile2dCache>(openOptions))
 {}
 
 Delivery::Delivery(AccessToken, std::shared_ptr<Driver> driver)
@@ -349,6 +645,7 @@ Delivery::Delivery(AccessToken, std::shared_ptr<Driver> driver)
     , properties_(tileset::loadConfig(*driver_))
     , index_(indexFromDriver(properties_, driver_))
     , async_(driver_->ccapabilities().async)
+    , tile2dCache_(std::make_shared<Tile2dCache>(driver_->openOptions()))
 {}
 
 Delivery::pointer
@@ -384,24 +681,15 @@ IStream::pointer Delivery::input(File type, const NullWhenNotFound_t&) const
     return driver_->input(type, NullWhenNotFound);
 }
 
-namespace {
-
-inline void fixmeAsync() {
-    LOGTHROW(err4, std::runtime_error)
-        << "FIXME: make me async!";
-}
-
-} // namespace
-
 IStream::pointer Delivery::input(const TileId &tileId, TileFile type
                                  , FileFlavor flavor) const
 {
     switch (type) {
     case TileFile::meta2d:
-        return meta2d(*driver_, *index_, tileId, true);
+        return meta2d(*driver_, *tile2dCache_, *index_, tileId, true);
 
     case TileFile::mask:
-        return mask(driver_, tileId, flavor, true);
+        return mask(driver_, *tile2dCache_, tileId, flavor, true);
 
     case TileFile::credits:
         return credits(*driver_, *index_, properties_, tileId, true);
@@ -420,10 +708,10 @@ IStream::pointer Delivery::input(const TileId &tileId, TileFile type
 {
     switch (type) {
     case TileFile::meta2d:
-        return meta2d(*driver_, *index_, tileId, false);
+        return meta2d(*driver_, *tile2dCache_, *index_, tileId, false);
 
     case TileFile::mask:
-        return mask(driver_, tileId, flavor, false);
+        return mask(driver_, *tile2dCache_, tileId, flavor, false);
 
     case TileFile::credits:
         return credits(*driver_, *index_, properties_, tileId, false);
@@ -441,14 +729,13 @@ void Delivery::input(const TileId &tileId, TileFile type, FileFlavor flavor
 {
     switch (type) {
     case TileFile::meta2d:
-        return meta2d(*driver_, *index_, tileId, cb);
+        return meta2d(*driver_, *tile2dCache_, *index_, tileId, cb);
 
     case TileFile::mask:
-        return mask(driver_, tileId, flavor, cb);
+        return mask(driver_, tile2dCache_, tileId, flavor, cb);
 
     case TileFile::credits:
-        fixmeAsync();
-        return cb(credits(*driver_, *index_, properties_, tileId, true));
+        return credits(driver_, *index_, properties_, tileId, cb);
 
     case TileFile::meta:
         return meta(*driver_, *index_, properties_, tileId, flavor, cb);
@@ -516,4 +803,19 @@ MeshTilesConfig Delivery::meshTilesConfig(bool includeExtra) const
     return TileSet::meshTilesConfig(*driver_, includeExtra);
 }
 
+driver::BlobCacheStats Delivery::tile2dCacheStats()
+{
+    return Tile2dCache::stats();
+}
+
+void Delivery::tile2dCacheLimit(std::size_t limit)
+{
+    Tile2dCache::limit(limit);
+}
+
+std::size_t Delivery::tile2dCacheLimit()
+{
+    return Tile2dCache::limit();
+}
+
 } } // namespace vtslibs::vts
@@ -45,6 +45,7 @@
 #include "../config.hpp"
 #include "../driver.hpp"
 #include "../detail.hpp"
+#include "../metacache.hpp"
 
 #include "runcallback.hpp"
 
@@ -95,6 +96,7 @@ Driver::Driver(const boost::filesystem::path &root
     , openOptions_(openOptions)
     , options_(options)
     , runnable_(), lastModified_()
+    , singleFlight_(std::make_shared<driver::SingleFlight>())
 {
     if (!create_directories(root_)) {
         // directory already exists -> fail if mode says so
@@ -119,6 +121,7 @@ Driver::Driver(const OpenOptions &openOptions
     , openOptions_(openOptions)
     , options_(options)
     , runnable_(), lastModified_()
+    , singleFlight_(std::make_shared<driver::SingleFlight>())
 {}
 
 Driver::Driver(const boost::filesystem::path &root
@@ -139,11 +142,19 @@ Driver::Driver(const boost::filesystem::path &root
     , lastModified_(std::max({ rootStat_.lastModified, configStat_.lastModified
                     , extraConfigStat_.lastModified
                     , registryStat_.lastModified}))
+    , singleFlight_(std::make_shared<driver::SingleFlight>())
 {
 }
 
 Driver::~Driver() {}
 
+storage::Resources Driver::resources() const
+{
+    auto resources(resources_impl());
+    resources.memory += MetaCache::readOnlyStats(*this).memory;
+    return resources;
+}
+
 bool Driver::externallyChanged() const
 {
     return (rootStat_.changed(FileStat::stat(root_, std::nothrow))
@@ -499,6 +510,15 @@ bool Driver::check(const boost::filesystem::path &root)
     return false;
 }
 
+std::vector<fs::path> Driver::configFiles(const boost::filesystem::path &root)
+{
+    return {
+        root / filePath(File::config)
+        , root / filePath(File::extraConfig)
+        , root / filePath(File::registry)
+    };
+}
+
 bool Driver::check(const boost::filesystem::path &root
                    , const std::string &mime)
 {
@@ -623,6 +643,17 @@ void Driver::input_impl(const TileId &tileId, TileFile type
     }, cb);
 }
 
+void Driver::coalescedInput(const TileId &tileId, TileFile type
+                            , const InputCallback &cb
+                            , const IStream::pointer *notFound) const
+{
+    singleFlight_->input(tileId, type, notFound, cb
+                         , [&](const InputCallback &done)
+    {
+        input_impl(tileId, type, done, notFound);
+    });
+}
+
 void Driver::stat_impl(const TileId &tileId, TileFile type
                        , const StatCallback &cb) const
 {
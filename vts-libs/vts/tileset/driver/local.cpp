@@ -91,6 +91,8 @@ LocalDriver::LocalDriver(const boost::filesystem::path &root
                             , properties);
     }
 
+    capabilities().coalesce = true;
+
     // make me read-only
     readOnly(true);
 }
@@ -100,7 +102,9 @@ LocalDriver::LocalDriver(const boost::filesystem::path &root
                          , const LocalOptions &options)
     : Driver(root, openOptions, options)
     , driver_(Driver::open(options.path, openOptions))
-{}
+{
+    capabilities().coalesce = true;
+}
 
 Driver::pointer
 LocalDriver::clone_impl(const boost::filesystem::path &root
@@ -275,7 +279,9 @@ LocalDriver::LocalDriver(PrivateTag, const boost::filesystem::path &root
                          , Driver::pointer owned)
     : Driver(root, openOptions, options)
     , driver_(std::move(owned))
-{}
+{
+    capabilities().coalesce = true;
+}
 
 void LocalDriver::open(const boost::filesystem::path &root
                        , const OpenOptions &openOptions
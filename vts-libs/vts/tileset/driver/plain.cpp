@@ -102,7 +102,8 @@ PlainDriver::PlainDriver(const boost::filesystem::path &root
                          , const OpenOptions &openOptions
                          , const PlainOptions &options)
     : Driver(root, openOptions, options)
-    , cache_(this->root(), this->options<PlainOptions>(), true)
+    , cache_(this->root(), this->options<PlainOptions>(), true
+             , openOptions.mappedArchives())
 {
 }
 
@@ -94,6 +94,7 @@ RemoteDriver::RemoteDriver(const boost::filesystem::path &root
 {
     // asynchronous in nature
     capabilities().async = true;
+    capabilities().coalesce = true;
 
     {
         auto properties(tileset::loadConfig(fetcher_.input(File::config)));
@@ -117,6 +118,8 @@ RemoteDriver::RemoteDriver(const boost::filesystem::path &root
     // and load it
     tileset::loadTileSetIndex(tsi_, *this);
 
+    openCache(cloneOptions.openOptions());
+
     // make me read-only
     readOnly(true);
 }
@@ -130,12 +133,15 @@ RemoteDriver::RemoteDriver(const boost::filesystem::path &root
 {
     // asynchronous in nature
     capabilities().async = true;
+    capabilities().coalesce = true;
 
     {
         auto properties(tileset::loadConfig(*this));
         revision_ = properties.revision;
     }
     tileset::loadTileSetIndex(tsi_, *this);
+
+    openCache(openOptions);
 }
 
 RemoteDriver::RemoteDriver(const boost::filesystem::path &root
@@ -148,6 +154,7 @@ RemoteDriver::RemoteDriver(const boost::filesystem::path &root
 {
     // asynchronous in nature
     capabilities().async = true;
+    capabilities().coalesce = true;
 
     // update and save properties
     {
@@ -172,6 +179,8 @@ RemoteDriver::RemoteDriver(const boost::filesystem::path &root
     // and load it
     tileset::loadTileSetIndex(tsi_, *this);
 
+    openCache(cloneOptions.openOptions());
+
     // make me read-only
     readOnly(true);
 }
@@ -187,6 +196,18 @@ RemoteDriver::clone_impl(const boost::filesystem::path &root
 
 RemoteDriver::~RemoteDriver() {}
 
+void RemoteDriver::openCache(const OpenOptions &openOptions)
+{
+    if (openOptions.remoteCache().empty()
+        || !openOptions.remoteCacheSize())
+    {
+        return;
+    }
+
+    cache_ = RemoteCache::open(openOptions.remoteCache(), options().url
+                               , revision_, openOptions.remoteCacheSize());
+}
+
 OStream::pointer RemoteDriver::output_impl(File type)
 {
     if (readOnly()) {
@@ -225,7 +246,11 @@ IStream::pointer RemoteDriver::input_impl(const TileId &tileId
                                         , TileFile type)
     const
 {
-    return fetcher_.input(tileId, type, revision_);
+    if (!cache_) { return fetcher_.input(tileId, type, revision_); }
+
+    if (auto is = cache_->input(tileId, type)) { return is; }
+    return cache_->store(tileId, type
+                         , fetcher_.input(tileId, type, revision_));
 }
 
 IStream::pointer RemoteDriver::input_impl(const TileId &tileId
@@ -233,7 +258,12 @@ IStream::pointer RemoteDriver::input_impl(const TileId &tileId
                                           , const NullWhenNotFound_t&)
     const
 {
-    return fetcher_.input(tileId, type, revision_, false);
+    if (!cache_) { return fetcher_.input(tileId, type, revision_, false); }
+
+    if (auto is = cache_->input(tileId, type)) { return is; }
+    auto is(fetcher_.input(tileId, type, revision_, false));
+    if (!is) { return is; }
+    return cache_->store(tileId, type, is);
 }
 
 void RemoteDriver::input_impl(const TileId &tileId, TileFile type
@@ -241,7 +271,34 @@ void RemoteDriver::input_impl(const TileId &tileId, TileFile type
                               , const IStream::pointer *notFound)
     const
 {
-    return fetcher_.input(tileId, type, revision_, cb, notFound);
+    if (!cache_) {
+        return fetcher_.input(tileId, type, revision_, cb, notFound);
+    }
+
+    // cache lookup reads from the disk: do not block caller, run lookup in
+    // cache's reader thread and fetch (and store) on miss from there;
+    // not-found marker is passed as-is; fetcher is copied since driver can
+    // be gone before the task is run
+    auto cache(cache_);
+    const auto fetcher(fetcher_);
+    const auto revision(revision_);
+    const auto notFoundMarker(notFound ? *notFound : IStream::pointer());
+    RemoteCache::post([=]()
+    {
+        if (auto is = cache->input(tileId, type)) {
+            return runCallback([&]() { return is; }, cb);
+        }
+
+        fetcher.input(tileId, type, revision, [=](const EIStream &eis)
+        {
+            runCallback([&]() -> IStream::pointer
+            {
+                const auto &is(eis.get());
+                if (!is || (is == notFoundMarker)) { return is; }
+                return cache->store(tileId, type, is);
+            }, cb);
+        }, notFound);
+    });
 }
 
 FileStat RemoteDriver::stat_impl(File type) const
@@ -271,7 +328,7 @@ void RemoteDriver::stat_impl(const TileId &tileId, TileFile type
 
 storage::Resources RemoteDriver::resources_impl() const
 {
-    // nothing
+    if (cache_) { return cache_->resources(); }
     return {};
 }
 
@@ -32,6 +32,7 @@
 
 #include "../driver.hpp"
 #include "httpfetcher.hpp"
+#include "remotecache.hpp"
 
 namespace vtslibs { namespace vts { namespace driver {
 
@@ -119,9 +120,17 @@ private:
         return Driver::options<const RemoteOptions&>();
     }
 
+    /** Opens on-disk cache if configured in open options.
+     */
+    void openCache(const OpenOptions &openOptions);
+
     HttpFetcher fetcher_;
     unsigned int revision_;
     tileset::Index tsi_;
+
+    /** Optional persistent on-disk cache.
+     */
+    RemoteCache::pointer cache_;
 };
 
 } } } // namespace vtslibs::vts::driver
@@ -0,0 +1,530 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <map>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/file.h>
+
+#include <boost/format.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/name_generator.hpp>
+#include <boost/uuid/nil_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "../../../storage/sstreams.hpp"
+#include "remotecache.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+namespace {
+
+/** Binary order of cache archives.
+ */
+const std::uint8_t BinaryOrder(5);
+
+/** Number of stored files between two commits.
+ */
+const std::size_t CommitInterval(256);
+
+boost::uuids::uuid nameUuid(const std::string &name)
+{
+    boost::uuids::name_generator gen(boost::uuids::nil_uuid());
+    return gen(name);
+}
+
+/** Cache archives are bound to URL and revision via UUID.
+ */
+PlainOptions cacheOptions(const std::string &url, unsigned int revision)
+{
+    PlainOptions options(BinaryOrder);
+    options.uuid(nameUuid(str(boost::format("%s?%d") % url % revision)));
+    return options;
+}
+
+std::size_t diskUsage(const fs::path &path)
+{
+    std::size_t size(0);
+    for (fs::recursive_directory_iterator i(path), e; i != e; ++i) {
+        if (fs::is_regular_file(i->status())) {
+            size += fs::file_size(i->path());
+        }
+    }
+    return size;
+}
+
+bool numericName(const fs::path &path, unsigned int &index)
+{
+    try {
+        index = boost::lexical_cast<unsigned int>(path.filename().string());
+        return true;
+    } catch (const boost::bad_lexical_cast&) {}
+    return false;
+}
+
+/** Opens revision's lock file and locks it (non-blocking). Returns invalid
+ *  descriptor if lock cannot be obtained.
+ *
+ *  Every cache holds shared lock on its revision for its whole lifetime,
+ *  stale revision is removed only under exclusive lock.
+ */
+utility::Filedes lockRevision(const fs::path &path, bool exclusive)
+{
+    const auto lockPath(path / "lock");
+    utility::Filedes fd(::open(lockPath.string().c_str()
+                               , O_RDWR | O_CREAT | O_CLOEXEC, 0666)
+                        , lockPath);
+    if (!fd) {
+        LOG(warn2) << "Unable to open remote cache lock " << lockPath
+                   << ": " << std::system_category().message(errno) << ".";
+        return fd;
+    }
+
+    if (-1 == ::flock(fd, (exclusive ? LOCK_EX : LOCK_SH) | LOCK_NB)) {
+        if (errno != EWOULDBLOCK) {
+            LOG(warn2) << "Unable to lock remote cache lock " << lockPath
+                       << ": " << std::system_category().message(errno)
+                       << ".";
+        }
+        return {};
+    }
+
+    return fd;
+}
+
+void removeAll(const fs::path &path)
+{
+    boost::system::error_code ec;
+    fs::remove_all(path, ec);
+    if (ec) {
+        LOG(warn2) << "Unable to remove remote cache directory "
+                   << path << ": <" << ec.message() << ">.";
+    }
+}
+
+std::string readAll(const IStream::pointer &is)
+{
+    if (const auto memory = is->memory()) {
+        return std::string(memory->data, memory->size);
+    }
+
+    std::ostringstream os;
+    os << is->get().rdbuf();
+    return os.str();
+}
+
+/** Number of background reader threads.
+ */
+const std::size_t ReaderCount(4);
+
+/** Background threads shared by all remote caches in the process. Used by
+ *  asynchronous users so that cache lookup never blocks caller's thread.
+ *
+ *  Queued tasks are run before the threads are joined.
+ */
+class Readers : boost::noncopyable {
+public:
+    typedef std::function<void()> Task;
+
+    static Readers& instance() {
+        static Readers readers;
+        return readers;
+    }
+
+    void post(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        cond_.notify_one();
+    }
+
+    ~Readers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        for (auto &thread : threads_) { thread.join(); }
+    }
+
+private:
+    Readers() : stop_(false) {
+        for (std::size_t i(0); i < ReaderCount; ++i) {
+            threads_.emplace_back(&Readers::run, this);
+        }
+    }
+
+    void run() {
+        dbglog::thread_id("rcache");
+        for (;;) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this]() {
+                        return stop_ || !tasks_.empty();
+                    });
+                if (tasks_.empty()) { return; }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+
+            try {
+                task();
+            } catch (const std::exception &e) {
+                LOG(warn2) << "Remote cache reader task failed: <"
+                           << e.what() << ">.";
+            } catch (...) {
+                LOG(warn2) << "Remote cache reader task failed.";
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Task> tasks_;
+    std::vector<std::thread> threads_;
+    bool stop_;
+};
+
+} // namespace
+
+void RemoteCache::post(const std::function<void()> &task)
+{
+    Readers::instance().post(task);
+}
+
+struct RemoteCache::Generation : boost::noncopyable {
+    Generation(const fs::path &root, const PlainOptions &options)
+        : root(root), cache(this->root, options, false)
+        , size(), pending(), dropped(false)
+    {
+        fs::create_directories(root);
+        size = diskUsage(root);
+    }
+
+    ~Generation() {
+        if (dropped) {
+            // uncommitted changes are discarded by the cache itself
+            removeAll(root);
+            return;
+        }
+
+        try {
+            commit();
+        } catch (const std::exception &e) {
+            LOG(warn2) << "Failed to commit remote cache generation "
+                       << root << ": <" << e.what() << ">.";
+        }
+    }
+
+    /** Must be called under write lock (or when nobody else uses the
+     *  generation).
+     */
+    void commit() {
+        cache.flush();
+        pending = 0;
+    }
+
+    const fs::path root;
+    Cache cache;
+    std::atomic<std::size_t> size;
+
+    /** Number of uncommitted files. Guarded by writeMutex.
+     */
+    std::size_t pending;
+
+    std::atomic<bool> dropped;
+
+    /** Serializes reads, writes and commits.
+     */
+    std::mutex writeMutex;
+};
+
+RemoteCache::pointer RemoteCache::open(const fs::path &root
+                                       , const std::string &url
+                                       , unsigned int revision
+                                       , std::size_t limit)
+{
+    typedef std::map<std::string, std::weak_ptr<RemoteCache>> Caches;
+
+    static std::mutex mutex;
+    static Caches caches;
+
+    const auto key(str(boost::format("%s|%s|%d")
+                       % fs::absolute(root).string() % url % revision));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &weak(caches[key]);
+    if (auto cache = weak.lock()) { return cache; }
+
+    auto cache(std::make_shared<RemoteCache>(root, url, revision, limit));
+    weak = cache;
+    return cache;
+}
+
+RemoteCache::RemoteCache(const fs::path &root, const std::string &url
+                         , unsigned int revision, std::size_t limit)
+    : root_(root / to_string(nameUuid(url))
+            / boost::lexical_cast<std::string>(revision))
+    , limit_(limit), options_(cacheOptions(url, revision))
+    , nextGeneration_()
+    , hits_(), misses_(), stores_(), promotions_(), evictions_()
+{
+    fs::create_directories(root_);
+
+    // keep our revision locked while in use
+    lock_ = lockRevision(root_, false);
+
+    // revision-based invalidation: drop older revisions of this URL unless
+    // still in use by another cache (possibly in another process); newer
+    // revisions belong to someone else and are left intact
+    for (fs::directory_iterator i(root_.parent_path()), e; i != e; ++i) {
+        unsigned int other;
+        if (!numericName(i->path(), other) || (other >= revision)) {
+            continue;
+        }
+
+        const auto lock(lockRevision(i->path(), true));
+        if (!lock) {
+            LOG(info2) << "Keeping stale remote cache " << i->path()
+                       << " since it is still in use.";
+            continue;
+        }
+
+        LOG(info2) << "Removing stale remote cache " << i->path() << ".";
+        removeAll(i->path());
+    }
+
+    // find existing generations
+    std::vector<unsigned int> existing;
+    for (fs::directory_iterator i(root_), e; i != e; ++i) {
+        unsigned int index;
+        if (fs::is_directory(i->status())
+            && numericName(i->path(), index))
+        {
+            existing.push_back(index);
+        }
+    }
+    std::sort(existing.begin(), existing.end());
+
+    // keep only last two generations
+    while (existing.size() > 2) {
+        removeAll(root_ / boost::lexical_cast<std::string>(existing.front()));
+        existing.erase(existing.begin());
+    }
+
+    for (auto index : existing) {
+        generations_.push_back
+            (std::make_shared<Generation>
+             (root_ / boost::lexical_cast<std::string>(index), options_));
+        nextGeneration_ = index + 1;
+    }
+
+    if (generations_.empty()) {
+        generations_.push_back
+            (std::make_shared<Generation>
+             (root_ / boost::lexical_cast<std::string>(nextGeneration_++)
+              , options_));
+    }
+
+    LOG(info2) << "Using remote cache at " << root_ << " for <" << url
+               << "> (" << stats().size << " bytes cached).";
+}
+
+RemoteCache::~RemoteCache() = default;
+
+RemoteCache::GenerationPointer RemoteCache::current()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto generation(generations_.back());
+    if (generation->size < (limit_ / 2)) { return generation; }
+
+    // current generation is full, start new one
+    auto next(std::make_shared<Generation>
+              (root_ / boost::lexical_cast<std::string>(nextGeneration_++)
+               , options_));
+    generations_.push_back(next);
+
+    // and drop the oldest one
+    while (generations_.size() > 2) {
+        LOG(info1) << "Dropping remote cache generation "
+                   << generations_.front()->root << ".";
+        generations_.front()->dropped = true;
+        generations_.pop_front();
+        ++evictions_;
+    }
+    lock.unlock();
+
+    // commit previous generation, it is not written anymore
+    {
+        std::lock_guard<std::mutex> wlock(generation->writeMutex);
+        generation->commit();
+    }
+
+    return next;
+}
+
+void RemoteCache::write(Generation &generation, const TileId &tileId
+                        , TileFile type, const std::string &data)
+{
+    std::lock_guard<std::mutex> lock(generation.writeMutex);
+    if (generation.dropped) { return; }
+
+    auto os(generation.cache.output(tileId, type));
+    os->get().write(data.data(), data.size());
+    os->close();
+
+    generation.size += data.size();
+    if (++generation.pending >= CommitInterval) { generation.commit(); }
+}
+
+IStream::pointer RemoteCache::input(const TileId &tileId, TileFile type)
+{
+    // newest generation first
+    std::vector<GenerationPointer> generations;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generations.assign(generations_.rbegin(), generations_.rend());
+    }
+
+    for (std::size_t i(0); i < generations.size(); ++i) {
+        auto &generation(*generations[i]);
+
+        // generation's archives are open read-write and appended to by
+        // write(): look file up under the write lock; file content itself is
+        // never rewritten in an append-only archive and the stream keeps the
+        // archive open, so the data are read without the lock
+        std::string data;
+        std::time_t lastModified;
+        std::string name;
+        try {
+            IStream::pointer is;
+            {
+                std::lock_guard<std::mutex> lock(generation.writeMutex);
+                is = generation.cache.input(tileId, type, NullWhenNotFound);
+                if (!is) { continue; }
+                lastModified = is->stat().lastModified;
+                name = is->name();
+            }
+            data = readAll(is);
+        } catch (const std::exception &e) {
+            LOG(warn1) << "Failed to read " << type << " " << tileId
+                       << " from remote cache: <" << e.what() << ">.";
+            continue;
+        }
+
+        ++hits_;
+        if (!i) {
+            return storage::memIStream(type, std::move(data), lastModified
+                                       , name);
+        }
+
+        // hit in older generation: promote to the current one
+        try {
+            write(*current(), tileId, type, data);
+            ++promotions_;
+        } catch (const std::exception &e) {
+            LOG(warn1) << "Failed to promote " << type << " " << tileId
+                       << " in remote cache: <" << e.what() << ">.";
+        }
+        return storage::memIStream(type, std::move(data), lastModified
+                                   , name);
+    }
+
+    ++misses_;
+    return {};
+}
+
+IStream::pointer RemoteCache::store(const TileId &tileId, TileFile type
+                                    , const IStream::pointer &is)
+{
+    auto data(readAll(is));
+    const auto lastModified(is->stat().lastModified);
+
+    try {
+        write(*current(), tileId, type, data);
+        ++stores_;
+    } catch (const std::exception &e) {
+        LOG(warn1) << "Failed to store " << type << " " << tileId
+                   << " in remote cache: <" << e.what() << ">.";
+    }
+
+    return storage::memIStream(type, std::move(data), lastModified
+                               , is->name());
+}
+
+void RemoteCache::flush()
+{
+    std::vector<GenerationPointer> generations;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generations.assign(generations_.begin(), generations_.end());
+    }
+
+    for (const auto &generation : generations) {
+        std::lock_guard<std::mutex> lock(generation->writeMutex);
+        generation->commit();
+    }
+}
+
+storage::Resources RemoteCache::resources()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    storage::Resources resources;
+    for (const auto &generation : generations_) {
+        resources += generation->cache.resources();
+    }
+    return resources;
+}
+
+RemoteCacheStats RemoteCache::stats() const
+{
+    RemoteCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.stores = stores_;
+    stats.promotions = promotions_;
+    stats.evictions = evictions_;
+    stats.limit = limit_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &generation : generations_) {
+        stats.size += generation->size;
+    }
+    return stats;
+}
+
+} } } // namespace vtslibs::vts::driver
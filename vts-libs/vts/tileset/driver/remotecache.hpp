@@ -0,0 +1,197 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/tileset/driver/remotecache.hpp
+ *
+ * Persistent on-disk cache of remote tileset data.
+ */
+
+#ifndef vtslibs_vts_tileset_driver_remotecache_hpp_included_
+#define vtslibs_vts_tileset_driver_remotecache_hpp_included_
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+#include <boost/noncopyable.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include "utility/filedes.hpp"
+
+#include "cache.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+/** Remote cache statistics.
+ */
+struct RemoteCacheStats {
+    /** Number of successful lookups.
+     */
+    std::size_t hits;
+
+    /** Number of failed lookups.
+     */
+    std::size_t misses;
+
+    /** Number of stored files.
+     */
+    std::size_t stores;
+
+    /** Number of files copied from old generation to the current one.
+     */
+    std::size_t promotions;
+
+    /** Number of dropped generations.
+     */
+    std::size_t evictions;
+
+    /** Size of cached data on disk (in bytes).
+     */
+    std::size_t size;
+
+    /** Size limit (in bytes).
+     */
+    std::size_t limit;
+
+    RemoteCacheStats()
+        : hits(), misses(), stores(), promotions(), evictions()
+        , size(), limit()
+    {}
+};
+
+/** Persistent cache of remote tileset files stored in tilar archives (via
+ *  driver::Cache).
+ *
+ *  Cache is keyed by tileset URL and revision: data live in
+ *  root/URL-UUID/REVISION; older revisions of the same URL are removed when
+ *  cache is opened (revision-based invalidation) unless they are still in
+ *  use. Revision in use is marked by shared file lock held by its cache.
+ *
+ *  Since tilar archives are append-only, LRU eviction is approximated by
+ *  generations: new data are written into the current generation; once the
+ *  current generation reaches half of the limit a new generation is started
+ *  and the oldest one is removed as a whole. Hit in the previous generation
+ *  copies the file into the current one, therefore recently used data
+ *  survive generation drop. Disk usage is thus kept within the limit.
+ *
+ *  Archives are committed periodically, on generation switch and when cache
+ *  is destroyed.
+ *
+ *  Thread safe.
+ */
+class RemoteCache : boost::noncopyable {
+public:
+    typedef std::shared_ptr<RemoteCache> pointer;
+
+    /** Opens (or creates) cache. Cache for the same URL and revision is
+     *  shared by all its users inside the process.
+     *
+     * \param root root directory of all remote caches
+     * \param url tileset URL
+     * \param revision tileset revision
+     * \param limit size limit (in bytes)
+     */
+    static pointer open(const boost::filesystem::path &root
+                        , const std::string &url, unsigned int revision
+                        , std::size_t limit);
+
+    /** Use open() instead.
+     */
+    RemoteCache(const boost::filesystem::path &root
+                , const std::string &url, unsigned int revision
+                , std::size_t limit);
+
+    ~RemoteCache();
+
+    /** Returns cached file or null pointer if not found.
+     */
+    IStream::pointer input(const TileId &tileId, TileFile type);
+
+    /** Stores file in the cache. Returns stream with the same content as the
+     *  original one (original stream is consumed). Failure to write the file
+     *  into the cache is not an error.
+     */
+    IStream::pointer store(const TileId &tileId, TileFile type
+                           , const IStream::pointer &is);
+
+    /** Commits all pending changes to the disk.
+     */
+    void flush();
+
+    /** Runs task in a background reader thread (shared by all caches).
+     *  Asynchronous users perform cache lookups (and subsequent fetches)
+     *  this way so that disk I/O does not block their thread.
+     */
+    static void post(const std::function<void()> &task);
+
+    storage::Resources resources();
+
+    RemoteCacheStats stats() const;
+
+private:
+    struct Generation;
+
+    typedef std::shared_ptr<Generation> GenerationPointer;
+
+    /** Returns current generation, starts new one if current is full.
+     */
+    GenerationPointer current();
+
+    /** Writes data into given generation.
+     */
+    void write(Generation &generation, const TileId &tileId, TileFile type
+               , const std::string &data);
+
+    const boost::filesystem::path root_;
+    const std::size_t limit_;
+    const PlainOptions options_;
+
+    /** Shared lock on our revision directory.
+     */
+    utility::Filedes lock_;
+
+    mutable std::mutex mutex_;
+
+    /** Live generations, oldest first.
+     */
+    std::deque<GenerationPointer> generations_;
+
+    /** Index of next generation.
+     */
+    unsigned int nextGeneration_;
+
+    std::atomic<std::size_t> hits_;
+    std::atomic<std::size_t> misses_;
+    std::atomic<std::size_t> stores_;
+    std::atomic<std::size_t> promotions_;
+    std::atomic<std::size_t> evictions_;
+};
+
+} } } // namespace vtslibs::vts::driver
+
+#endif // vtslibs_vts_tileset_driver_remotecache_hpp_included_
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <tuple>
+#include <sstream>
+
+#include "../../../storage/sstreams.hpp"
+
+#include "singleflight.hpp"
+#include "runcallback.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+bool SingleFlight::Key::operator<(const Key &o) const
+{
+    return (std::tie(tileId, type, notFound)
+            < std::tie(o.tileId, o.type, o.notFound));
+}
+
+void SingleFlight::input(const TileId &tileId, TileFile type
+                         , const IStream::pointer *notFound
+                         , const InputCallback &cb, const Fetch &fetch)
+{
+    const Key key(tileId, type, notFound);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.requests;
+        auto res(inFlight_.insert(InFlight::value_type(key, Waiters())));
+        res.first->second.push_back(cb);
+        if (!res.second) {
+            // already in flight, just wait
+            ++stats_.coalesced;
+            return;
+        }
+    }
+
+    auto self(shared_from_this());
+    try {
+        fetch([self, key](const EIStream &eis) { self->done(key, eis); });
+    } catch (...) {
+        // failed to start fetch
+        done(key, std::current_exception());
+    }
+}
+
+void SingleFlight::done(const Key &key, const EIStream &eis)
+{
+    Waiters waiters;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto finFlight(inFlight_.find(key));
+        if (finFlight == inFlight_.end()) { return; }
+        waiters.swap(finFlight->second);
+        inFlight_.erase(finFlight);
+    }
+
+    if (waiters.size() == 1) {
+        // single waiter, forward as-is
+        return runCallback([&]() -> IStream::pointer
+        {
+            return eis.get();
+        }, waiters.front());
+    }
+
+    // multiple waiters: each needs its own stream
+    IStream::pointer is;
+    storage::SharedData data;
+    FileStat stat;
+    try {
+        is = eis.get();
+        if (is && (!key.notFound || (is != *key.notFound))) {
+            stat = is->stat();
+            if (const auto memory = is->memory()) {
+                data = std::make_shared<const std::string>
+                    (memory->data, memory->size);
+            } else {
+                std::ostringstream os;
+                os << is->get().rdbuf();
+                data = std::make_shared<const std::string>(os.str());
+            }
+        }
+    } catch (...) {
+        const auto exc(std::current_exception());
+        for (const auto &cb : waiters) { runCallback(exc, cb); }
+        return;
+    }
+
+    for (const auto &cb : waiters) {
+        runCallback([&]() -> IStream::pointer
+        {
+            // null or not-found marker
+            if (!data) { return is; }
+            return storage::memIStream(stat.contentType, data
+                                       , stat.lastModified, is->name());
+        }, cb);
+    }
+}
+
+SingleFlightStats SingleFlight::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto stats(stats_);
+    stats.inFlight = inFlight_.size();
+    return stats;
+}
+
+} } } // namespace vtslibs::vts::driver
@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/tileset/driver/singleflight.hpp
+ *
+ * Coalescing of concurrent identical asynchronous input requests.
+ */
+
+#ifndef vtslibs_vts_tileset_driver_singleflight_hpp_included_
+#define vtslibs_vts_tileset_driver_singleflight_hpp_included_
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <boost/noncopyable.hpp>
+
+#include "../../basetypes.hpp"
+#include "streams.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+/** Input coalescing statistics.
+ */
+struct SingleFlightStats {
+    /** Number of all requests.
+     */
+    std::size_t requests;
+
+    /** Number of requests merged into already running fetch.
+     */
+    std::size_t coalesced;
+
+    /** Number of currently running fetches.
+     */
+    std::size_t inFlight;
+
+    SingleFlightStats() : requests(), coalesced(), inFlight() {}
+};
+
+/** Merges concurrent identical (tileId, type, notFound) input requests into
+ *  single fetch. Result is fanned out to all waiting callbacks: single waiter
+ *  gets the fetched stream as-is, multiple waiters get their own streams over
+ *  shared in-memory copy of the data.
+ *
+ *  Thread safe. Must be held by a shared pointer.
+ */
+class SingleFlight
+    : boost::noncopyable
+    , public std::enable_shared_from_this<SingleFlight>
+{
+public:
+    typedef std::shared_ptr<SingleFlight> pointer;
+
+    /** Starts the fetch. Fetch must (eventually) call provided callback.
+     */
+    typedef std::function<void(const InputCallback&)> Fetch;
+
+    /** Calls fetch unless identical request is already in flight. Callback is
+     *  called when data are ready.
+     */
+    void input(const TileId &tileId, TileFile type
+               , const IStream::pointer *notFound
+               , const InputCallback &cb, const Fetch &fetch);
+
+    SingleFlightStats stats() const;
+
+private:
+    struct Key {
+        TileId tileId;
+        TileFile type;
+        const IStream::pointer *notFound;
+
+        Key(const TileId &tileId, TileFile type
+            , const IStream::pointer *notFound)
+            : tileId(tileId), type(type), notFound(notFound)
+        {}
+
+        bool operator<(const Key &o) const;
+    };
+
+    typedef std::vector<InputCallback> Waiters;
+    typedef std::map<Key, Waiters> InFlight;
+
+    void done(const Key &key, const EIStream &eis);
+
+    mutable std::mutex mutex_;
+    InFlight inFlight_;
+    SingleFlightStats stats_;
+};
+
+} } } // namespace vtslibs::vts::driver
+
+#endif // vtslibs_vts_tileset_driver_singleflight_hpp_included_
@@ -24,6 +24,12 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <iterator>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <exception>
 
 #include <boost/format.hpp>
 #include <boost/range/sub_range.hpp>
@@ -110,15 +116,85 @@ inline void dump(const char *root, const boost::filesystem::path &dir
     }
 }
 
+/** Serializes access to a data source. Tileset internals (driver, metatile
+ *  cache) are not thread safe.
+ */
+class LockedDataSource : public MeshOpInput::DataSource {
+public:
+    LockedDataSource(const MeshOpInput::DataSource::pointer &ds)
+        : MeshOpInput::DataSource(ds->properties()), ds_(ds)
+    {}
+
+private:
+    typedef std::unique_lock<std::mutex> Lock;
+
+    virtual TileIndex::Flag::value_type flags_impl(const TileId &tileId)
+        const
+    {
+        Lock lock(mutex_);
+        return ds_->flags(tileId);
+    }
+
+    virtual MetaNode::pointer findMetaNode_impl(const TileId &tileId) const
+    {
+        Lock lock(mutex_);
+        return ds_->findMetaNode(tileId);
+    }
+
+    virtual Mesh::pointer getMesh_impl(const TileId &tileId
+                                       , TileIndex::Flag::value_type flags)
+        const
+    {
+        Lock lock(mutex_);
+        return ds_->getMesh(tileId, flags);
+    }
+
+    virtual opencv::HybridAtlas::pointer
+    getAtlas_impl(const TileId &tileId
+                  , TileIndex::Flag::value_type flags) const
+    {
+        Lock lock(mutex_);
+        return ds_->getAtlas(tileId, flags);
+    }
+
+    virtual opencv::NavTile::pointer
+    getNavTile_impl(const TileId &tileId, const MetaNode *node) const
+    {
+        Lock lock(mutex_);
+        return ds_->getNavTile(tileId, node);
+    }
+
+    virtual NodeInfo nodeInfo_impl(const TileId &tileId) const
+    {
+        Lock lock(mutex_);
+        return ds_->nodeInfo(tileId);
+    }
+
+    const MeshOpInput::DataSource::pointer ds_;
+    mutable std::mutex mutex_;
+};
+
 MeshOpInput::DataSource::list sources(const TileSet::list &sets)
 {
     MeshOpInput::DataSource::list out;
     for (const auto &set : sets) {
-        out.push_back(tilesetDataSource(set.detail()));
+        out.push_back(std::make_shared<LockedDataSource>
+                      (tilesetDataSource(set.detail())));
     }
     return out;
 }
 
+std::size_t threadCount(std::size_t count)
+{
+    if (count) { return count; }
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/** Maximum number of processed tiles (per thread) waiting to be written to
+ *  the glue.
+ */
+const std::size_t MaxPendingPerThread(8);
+
 struct Merger {
 public:
     Merger(TileSet::Detail &glue
@@ -131,12 +207,15 @@ public:
         , src_(sources(srcSets)), top_(srcSets.back().detail())
         , topId_(src_.size() - 1), progress_(generate_.count())
         , options_(options)
+        , threadCount_(threadCount(options_.threadCount))
+        , maxPending_(threadCount_ * MaxPendingPerThread)
+        , pending_(), done_(false)
     {
         // make world complete
         world_.complete();
 
         // run
-        mergeTile(NodeInfo(glue_.referenceFrame));
+        run();
     }
 
 private:
@@ -153,13 +232,70 @@ private:
     };
     friend struct Constraints;
 
-    /** Merge subtree starting at index.
-     *  Calls itself recursively.
+    /** Single node of the processed tree.
+     *
+     *  Nodes are processed in parallel by worker threads. Processed tiles are
+     *  written to the glue by single thread in depth-first order, i.e. in the
+     *  same order as in the serial run.
      */
-    void mergeTile(const NodeInfo &nodeInfo
-                   , const TileId &tileId = TileId()
-                   , const merge::TileSource &parentSource
-                   = merge::TileSource());
+    struct Node {
+        typedef std::shared_ptr<Node> pointer;
+
+        Node(const NodeInfo &nodeInfo, const TileId &tileId
+             , const merge::TileSource &parentSource
+             , const std::string &order = std::string())
+            : nodeInfo(nodeInfo), tileId(tileId), parentSource(parentSource)
+            , order(order), generated(false), ready(false)
+        {}
+
+        NodeInfo nodeInfo;
+        TileId tileId;
+        merge::TileSource parentSource;
+
+        /** Depth-first order key: child indices along path from root.
+         */
+        std::string order;
+
+        /** Tile counts in the progress.
+         */
+        bool generated;
+
+        /** Generated tile, encoded by the worker.
+         */
+        boost::optional<PreparedTile> prepared;
+
+        std::vector<pointer> children;
+
+        /** Processing error, rethrown by the writer.
+         */
+        std::exception_ptr error;
+
+        /** Set when processed.
+         */
+        bool ready;
+
+        struct Later {
+            bool operator()(const pointer &l, const pointer &r) const {
+                return l->order > r->order;
+            }
+        };
+    };
+
+    /** Runs the merge: spawns worker threads and writes tiles.
+     */
+    void run();
+
+    /** Worker thread body: processes queued nodes.
+     */
+    void worker(std::size_t index);
+
+    /** Writes processed nodes to the glue in depth-first order.
+     */
+    void write(const Node::pointer &root);
+
+    /** Merge tile in given node and prepare its children.
+     */
+    void mergeTile(Node &node);
 
     /** Generates new tile as a merge of tiles from other tilesets.
      */
@@ -182,6 +318,30 @@ private:
     utility::Progress progress_;
 
     const GlueCreationOptions options_;
+
+    const std::size_t threadCount_;
+    const std::size_t maxPending_;
+
+    typedef std::unique_lock<std::mutex> Lock;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+
+    /** Nodes waiting to be processed, earliest in depth-first order first.
+     */
+    std::priority_queue<Node::pointer, std::vector<Node::pointer>
+                        , Node::Later> queue_;
+
+    /** Number of processed but not yet written nodes.
+     */
+    std::size_t pending_;
+
+    /** Node the writer waits for.
+     */
+    Node::pointer awaited_;
+
+    /** Tells workers to terminate.
+     */
+    bool done_;
 };
 
 inline bool Merger::isAlienTile(const merge::Output &tile) const
@@ -233,9 +393,128 @@ inline bool Merger::isGlueTile(const merge::Output &tile) const
     return false;
 }
 
-void Merger::mergeTile(const NodeInfo &nodeInfo, const TileId &tileId
-                       , const merge::TileSource &parentSource)
+void Merger::run()
+{
+    LOG(info2) << "(glue) Generating tiles in " << threadCount_
+               << " thread(s).";
+
+    auto root(std::make_shared<Node>(NodeInfo(glue_.referenceFrame)
+                                     , TileId(), merge::TileSource()));
+    queue_.push(root);
+
+    std::vector<std::thread> workers;
+    auto stop([&]()
+    {
+        {
+            Lock lock(mutex_);
+            done_ = true;
+        }
+        cond_.notify_all();
+        for (auto &worker : workers) { worker.join(); }
+    });
+
+    try {
+        for (std::size_t i(0); i < threadCount_; ++i) {
+            workers.emplace_back(&Merger::worker, this, i);
+        }
+
+        write(root);
+    } catch (...) {
+        stop();
+        throw;
+    }
+
+    stop();
+}
+
+void Merger::worker(std::size_t index)
+{
+    dbglog::thread_id(str(boost::format("glue:%u") % index));
+
+    for (;;) {
+        Node::pointer node;
+        {
+            Lock lock(mutex_);
+            cond_.wait(lock, [&]()
+            {
+                // NB: node awaited by the writer is always processed even
+                // if there are too many pending nodes; such node is either
+                // being processed or is at the top of the queue
+                return (done_
+                        || (!queue_.empty()
+                            && ((pending_ < maxPending_)
+                                || (queue_.top() == awaited_))));
+            });
+            if (done_) { return; }
+
+            node = queue_.top();
+            queue_.pop();
+        }
+
+        try {
+            mergeTile(*node);
+        } catch (...) {
+            node->children.clear();
+            node->error = std::current_exception();
+        }
+
+        {
+            Lock lock(mutex_);
+            node->ready = true;
+            ++pending_;
+            for (const auto &child : node->children) { queue_.push(child); }
+        }
+        cond_.notify_all();
+    }
+}
+
+void Merger::write(const Node::pointer &root)
 {
+    // depth-first traversal, children are pushed in reverse order
+    std::vector<Node::pointer> stack{ root };
+
+    while (!stack.empty()) {
+        auto node(stack.back());
+        stack.pop_back();
+
+        {
+            Lock lock(mutex_);
+            if (!node->ready) {
+                awaited_ = node;
+                cond_.notify_all();
+                cond_.wait(lock, [&]() { return node->ready; });
+                awaited_.reset();
+            }
+            --pending_;
+        }
+        cond_.notify_all();
+
+        if (node->error) { std::rethrow_exception(node->error); }
+
+        if (node->prepared) {
+            // place tile to glue
+            glue_.commitTile(*node->prepared);
+            node->prepared = boost::none;
+        }
+
+        if (node->generated) {
+            (++progress_).report(utility::Progress::ratio_t(5, 1000)
+                                 , "(glue) ");
+            if (options_.progress) { options_.progress->tile(); }
+        }
+
+        stack.insert(stack.end(), node->children.rbegin()
+                     , node->children.rend());
+        // release subtree, it is held by the stack now
+        node->children.clear();
+    }
+}
+
+void Merger::mergeTile(Node &node)
+{
+    const auto &nodeInfo(node.nodeInfo);
+    const auto &tileId(node.tileId);
+
     if (!nodeInfo.valid() || !world_.exists(tileId)) {
         // no data here and below
         return;
@@ -249,21 +528,18 @@ void Merger::mergeTile(const NodeInfo &nodeInfo, const TileId &tileId
 
     auto descend([&](const merge::TileSource &source)
     {
-        if (g) {
-            (++progress_).report(utility::Progress::ratio_t(5, 1000)
-                                 , "(glue) ");
-            if (options_.progress) { options_.progress->tile(); }
-        }
+        node.generated = g;
 
         // do not descent if we are at the bottom
         if (atBottom) { return; }
 
-        // remove this tile from thread name
-        tg.pop();
-
-        // this tile is processed, go after children
+        // this tile is processed, go after children; each child gets its own
+        // copy of source since inputs are loaded lazily
         for (const auto &child : children(tileId)) {
-            mergeTile(nodeInfo.child(child), child, source);
+            node.children.push_back
+                (std::make_shared<Node>
+                 (nodeInfo.child(child), child, source
+                  , node.order + char('0' + child.index)));
         }
     });
 
@@ -280,22 +556,24 @@ void Merger::mergeTile(const NodeInfo &nodeInfo, const TileId &tileId
     if (!nodeInfo.productive()) {
         // unproductive node, immediately descend
         // forward parent source
-        descend(parentSource);
+        descend(node.parentSource);
         return;
     }
 
     const bool ng(navtileGenerate_.exists(tileId));
 
     // process tile
-    auto tile(processTile(nodeInfo, tileId, parentSource
-                              , Constraints(*this, g, ng)));
+    auto tile(processTile(nodeInfo, tileId, node.parentSource
+                          , Constraints(*this, g, ng)));
+
+    // parent source is not needed anymore
+    node.parentSource = merge::TileSource();
 
     if (tile) {
-        // place tile to glue
-        glue_.setTile(tileId
-                      , tile.tile(options_.textureQuality)
-                      .setAlien(isAlienTile(tile))
-                      , &nodeInfo);
+        // encode tile for the writer
+        node.prepared = glue_.prepareTile
+            (tileId, tile.tile(options_.textureQuality)
+             .setAlien(isAlienTile(tile)), &nodeInfo);
     }
 
     // this tile is processed, go after children
@@ -799,11 +799,11 @@ Output singleSourced(const TileId &tileId, const NodeInfo &nodeInfo
 
     // clip source mesh/navtile
 
-    CsConvertor phys2sd;
-    if (!extraOptions.meshesInSds) {
-        phys2sd = CsConvertor(nodeInfo.referenceFrame().model.physicalSrs
-                              , nodeInfo.srs());
-    }
+    const auto &phys2sd
+        (extraOptions.meshesInSds
+         ? CsConvertor::noop()
+         : cachedCsConvertor(nodeInfo.referenceFrame().model.physicalSrs
+                             , nodeInfo.srs()));
 
     const auto coverageVertices
         (inputCoverageVertices
@@ -1068,11 +1068,11 @@ Output mergeTile(const TileId &tileId
     }
 
     // merge meshes
-    CsConvertor phys2sd;
-    if (!extraOptions.meshesInSds) {
-        phys2sd = CsConvertor(nodeInfo.referenceFrame().model.physicalSrs
-                              , nodeInfo.srs());
-    }
+    const auto &phys2sd
+        (extraOptions.meshesInSds
+         ? CsConvertor::noop()
+         : cachedCsConvertor(nodeInfo.referenceFrame().model.physicalSrs
+                             , nodeInfo.srs()));
 
     // process all input tiles from result source (i.e. only those contributing
     // to the tile)
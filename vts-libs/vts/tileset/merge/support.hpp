@@ -121,8 +121,9 @@ private:
     math::Matrix4 geoTrafo_;
 
     /** Convertor between node's SD SRS and reference frame's physical SRS.
+     *  Thread-local cached convertor.
      */
-    CsConvertor geoConv_;
+    const CsConvertor &geoConv_;
 
     /** Converts external texture coordinates between fallback tile and current
      *  tile.
@@ -186,9 +187,9 @@ inline SdMeshConvertor::SdMeshConvertor(const NodeInfo &nodeInfo
                                         , bool meshesInSds)
     : geoTrafo_(Input::coverage2Sd(nodeInfo, margin))
     , geoConv_(meshesInSds
-               ? CsConvertor()
-               : CsConvertor(nodeInfo.srs()
-                             , nodeInfo.referenceFrame().model.physicalSrs))
+               ? CsConvertor::noop()
+               : cachedCsConvertor
+               (nodeInfo.srs(), nodeInfo.referenceFrame().model.physicalSrs))
     , etcNCTrafo_(etcNCTrafo(tileId))
     , coverage2Texture_(Input::coverage2Texture(margin))
 {}
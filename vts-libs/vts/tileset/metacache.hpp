@@ -38,6 +38,45 @@
 
 namespace vtslibs { namespace vts {
 
+/** Metatile cache statistics.
+ */
+struct MetaCacheStats {
+    /** Number of metatiles held in memory.
+     */
+    std::size_t resident;
+
+    /** Approximate memory occupied by resident metatiles (in bytes).
+     */
+    std::size_t memory;
+
+    /** Number of metatiles evicted from memory (to spill storage, if any).
+     */
+    std::size_t evicted;
+
+    /** Number of metatile writes to spill storage. Read-only cache spills
+     *  metatiles into packed in-memory form.
+     */
+    std::size_t spills;
+
+    /** Number of metatile reloads from spill storage.
+     */
+    std::size_t reloads;
+
+    /** Number of resident metatiles held in packed form.
+     */
+    std::size_t packed;
+
+    MetaCacheStats()
+        : resident(), memory(), evicted(), spills(), reloads(), packed()
+    {}
+};
+
+/** Metatile cache.
+ *
+ *  Read-only implementations are safe for concurrent use. Metatiles may be
+ *  evicted at any time, so users must keep the returned pointer while they
+ *  use the metatile's nodes.
+ */
 class MetaCache {
 public:
     virtual ~MetaCache();
@@ -48,13 +87,37 @@ public:
 
     virtual void save() = 0;
 
-    static std::unique_ptr<MetaCache> create(const Driver::pointer &driver);
+    virtual MetaCacheStats stats() const { return {}; }
+
+    /** Creates metatile cache suitable for given driver.
+     *
+     * \param driver tileset driver
+     * \param binaryOrder metatile binary order (reference frame's
+     *                    metaBinaryOrder)
+     */
+    static std::unique_ptr<MetaCache> create(const Driver::pointer &driver
+                                             , std::uint8_t binaryOrder);
+
+    /** Memory budget (in bytes) of read-only metatile cache. The budget is
+     *  shared by all open read-only tilesets in the process.
+     */
+    static void readOnlyLimit(std::size_t limit);
+    static std::size_t readOnlyLimit();
+
+    /** Statistics of whole read-only metatile cache.
+     */
+    static MetaCacheStats readOnlyStats();
+
+    /** Statistics of metatiles cached for given driver.
+     */
+    static MetaCacheStats readOnlyStats(const Driver &driver);
 
 protected:
     MetaCache(const Driver::pointer &driver) : driver_(driver) {}
 
     static std::unique_ptr<MetaCache> ro(const Driver::pointer &driver);
-    static std::unique_ptr<MetaCache> rw(const Driver::pointer &driver);
+    static std::unique_ptr<MetaCache> rw(const Driver::pointer &driver
+                                         , std::uint8_t binaryOrder);
     static std::unique_ptr<MetaCache>
     roScarceMemory(const Driver::pointer &driver);
 
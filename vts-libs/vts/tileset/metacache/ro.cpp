@@ -23,15 +23,14 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
-#include <atomic>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/mem_fun.hpp>
-
-#include "utility/time.hpp"
+#include <boost/noncopyable.hpp>
+#include <boost/functional/hash.hpp>
 
 #include "../../../storage/error.hpp"
 
@@ -40,131 +39,525 @@
 namespace vtslibs { namespace vts {
 
 namespace limit {
-std::size_t ReadOnlyMetatileLimit(1000);
-std::atomic<std::size_t> roMetatiles(0);
+/** Maximum number of metatiles held in the shared read-only store, applied in
+ *  addition to its memory budget. Zero (default) means no limit, i.e. store
+ *  is bounded by its memory budget only.
+ */
+std::size_t ReadOnlyMetatileLimit(0);
 } // namespace limit
 
 namespace detail {
 
 namespace {
 
-typedef decltype(utility::usecFromEpoch()) Time;
-const Time MaxTime(std::numeric_limits<Time>::max());
-
-struct Record {
-    Record(const MetaTile::pointer &metatile)
-        : metaId(metatile->origin()), lastHit(utility::usecFromEpoch())
-        , metatile(metatile)
-    {}
+/** Default memory budget of shared read-only metatile cache: 1 GiB
+ */
+const std::size_t DefaultReadOnlyLimit(1ul << 30);
 
-    void hit() { lastHit = utility::usecFromEpoch(); }
+/** Number of credit sets after which the store starts a new credit pool. Old
+ *  pool is released with the last packed metatile using it.
+ */
+const std::size_t MaxPooledCreditSets(1 << 16);
 
+struct MetaKey {
+    const Driver *driver;
     TileId metaId;
-    Time lastHit;
-    MetaTile::pointer metatile;
-};
 
-struct MetaIdx {};
-struct LastHitIdx {};
-
-typedef boost::multi_index_container<
-    Record
-    , boost::multi_index::indexed_by<
-          boost::multi_index::ordered_unique
-          <boost::multi_index::tag<MetaIdx>
-           , BOOST_MULTI_INDEX_MEMBER
-           (Record, decltype(Record::metaId), metaId)>
-          , boost::multi_index::ordered_non_unique
-          <boost::multi_index::tag<LastHitIdx>
-           , BOOST_MULTI_INDEX_MEMBER
-           (Record, decltype(Record::lastHit), lastHit)>
-          >
-    > Map;
+    MetaKey(const Driver *driver, const TileId &metaId)
+        : driver(driver), metaId(metaId)
+    {}
 
-} // namespace
+    bool operator==(const MetaKey &o) const {
+        return (driver == o.driver) && (metaId == o.metaId);
+    }
+};
 
-class RoMetaCache : public MetaCache {
+struct MetaKeyHash {
+    std::size_t operator()(const MetaKey &key) const {
+        std::size_t seed(0);
+        boost::hash_combine(seed, key.driver);
+        boost::hash_combine(seed, key.metaId.lod);
+        boost::hash_combine(seed, key.metaId.x);
+        boost::hash_combine(seed, key.metaId.y);
+        return seed;
+    }
+};
+
+/** Process-wide store of read-only metatiles.
+ *
+ *  All open read-only tilesets share one memory budget. Metatiles are kept in
+ *  a ring walked by CLOCK hand: hit only sets reference bit and eviction
+ *  clears bits until it finds unreferenced entry, i.e. everything is O(1)
+ *  (amortized for eviction).
+ *
+ *  Unreferenced metatile is first spilled into packed form (PackedMetaTile,
+ *  credit sets interned in pool shared by whole store) and stays in the
+ *  ring; it is dropped only if it is not hit before the hand comes again.
+ *  Hit of packed metatile unpacks it back. Victims are picked under the
+ *  lock, packed outside it and published under the lock again. Credit pool
+ *  is replaced by a fresh one once it grows too big.
+ *
+ *  Metatiles are keyed by driver so tilesets sharing one driver share its
+ *  metatiles as well.
+ */
+class SharedStore : boost::noncopyable {
 public:
-    RoMetaCache(const Driver::pointer &driver)
-        : MetaCache(driver)
-    {
-        LOG(info1) << "RoMetaCache(" << driver->info() << ")";
+    static SharedStore& instance() {
+        static SharedStore store;
+        return store;
     }
 
-    MetaTile::pointer add(const MetaTile::pointer &metatile) {
-        Record record(metatile);
-        auto res(map_.insert(record));
-        if (!res.second) {
-            map_.replace(res.first, record);
+    void attach(const Driver *driver);
+    void detach(const Driver *driver);
+
+    MetaTile::pointer find(const Driver *driver, const TileId &metaId);
+    void add(const Driver *driver, const MetaTile::pointer &metatile);
+    void purge(const Driver *driver);
+
+    void limit(std::size_t limit);
+    std::size_t limit() const;
+
+    MetaCacheStats stats() const;
+    MetaCacheStats stats(const Driver *driver) const;
+
+private:
+    SharedStore()
+        : limit_(DefaultReadOnlyLimit), hand_(ring_.end()), spilling_()
+        , pool_(std::make_shared<PackedMetaTile::CreditPool>())
+    {}
+
+    struct Entry {
+        MetaKey key;
+
+        /** Metatile, null if spilled.
+         */
+        MetaTile::pointer metatile;
+
+        /** Packed metatile, valid only if spilled.
+         */
+        PackedMetaTile::pointer packed;
+
+        std::size_t memory;
+        bool referenced;
+
+        /** Picked for spill, being packed outside of the lock.
+         */
+        bool spilling;
+
+        Entry(const MetaKey &key, const MetaTile::pointer &metatile)
+            : key(key), metatile(metatile), memory(metatile->memory())
+            , referenced(true), spilling(false)
+        {}
+    };
+
+    /** Metatile picked for spill.
+     */
+    struct Spill {
+        MetaKey key;
+        MetaTile::pointer metatile;
+        PackedMetaTile::pointer packed;
+
+        Spill(const MetaKey &key, const MetaTile::pointer &metatile)
+            : key(key), metatile(metatile)
+        {}
+    };
+
+    typedef std::vector<Spill> Spills;
+
+    typedef std::list<Entry> Ring;
+
+    /** Per-driver accounting.
+     */
+    struct Owner {
+        std::size_t users;
+        MetaCacheStats stats;
+
+        Owner() : users() {}
+    };
+
+    /** Removes entry from the store, returns next entry in the ring.
+     */
+    Ring::iterator drop(Ring::iterator ientry, bool evicted);
+
+    /** Fits store into the budget: evicts entries and spills victims
+     *  picked by shrink(). Called and returns with lock held, lock is
+     *  released while packing.
+     */
+    void balance(std::unique_lock<std::mutex> &lock);
+
+    /** Evicts entries until memory and metatile count fit in the budget.
+     *  Entries to be spilled are only marked and added to spills.
+     */
+    void shrink(Spills &spills);
+
+    /** Replaces entry's metatile with its packed form.
+     */
+    void spill(Entry &entry, const PackedMetaTile::pointer &packed);
+
+    /** Returns credit pool for new packed metatiles.
+     */
+    PackedMetaTile::CreditPool::pointer pool();
+
+    /** Replaces spilled entry's packed metatile with unpacked one.
+     */
+    void reload(Entry &entry, const MetaTile::pointer &metatile);
+
+    /** Updates memory accounting of given entry.
+     */
+    void account(Entry &entry, std::size_t memory);
+
+    MetaCacheStats* owner(const Driver *driver);
+
+    mutable std::mutex mutex_;
+    std::size_t limit_;
+    Ring ring_;
+    Ring::iterator hand_;
+    std::unordered_map<MetaKey, Ring::iterator, MetaKeyHash> index_;
+    std::map<const Driver*, Owner> owners_;
+    MetaCacheStats stats_;
+
+    /** Memory of entries being spilled.
+     */
+    std::size_t spilling_;
+
+    PackedMetaTile::CreditPool::pointer pool_;
+};
+
+void SharedStore::attach(const Driver *driver)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++owners_[driver].users;
+}
+
+void SharedStore::detach(const Driver *driver)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto fowners(owners_.find(driver));
+    if ((fowners == owners_.end()) || --fowners->second.users) { return; }
+
+    // last user gone, driver can be destroyed and its address reused
+    for (auto iring(ring_.begin()); iring != ring_.end(); ) {
+        if (iring->key.driver == driver) {
+            iring = drop(iring, false);
         } else {
-            ++limit::roMetatiles;
+            ++iring;
         }
+    }
+    owners_.erase(driver);
+}
 
-        // housekeeping, we want to keep found record
-        houseKeeping(&record.metaId);
+MetaTile::pointer SharedStore::find(const Driver *driver
+                                    , const TileId &metaId)
+{
+    const MetaKey key(driver, metaId);
+
+    PackedMetaTile::pointer packed;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto findex(index_.find(key));
+        if (findex == index_.end()) { return {}; }
+
+        auto &entry(*findex->second);
+        entry.referenced = true;
+        if (entry.metatile) { return entry.metatile; }
+        packed = entry.packed;
+    }
+
+    // spilled metatile, unpack outside of lock
+    auto metatile(std::make_shared<MetaTile>(packed->unpack()));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto findex(index_.find(key));
+    if (findex == index_.end()) {
+        // dropped in the meantime, unpacked metatile is still valid
         return metatile;
     }
 
-    MetaTile::pointer find(const TileId &metaId) {
-        auto fmap(map_.find(metaId));
-        if (fmap != map_.end()) {
-            hit(map_, fmap);
-            return fmap->metatile;
+    auto &entry(*findex->second);
+    if (entry.metatile) {
+        // someone else was faster
+        return entry.metatile;
+    }
+
+    reload(entry, metatile);
+    balance(lock);
+    return metatile;
+}
+
+void SharedStore::add(const Driver *driver
+                      , const MetaTile::pointer &metatile)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    const MetaKey key(driver, metatile->origin());
+
+    auto findex(index_.find(key));
+    if (findex != index_.end()) {
+        // replace existing entry
+        drop(findex->second, false);
+    }
+
+    // insert just behind the hand -> visited last
+    auto ientry(ring_.emplace(hand_, key, metatile));
+    index_.emplace(key, ientry);
+
+    const auto memory(ientry->memory);
+    stats_.memory += memory;
+    ++stats_.resident;
+
+    auto &owner(owners_[driver].stats);
+    owner.memory += memory;
+    ++owner.resident;
+
+    balance(lock);
+}
+
+void SharedStore::purge(const Driver *driver)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto iring(ring_.begin()); iring != ring_.end(); ) {
+        if (iring->key.driver == driver) {
+            iring = drop(iring, false);
+        } else {
+            ++iring;
         }
-        return {};
     }
+}
 
-    void clear() {
-        limit::roMetatiles -= map_.size();
-        map_.clear();
+MetaCacheStats* SharedStore::owner(const Driver *driver)
+{
+    auto fowners(owners_.find(driver));
+    if (fowners == owners_.end()) { return nullptr; }
+    return &fowners->second.stats;
+}
+
+void SharedStore::account(Entry &entry, std::size_t memory)
+{
+    stats_.memory -= entry.memory;
+    stats_.memory += memory;
+    if (auto *owner = this->owner(entry.key.driver)) {
+        owner->memory -= entry.memory;
+        owner->memory += memory;
     }
+    entry.memory = memory;
+}
 
-    void save() {
-        LOGTHROW(err1, storage::ReadOnlyError)
-            << "Cannot save metatile from read-only cache.";
+PackedMetaTile::CreditPool::pointer SharedStore::pool()
+{
+    if (pool_->size() >= MaxPooledCreditSets) {
+        LOG(info1) << "Starting new credit pool of read-only metatile cache.";
+        pool_ = std::make_shared<PackedMetaTile::CreditPool>();
     }
+    return pool_;
+}
 
-private:
-    void houseKeeping(const TileId *keep = nullptr);
+void SharedStore::spill(Entry &entry, const PackedMetaTile::pointer &packed)
+{
+    LOG(debug) << "Spilling metatile " << entry.key.metaId
+               << " into packed form.";
+
+    entry.packed = packed;
+    entry.metatile.reset();
+    account(entry, entry.packed->memory());
+
+    ++stats_.spills;
+    ++stats_.packed;
+    if (auto *owner = this->owner(entry.key.driver)) {
+        ++owner->spills;
+        ++owner->packed;
+    }
+}
+
+void SharedStore::reload(Entry &entry, const MetaTile::pointer &metatile)
+{
+    entry.metatile = metatile;
+    entry.packed.reset();
+    account(entry, metatile->memory());
+
+    ++stats_.reloads;
+    --stats_.packed;
+    if (auto *owner = this->owner(entry.key.driver)) {
+        ++owner->reloads;
+        --owner->packed;
+    }
+}
 
-    template <typename Idx, typename Iterator>
-    inline void hit(Idx &idx, Iterator iterator) {
-        idx.modify(iterator, [](Record &r) { r.hit(); });
+SharedStore::Ring::iterator SharedStore::drop(Ring::iterator ientry
+                                              , bool evicted)
+{
+    const auto &entry(*ientry);
+
+    if (entry.spilling) { spilling_ -= entry.memory; }
+    stats_.memory -= entry.memory;
+    --stats_.resident;
+    if (entry.packed) { --stats_.packed; }
+
+    if (auto *owner = this->owner(entry.key.driver)) {
+        owner->memory -= entry.memory;
+        --owner->resident;
+        if (entry.packed) { --owner->packed; }
+        if (evicted) { ++owner->evicted; }
     }
+    if (evicted) { ++stats_.evicted; }
 
-    Map map_;
-};
+    index_.erase(entry.key);
+
+    auto next(ring_.erase(ientry));
+    if (hand_ == ientry) { hand_ = next; }
+    return next;
+}
 
-void RoMetaCache::houseKeeping(const TileId *keep)
+void SharedStore::balance(std::unique_lock<std::mutex> &lock)
 {
-    if (limit::roMetatiles <= limit::ReadOnlyMetatileLimit) {
-        return;
+    Spills spills;
+    shrink(spills);
+    if (spills.empty()) { return; }
+
+    // pack outside of the lock
+    const auto pool(this->pool());
+    lock.unlock();
+    for (auto &spill : spills) {
+        try {
+            spill.packed = std::make_shared<PackedMetaTile>
+                (*spill.metatile, pool);
+        } catch (const std::exception &e) {
+            LOG(warn2) << "Unable to pack metatile " << spill.key.metaId
+                       << ": <" << e.what() << ">.";
+        }
+    }
+    lock.lock();
+
+    // publish
+    for (const auto &spill : spills) {
+        auto findex(index_.find(spill.key));
+        if (findex == index_.end()) { continue; }
+
+        auto &entry(*findex->second);
+        if (!entry.spilling || (entry.metatile != spill.metatile)) {
+            // dropped (and maybe re-added) in the meantime
+            continue;
+        }
+
+        entry.spilling = false;
+        spilling_ -= entry.memory;
+
+        // keep metatile hit in the meantime unpacked
+        if (spill.packed && !entry.referenced) {
+            this->spill(entry, spill.packed);
+        }
     }
+}
+
+void SharedStore::shrink(Spills &spills)
+{
+    const auto tooMany([this]() -> bool
+    {
+        return (limit::ReadOnlyMetatileLimit
+                && (stats_.resident > limit::ReadOnlyMetatileLimit));
+    });
+
+    // memory of metatiles being spilled is as good as released
+    const auto over([&]() -> bool
+    {
+        return ((stats_.memory - spilling_) > limit_) || tooMany();
+    });
 
-    auto &idx(map_.get<LastHitIdx>());
+    while (over() && !ring_.empty()) {
+        if (hand_ == ring_.end()) { hand_ = ring_.begin(); }
 
-    int toDrop(5);
-    for (auto iidx(idx.begin()); toDrop && (iidx != idx.end()); ) {
-        // skip keep tile
-        if (keep && (iidx->metaId == *keep)) {
-            LOG(debug) << "Metatile " << iidx->metaId
-                       << " must be kept in the cache.";
-            ++iidx;
+        if (hand_->referenced) {
+            // second chance
+            hand_->referenced = false;
+            ++hand_;
             continue;
         }
 
-        // no changes -> we are free to remove the file
-        LOG(debug) << "Removing metatile "
-                   << iidx->metaId << '/' << iidx->lastHit
-                   << " from the cache.";
+        if (hand_->metatile && !tooMany()) {
+            // over memory budget only: keep packed for one more round
+            if (!hand_->spilling) {
+                hand_->spilling = true;
+                spilling_ += hand_->memory;
+                spills.emplace_back(hand_->key, hand_->metatile);
+            }
+            ++hand_;
+            continue;
+        }
 
-        iidx = idx.erase(iidx);
-        --toDrop;
-        --limit::roMetatiles;
-        break;
+        LOG(debug) << "Evicting metatile " << hand_->key.metaId
+                   << " from the read-only cache.";
+        hand_ = drop(hand_, true);
     }
 }
 
+void SharedStore::limit(std::size_t limit)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    limit_ = limit;
+    balance(lock);
+}
+
+std::size_t SharedStore::limit() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return limit_;
+}
+
+MetaCacheStats SharedStore::stats() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+MetaCacheStats SharedStore::stats(const Driver *driver) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto fowners(owners_.find(driver));
+    if (fowners == owners_.end()) { return {}; }
+    return fowners->second.stats;
+}
+
+} // namespace
+
+/** Read-only metatile cache backed by process-wide shared store.
+ */
+class RoMetaCache : public MetaCache {
+public:
+    RoMetaCache(const Driver::pointer &driver)
+        : MetaCache(driver), store_(SharedStore::instance())
+    {
+        LOG(info1) << "RoMetaCache(" << driver->info() << ")";
+        store_.attach(driver_.get());
+    }
+
+    ~RoMetaCache() {
+        store_.detach(driver_.get());
+    }
+
+    MetaTile::pointer add(const MetaTile::pointer &metatile) {
+        store_.add(driver_.get(), metatile);
+        return metatile;
+    }
+
+    MetaTile::pointer find(const TileId &metaId) {
+        return store_.find(driver_.get(), metaId);
+    }
+
+    void clear() {
+        store_.purge(driver_.get());
+    }
+
+    void save() {
+        LOGTHROW(err1, storage::ReadOnlyError)
+            << "Cannot save metatile from read-only cache.";
+    }
+
+    MetaCacheStats stats() const {
+        return store_.stats(driver_.get());
+    }
+
+private:
+    SharedStore &store_;
+};
+
 /** Scarce memory implementation.
  *  Read-only version, holds only one metatile per lod.
  */
@@ -183,11 +576,13 @@ private:
     virtual void save();
 
     typedef std::vector<MetaTile::pointer> MetaTileCache;
+    std::mutex mutex_;
     MetaTileCache cache_;
 };
 
 MetaTile::pointer RoMetaCacheSM::add(const MetaTile::pointer &metatile)
 {
+    std::unique_lock<std::mutex> lock(mutex_);
     const auto &metaId(metatile->origin());
     if (metaId.lod >= cache_.size()) {
         // make room
@@ -199,6 +594,7 @@ MetaTile::pointer RoMetaCacheSM::add(const MetaTile::pointer &metatile)
 
 MetaTile::pointer RoMetaCacheSM::find(const TileId &metaId)
 {
+    std::unique_lock<std::mutex> lock(mutex_);
     if (metaId.lod >= cache_.size()) { return {};}
     const auto &mt(cache_[metaId.lod]);
     if (mt && (mt->origin() == metaId)) { return mt; }
@@ -207,6 +603,7 @@ MetaTile::pointer RoMetaCacheSM::find(const TileId &metaId)
 
 void RoMetaCacheSM::clear()
 {
+    std::unique_lock<std::mutex> lock(mutex_);
     cache_.clear();
 }
 
@@ -220,16 +617,16 @@ void RoMetaCacheSM::save()
 
 MetaCache::~MetaCache() {}
 
-std::unique_ptr<MetaCache> MetaCache::create(const Driver::pointer &driver)
+std::unique_ptr<MetaCache> MetaCache::create(const Driver::pointer &driver
+                                             , std::uint8_t binaryOrder)
 {
     if (driver->readOnly()) {
         if (driver->openOptions().scarceMemory()) {
             return roScarceMemory(driver);
         }
-        // we are using rw cache implementation due to performance reasons
-        return rw(driver);
+        return ro(driver);
     }
-    return rw(driver);
+    return rw(driver, binaryOrder);
 }
 
 std::unique_ptr<MetaCache> MetaCache::ro(const Driver::pointer &driver)
@@ -238,6 +635,26 @@ std::unique_ptr<MetaCache> MetaCache::ro(const Driver::pointer &driver)
         (new detail::RoMetaCache(driver));
 }
 
+void MetaCache::readOnlyLimit(std::size_t limit)
+{
+    detail::SharedStore::instance().limit(limit);
+}
+
+std::size_t MetaCache::readOnlyLimit()
+{
+    return detail::SharedStore::instance().limit();
+}
+
+MetaCacheStats MetaCache::readOnlyStats()
+{
+    return detail::SharedStore::instance().stats();
+}
+
+MetaCacheStats MetaCache::readOnlyStats(const Driver &driver)
+{
+    return detail::SharedStore::instance().stats(&driver);
+}
+
 std::unique_ptr<MetaCache>
 MetaCache::roScarceMemory(const Driver::pointer &driver)
 {
@@ -24,10 +24,17 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <map>
+#include <list>
+#include <set>
+
+#include <boost/filesystem.hpp>
 
 #include "dbglog/dbglog.hpp"
 
 #include "../metacache.hpp"
+#include "../driver/cache.hpp"
+
+namespace fs = boost::filesystem;
 
 namespace vtslibs { namespace vts {
 
@@ -35,40 +42,85 @@ namespace detail {
 
 namespace {
 
-typedef std::map<TileId, MetaTile::pointer> Map;
+/** Binary order of spill storage archives.
+ */
+const std::uint8_t SpillBinaryOrder(5);
 
 } // namespace
 
+/** Read-write metatile cache.
+ *
+ *  Holds all metatiles in memory unless memory limit is set. With memory
+ *  limit, least recently used metatiles not referenced from outside of the
+ *  cache are spilled into temporary tilar storage and transparently reloaded
+ *  when asked for again. All metatiles (resident or spilled) are written to
+ *  the driver in save().
+ */
 class RwMetaCache : public MetaCache {
 public:
-    RwMetaCache(const Driver::pointer &driver)
-        : MetaCache(driver)
+    RwMetaCache(const Driver::pointer &driver, std::uint8_t binaryOrder
+                , std::size_t limit)
+        : MetaCache(driver), limit_(limit), binaryOrder_(binaryOrder)
     {
-        LOG(info1) << "RwMetaCache(" << driver->info() << ")";
+        LOG(info1) << "RwMetaCache(" << driver->info() << ", limit="
+                   << limit_ << ")";
     }
 
+    virtual ~RwMetaCache() { dropSpill(); }
+
     virtual MetaTile::pointer add(const MetaTile::pointer &metatile) {
-        auto res(map_.insert
-                 (Map::value_type (metatile->origin(), metatile)));
-        if (!res.second) {
-            res.first->second = metatile;
+        const auto &metaId(metatile->origin());
+
+        // new version supersedes spilled one
+        evicted_.erase(metaId);
+
+        auto fmap(map_.find(metaId));
+        if (fmap != map_.end()) {
+            auto &record(fmap->second);
+            stats_.memory -= record.memory;
+            record.metatile = metatile;
+            record.memory = metatile->memory();
+            stats_.memory += record.memory;
+            touch(record);
+        } else {
+            insert(metatile);
         }
-        return res.first->second;
+
+        houseKeeping(metaId);
+        return metatile;
     }
 
     virtual MetaTile::pointer find(const TileId &metaId) {
         auto fmap(map_.find(metaId));
-        if (fmap != map_.end()) { return fmap->second; }
-        return {};
+        if (fmap != map_.end()) {
+            touch(fmap->second);
+            return fmap->second.metatile;
+        }
+
+        if (!evicted_.count(metaId)) { return {}; }
+
+        // reload spilled metatile
+        auto is(spill_->input(metaId, TileFile::meta));
+        auto metatile(loadMetaTile(&is->get(), binaryOrder_, is->name()));
+        evicted_.erase(metaId);
+        ++stats_.reloads;
+        insert(metatile);
+
+        houseKeeping(metaId);
+        return metatile;
     }
 
     virtual void clear() {
         map_.clear();
+        lru_.clear();
+        evicted_.clear();
+        stats_.memory = 0;
+        dropSpill();
     }
 
     virtual void save() {
         for (const auto &item : map_) {
-            const auto &meta(*item.second);
+            const auto &meta(*item.second.metatile);
             auto tileId(meta.origin());
             LOG(info1) << "Saving: " << tileId;
 
@@ -77,17 +129,152 @@ public:
             meta.save(*f);
             f->close();
         }
+
+        for (const auto &tileId : evicted_) {
+            LOG(info1) << "Saving spilled: " << tileId;
+            copyFile(spill_->input(tileId, TileFile::meta)
+                     , driver_->output(tileId, TileFile::meta));
+        }
+
+        const auto s(stats());
+        LOG(info2) << "Metatile cache: " << s.resident << " resident ("
+                   << s.memory << " bytes), " << s.evicted
+                   << " evicted, " << s.spills << " spills, " << s.reloads
+                   << " reloads.";
+    }
+
+    virtual MetaCacheStats stats() const {
+        auto stats(stats_);
+        stats.resident = map_.size();
+        stats.evicted = evicted_.size();
+        return stats;
     }
 
 private:
+    typedef std::list<TileId> Lru;
+
+    struct Record {
+        MetaTile::pointer metatile;
+        std::size_t memory;
+        Lru::iterator lru;
+    };
+
+    typedef std::map<TileId, Record> Map;
+
+    void insert(const MetaTile::pointer &metatile) {
+        const auto &metaId(metatile->origin());
+        lru_.push_front(metaId);
+        const Record record{ metatile, metatile->memory(), lru_.begin() };
+        map_.insert(Map::value_type(metaId, record));
+        stats_.memory += record.memory;
+    }
+
+    void touch(Record &record) {
+        lru_.splice(lru_.begin(), lru_, record.lru);
+    }
+
+    /** Spills least recently used metatiles until memory fits in the limit.
+     *  Metatiles referenced from outside of the cache are kept.
+     */
+    void houseKeeping(const TileId &keep);
+
+    void spill(Map::iterator fmap);
+
+    void dropSpill();
+
+    const std::size_t limit_;
+
+    /** Metatile binary order, needed to reload spilled metatiles.
+     */
+    const std::uint8_t binaryOrder_;
+
     Map map_;
+    Lru lru_;
+
+    /** Spilled metatiles.
+     */
+    std::set<TileId> evicted_;
+
+    /** Spill storage path and storage itself; created on demand.
+     */
+    fs::path spillPath_;
+    std::unique_ptr<driver::Cache> spill_;
+
+    MetaCacheStats stats_;
 };
 
+void RwMetaCache::houseKeeping(const TileId &keep)
+{
+    if (!limit_ || (stats_.memory <= limit_)) { return; }
+
+    // walk from the least recently used, each record visited once
+    auto ilru(lru_.end());
+    for (auto steps(lru_.size()); steps && (stats_.memory > limit_); --steps)
+    {
+        --ilru;
+        auto fmap(map_.find(*ilru));
+        if ((*ilru == keep) || (fmap->second.metatile.use_count() > 1)) {
+            // kept or used outside of the cache
+            continue;
+        }
+
+        // move iterator before erasing the record
+        ++ilru;
+        spill(fmap);
+    }
+}
+
+void RwMetaCache::spill(Map::iterator fmap)
+{
+    if (!spill_) {
+        // temporary data, never inside the tileset
+        spillPath_ = fs::temp_directory_path()
+            / fs::unique_path("vts-metacache-%%%%-%%%%-%%%%");
+        LOG(info2) << "Spilling metatiles to " << spillPath_ << ".";
+        spill_.reset(new driver::Cache
+                     (spillPath_, driver::PlainOptions(SpillBinaryOrder)
+                      , false));
+    }
+
+    const auto &metaId(fmap->first);
+    auto &record(fmap->second);
+
+    auto f(spill_->output(metaId, TileFile::meta));
+    record.metatile->save(*f);
+    f->close();
+
+    evicted_.insert(metaId);
+    ++stats_.spills;
+    stats_.memory -= record.memory;
+    lru_.erase(record.lru);
+    map_.erase(fmap);
+}
+
+void RwMetaCache::dropSpill()
+{
+    if (!spill_) { return; }
+
+    // uncommitted data are discarded
+    spill_.reset();
+
+    boost::system::error_code ec;
+    fs::remove_all(spillPath_, ec);
+    if (ec) {
+        LOG(warn2) << "Unable to remove metatile spill storage "
+                   << spillPath_ << ": <" << ec.message() << ">.";
+    }
+}
+
 } // namespace detail
 
-std::unique_ptr<MetaCache> MetaCache::rw(const Driver::pointer &driver)
+std::unique_ptr<MetaCache> MetaCache::rw(const Driver::pointer &driver
+                                         , std::uint8_t binaryOrder)
 {
-    return std::unique_ptr<MetaCache>(new detail::RwMetaCache(driver));
+    // read-only data can be always reloaded -> spilling makes no sense
+    const auto limit(driver->readOnly()
+                     ? 0 : driver->openOptions().metaCacheLimit());
+    return std::unique_ptr<MetaCache>
+        (new detail::RwMetaCache(driver, binaryOrder, limit));
 }
 
 } } // namespace vtslibs::vts
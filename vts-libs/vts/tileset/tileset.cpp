@@ -23,6 +23,8 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <sstream>
+
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/range/adaptor/reversed.hpp>
@@ -123,6 +125,23 @@ void TileSet::setTile(const TileId &tileId, const TileSource &tile
     detail().setTile(tileId, tile, &nodeInfo);
 }
 
+PreparedTile TileSet::prepareTile(const TileId &tileId, const Tile &tile)
+    const
+{
+    return detail().prepareTile(tileId, tile);
+}
+
+PreparedTile TileSet::prepareTile(const TileId &tileId, const Tile &tile
+                                  , const NodeInfo &nodeInfo) const
+{
+    return detail().prepareTile(tileId, tile, &nodeInfo);
+}
+
+void TileSet::commitTile(const PreparedTile &tile)
+{
+    detail().commitTile(tile);
+}
+
 void TileSet::setNavTile(const TileId &tileId, const NavTile &navtile)
 {
     detail().setNavTile(tileId, navtile);
@@ -151,6 +170,11 @@ const MetaNode* TileSet::getMetaNode(const TileId &tileId
     return node ? node.metanode : nullptr;
 }
 
+MetaNode::pointer TileSet::findMetaNode(const TileId &tileId) const
+{
+    return detail().findNode(tileId).pin();
+}
+
 MetaTile TileSet::getMetaTile(const TileId &metaId) const
 {
     auto mt(detail().findMetaTile(metaId));
@@ -244,7 +268,7 @@ GeomExtents geomExtents(const NodeInfo &ni, const Mesh &mesh)
 {
     // re-compute geom extents
     return geomExtents
-        (CsConvertor(ni.referenceFrame().model.physicalSrs, ni.srs())
+        (cachedCsConvertor(ni.referenceFrame().model.physicalSrs, ni.srs())
          , mesh);
 }
 
@@ -355,15 +379,28 @@ struct TileSet::Factory
         dst.propertiesChanged = true;
     }
 
-    /** Copy file under lock.
+    /** Write file data under lock.
+     */
+    static void writeFileLocked(Driver &dd, const TileId &tileId
+                                , vs::TileFile type, const std::string &data)
+    {
+        UTILITY_OMP(critical(clone_dd))
+        {
+            auto os(dd.output(tileId, type));
+            os->get().write(data.data(), data.size());
+            os->close();
+        }
+    }
+
+    /** Copy file under lock. Source is read outside the lock.
      */
     static void copyFileLocked(const Driver &sd, Driver &dd
                                , const TileId &tileId
                                , vs::TileFile type)
     {
-        vs::IStream::pointer is(sd.input(tileId, type));
-        UTILITY_OMP(critical(clone_dd))
-            copyFile(is, dd.output(tileId, type));
+        std::ostringstream os;
+        copyFile(sd.input(tileId, type), os);
+        writeFileLocked(dd, tileId, type, os.str());
     }
 
     static void reencode(const TileId &tileId, const NodeInfo &ni
@@ -387,13 +424,11 @@ struct TileSet::Factory
 
         if (hasMesh) {
             if (eflags & CloneOptions::EncodeFlag::mesh) {
-                UTILITY_OMP(critical(clone_dd))
-                {
-                    // reencode mesh
-                    auto os(dd.output(tileId, storage::TileFile::mesh));
-                    saveMesh(os, mesh, &atlas);
-                    os->close();
-                }
+                // reencode mesh outside the lock
+                std::ostringstream os;
+                saveMesh(os, mesh, &atlas);
+                writeFileLocked(dd, tileId, storage::TileFile::mesh
+                                , os.str());
             } else {
                 // just copy file
                 copyFileLocked(sd, dd, tileId, storage::TileFile::mesh);
@@ -415,12 +450,11 @@ struct TileSet::Factory
                 // inpaint
                 const auto out(inpaint(atlas, mesh, textureQuality));
 
-                UTILITY_OMP(critical(clone_dd))
-                {
-                    auto os(dd.output(tileId, storage::TileFile::atlas));
-                    out->serialize(os->get());
-                    os->close();
-                }
+                // serialize outside the lock
+                std::ostringstream os;
+                out->serialize(os);
+                writeFileLocked(dd, tileId, storage::TileFile::atlas
+                                , os.str());
             } else {
                 // just copy file
                 copyFileLocked(sd, dd, tileId, storage::TileFile::atlas);
@@ -477,11 +511,13 @@ struct TileSet::Factory
                 return;
             }
 
-            const MetaNode *metanode;
+            // keep metatile referenced, it can be evicted from the cache
+            // before the task below is run
+            TileNode node;
             UTILITY_OMP(critical(clone_sd))
-                metanode = src->findMetaNode(tid);
+                node = src->findNode(tid);
 
-            if (!metanode) {
+            if (!node) {
                 if (mask & TileIndex::Flag::content) {
                     LOG(warn2)
                         << "Cannot find metanode for tile " << tid << "; "
@@ -494,6 +530,7 @@ struct TileSet::Factory
 
             UTILITY_OMP(task)
             {
+                const MetaNode *metanode(node.metanode);
                 bool mesh(mask & TileIndex::Flag::mesh);
                 bool atlas(mask & TileIndex::Flag::atlas);
 
@@ -735,13 +772,13 @@ TileSet::Detail::Detail(const Driver::pointer &driver)
     : driverTsi_(driver->getTileIndex())
     , readOnly(true), driver(driver)
     , propertiesChanged(false), metadataChanged(false)
-    , metaTiles(MetaCache::create(driver))
     , tsi(driverTsi_ ? *driverTsi_ : tsi_)
     , tileIndex(tsi.tileIndex)
 {
     loadConfig();
     referenceFrame = registry::system.referenceFrames
         (properties.referenceFrame);
+    metaTiles = MetaCache::create(driver, metaOrder());
 
     if (!driverTsi_) {
         loadTileIndex();
@@ -758,7 +795,7 @@ TileSet::Detail::Detail(const Driver::pointer &driver
     , driverTsi_()
     , readOnly(false), driver(driver)
     , propertiesChanged(false), metadataChanged(false)
-    , metaTiles(MetaCache::create(driver))
+    , metaTiles(MetaCache::create(driver, metaOrder()))
     , tsi(tsi_)
     , tileIndex(tsi.tileIndex)
     , lodRange(LodRange::emptyRange())
@@ -1158,19 +1195,25 @@ void TileSet::Detail::setTile(const TileId &tileId, const Tile &tile
                               , const NodeInfo *ni)
 {
     driver->wannaWrite("set tile");
+    storeTile(prepareTile(tileId, tile, ni));
+}
 
-    LOG(info1) << "Setting content of tile " << tileId << ".";
-
+PreparedTile TileSet::Detail::prepareTile(const TileId &tileId
+                                          , const Tile &tile
+                                          , const NodeInfo *ni) const
+{
     auto *mesh(tile.mesh.get());
     auto *atlas(tile.atlas.get());
     auto *navtile(tile.navtile.get());
 
     // resolve node info
-    const NodeInfo nodeInfo(ni ? *ni : NodeInfo(referenceFrame, tileId));
+    PreparedTile prepared
+        (tileId, ni ? *ni : NodeInfo(referenceFrame, tileId));
+    const auto &nodeInfo(prepared.nodeInfo);
 
     sanityCheck(tileId, mesh, atlas, nodeInfo);
 
-    MetaNode metanode;
+    auto &metanode(prepared.metanode);
 
     // set various flags and metadata
     if (mesh) {
@@ -1182,14 +1225,19 @@ void TileSet::Detail::setTile(const TileId &tileId, const Tile &tile
         if (vts::empty(tile.geomExtents)) {
             // no geom extents, need to compute from mesh converted to SDS
             metanode.geomExtents = geomExtents
-                (CsConvertor(referenceFrame.model.physicalSrs, nodeInfo.srs())
+                (cachedCsConvertor(referenceFrame.model.physicalSrs
+                                   , nodeInfo.srs())
                  , *mesh);
         } else {
             metanode.geomExtents = tile.geomExtents;
         }
 
         // get external textures info configuration
-        updateProperties(*mesh);
+        for (const auto &sm : *mesh) {
+            if (sm.textureLayer) {
+                prepared.boundLayers.insert(*sm.textureLayer);
+            }
+        }
 
         metanode.applyTexelSize(true);
 
@@ -1232,23 +1280,74 @@ void TileSet::Detail::setTile(const TileId &tileId, const Tile &tile
         metanode.heightRange = navtile->heightRange();
     }
 
-    // store node
-    updateNode(tileId, metanode, vts::extraFlags(mesh));
+    prepared.extraFlags = vts::extraFlags(mesh);
 
-    // save data
+    // serialize data
     if (mesh) {
-        save(driver->output(tileId, TileFile::mesh), *mesh, atlas);
+        std::ostringstream os;
+        saveMesh(os, *mesh, atlas);
+        prepared.mesh = os.str();
     }
+
     if (atlas) {
-        save(driver->output(tileId, TileFile::atlas), *atlas);
+        std::ostringstream os;
+        atlas->serialize(os);
+        prepared.atlas = os.str();
     }
 
     if (navtile) {
-        save(driver->output(tileId, TileFile::navtile), *navtile);
+        std::ostringstream os;
+        navtile->serialize(os);
+        prepared.navtile = os.str();
+    }
+
+    return prepared;
+}
+
+namespace {
+
+void write(const OStream::pointer &os, const std::string &data)
+{
+    os->get().write(data.data(), data.size());
+    os->close();
+}
+
+} // namespace
+
+void TileSet::Detail::commitTile(const PreparedTile &tile)
+{
+    driver->wannaWrite("commit tile");
+    storeTile(tile);
+}
+
+void TileSet::Detail::storeTile(const PreparedTile &tile)
+{
+    const auto &tileId(tile.tileId);
+
+    LOG(info1) << "Setting content of tile " << tileId << ".";
+
+    // external textures info configuration
+    properties.boundLayers.insert(tile.boundLayers.begin()
+                                  , tile.boundLayers.end());
+
+    // store node
+    updateNode(tileId, tile.metanode, tile.extraFlags);
+
+    // save data
+    if (!tile.mesh.empty()) {
+        write(driver->output(tileId, TileFile::mesh), tile.mesh);
+    }
+
+    if (!tile.atlas.empty()) {
+        write(driver->output(tileId, TileFile::atlas), tile.atlas);
+    }
+
+    if (!tile.navtile.empty()) {
+        write(driver->output(tileId, TileFile::navtile), tile.navtile);
     }
 
     // update properties
-    updateProperties(nodeInfo);
+    updateProperties(tile.nodeInfo);
 }
 
 void TileSet::Detail::setTile(const TileId &tileId, const TileSource &tile
@@ -1337,7 +1436,9 @@ Mesh TileSet::Detail::getMesh(const TileId &tileId, const MetaNode *node)
 
 Mesh TileSet::Detail::getMesh(const TileId &tileId) const
 {
-    return getMesh(tileId, findMetaNode(tileId));
+    // keep metatile alive while node is used
+    const auto node(findNode(tileId));
+    return getMesh(tileId, node.metanode);
 }
 
 Mesh TileSet::Detail::getMesh(const TileId &tileId
@@ -1386,9 +1487,10 @@ MeshMask TileSet::Detail::getMeshMask(const TileId &tileId
         load(driver->input(tileId, TileFile::mesh), mesh);
 
         // convert to SDS
-        CsConvertor conv(referenceFrame.model.physicalSrs, ni.srs());
+        const auto &conv(cachedCsConvertor(referenceFrame.model.physicalSrs
+                                           , ni.srs()));
         for (auto &sm : mesh.submeshes) {
-            for (auto &v : sm.vertices) { v = conv(v); }
+            conv.convert(sm.vertices);
         }
 
         generateMeshMask(meshMask, mesh, ni.extents());
@@ -1399,7 +1501,8 @@ MeshMask TileSet::Detail::getMeshMask(const TileId &tileId
 MeshMask TileSet::Detail::getMeshMask(const TileId &tileId, bool generate)
     const
 {
-    return getMeshMask(tileId, findMetaNode(tileId), generate);
+    const auto node(findNode(tileId));
+    return getMeshMask(tileId, node.metanode, generate);
 }
 
 void TileSet::Detail::getAtlas(const TileId &tileId, Atlas &atlas
@@ -1420,7 +1523,8 @@ void TileSet::Detail::getAtlas(const TileId &tileId, Atlas &atlas
 
 void TileSet::Detail::getAtlas(const TileId &tileId, Atlas &atlas) const
 {
-    return getAtlas(tileId, atlas, findMetaNode(tileId));
+    const auto node(findNode(tileId));
+    return getAtlas(tileId, atlas, node.metanode);
 }
 
 void TileSet::Detail::getAtlas(const TileId &tileId, Atlas &atlas
@@ -1458,12 +1562,14 @@ void TileSet::Detail::getNavTile(const TileId &tileId, NavTile &navtile
 
 void TileSet::Detail::getNavTile(const TileId &tileId, NavTile &navtile) const
 {
-    return getNavTile(tileId, navtile, findMetaNode(tileId));
+    const auto node(findNode(tileId));
+    return getNavTile(tileId, navtile, node.metanode);
 }
 
 TileSource TileSet::Detail::getTileSource(const TileId &tileId) const
 {
-    const auto *node(findMetaNode(tileId));
+    const auto tileNode(findNode(tileId));
+    const auto *node(tileNode.metanode);
 
     if (!node) {
         LOGTHROW(err2, storage::NoSuchTile)
@@ -1563,7 +1669,7 @@ void TileSet::Detail::flush()
     driver->flush();
 
     // new cache - now readonly
-    metaTiles = MetaCache::create(driver);
+    metaTiles = MetaCache::create(driver, metaOrder());
 }
 
 void TileSet::Detail::emptyCache() const
@@ -1905,7 +2011,7 @@ void TileSet::paste(const TileSet &srcSet
             return;
         }
 
-        const auto *metanode(src.findMetaNode(tid));
+        const auto metanode(src.findMetaNode(tid));
         if (!metanode) {
             if (mask & TileIndex::Flag::content) {
                 LOG(warn2)
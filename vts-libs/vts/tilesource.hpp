@@ -26,6 +26,8 @@
 #ifndef vtslibs_vts_tilesource_hpp_included_
 #define vtslibs_vts_tilesource_hpp_included_
 
+#include <string>
+
 #include "../storage/streams.hpp"
 
 #include "metatile.hpp"
@@ -52,6 +54,30 @@ struct TileSource {
     {}
 };
 
+/** Tile encoded by TileSet::prepareTile and ready to be stored by
+ *  TileSet::commitTile. Holds serialized tile files and computed metanode.
+ */
+struct PreparedTile {
+    TileId tileId;
+    NodeInfo nodeInfo;
+    MetaNode metanode;
+    TileIndex::Flag::value_type extraFlags;
+
+    /** Serialized tile files, empty when not present.
+     */
+    std::string mesh;
+    std::string atlas;
+    std::string navtile;
+
+    /** Bound layers referenced by mesh.
+     */
+    registry::IdSet boundLayers;
+
+    PreparedTile(const TileId &tileId, const NodeInfo &nodeInfo)
+        : tileId(tileId), nodeInfo(nodeInfo), extraFlags(0)
+    {}
+};
+
 } } // namespace vtslibs::vts
 
 #endif // vtslibs_vts_tilesource_hpp_included_